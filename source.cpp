@@ -7,6 +7,7 @@
  #include <vector>
  #include <queue>
  #include <map>
+ #include <unordered_map>
  #include <string>
  #include <thread>
  #include <mutex>
@@ -17,20 +18,40 @@
  #include <sstream>
  #include <memory>
  #include <algorithm>
+ #include <functional>
  #include <ctime>
  #include <unistd.h> // For fork() and pipes
  #include <fcntl.h>
  #include <sys/wait.h>
  #include <sys/select.h>
  #include <cstring> // Added for strncpy
+ #include <fstream>
+ #include <charconv>
 // Add this with the other includes if it's not there already (around line 15)
 #include <set>
+#include <deque>
+#include <cstdint>
 
 // Add these includes at the top of the file, after the existing includes
 #include <termios.h>
 #include <limits>
 #include <sys/ioctl.h>
 #include <signal.h>
+#include <atomic>
+#include <new>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <climits>
+#include <cmath>
 
  using namespace std;
  
@@ -48,8 +69,12 @@
  // Direction of flight
  enum class Direction { NORTH, SOUTH, EAST, WEST };
  
- // Runway designations
- enum class Runway { RWY_A, RWY_B, RWY_C, NONE };
+ // Runway designations: an index into the runway topology. RWY_A to RWY_C
+ // name the runways of the default layout.
+ enum class Runway : uint8_t { RWY_A, RWY_B, RWY_C, NONE = 255 };
+ 
+ // How queued flights are given runways
+ enum class RunwayPolicy { GREEDY, LOOKAHEAD };
  
  // Payment status
  enum class PaymentStatus { UNPAID, PAID, OVERDUE };
@@ -60,7 +85,9 @@
      PAYMENT_REQUEST,
      PAYMENT_CONFIRMATION,
      QUERY_AVN,
-     QUERY_AIRLINE
+     QUERY_AIRLINE,
+     STATS_DUMP, // Print the receiving process's latency statistics
+     SUBSCRIBE   // Portal client: airlines whose AVN notices it wants, none for all
  };
  
  // IPC Message structure with fixed-size strings
@@ -73,8 +100,9 @@
      char details[64]; // Fixed-size buffer for details
      int minSpeed; // Added for speed range
      int maxSpeed; // Added for speed range
+     uint64_t timestampNs; // monotonicNs() when the event began (AVN detection), 0 if unknown
      
-     IPCMessage() : type(MessageType::AVN_CREATED), avnId(0), amount(0.0), minSpeed(0), maxSpeed(0) {
+     IPCMessage() : type(MessageType::AVN_CREATED), avnId(0), amount(0.0), minSpeed(0), maxSpeed(0), timestampNs(0) {
          airline[0] = '\0';
          flightNumber[0] = '\0';
          details[0] = '\0';
@@ -89,6 +117,15 @@
  const int ARRIVAL_SOUTH_INTERVAL = 120; // 2 minutes
  const int DEPARTURE_EAST_INTERVAL = 150; // 2.5 minutes
  const int DEPARTURE_WEST_INTERVAL = 240; // 4 minutes
+ const size_t FLIGHT_UPDATE_CHUNK = 64; // Flights per task in the parallel update stage
+ const int RENDER_FPS = 4; // Console redraws per second during the interactive simulation
+ const int TICK_CATCH_UP_LIMIT = 10; // Missed ticks a real-time run makes up back to back; older ones are dropped
+ const size_t AIRCRAFT_POOL_CHUNK = 64 * 1024; // Bytes carved at a time by the aircraft pool
+ 
+ // Retention defaults, so memory stays flat on long runs
+ const size_t AVN_RETENTION = 4096; // AVNs each store holds before evicting, paid ones first
+ const size_t COMPLETED_HISTORY = 256; // Completed-flight summaries kept by the scheduler
+ const size_t RECENT_COMPLETIONS_SHOWN = 5; // Of those, listed in the run summary
  
  // Emergency probabilities
  const int NORTH_EMERGENCY_PROBABILITY = 10; // 10%
@@ -119,1847 +156,8082 @@
  const int CARGO_FINE = 700000; // PKR
  const float SERVICE_FEE_PERCENTAGE = 0.15; // 15%
  
+ // StripePay gateway simulation
+ const int STRIPE_PROCESSING_MS = 2000; // Gateway round trip per payment
+ const size_t STRIPE_MAX_IN_FLIGHT = 1024; // Accepted but not yet confirmed
+ const int STRIPE_WORKER_COUNT = 4;
+ const size_t STRIPE_CONFIRM_BATCH = 64; // Confirmations per write()
+ 
+ // Benchmark settings (--bench)
+ const int BENCH_RING_MESSAGES = 1 << 20; // Records sent by the event ring micro-benchmark
+ const int BENCH_RING_BATCH = 64; // Records per commit() in that benchmark
+ 
  const int VIOLATION_PROBABILITY = 15; // 15% chance of a speed violation
  const int MAX_VIOLATION_SPEED_EXCESS = 40; // Max km/h over the limit
  
- // -------- SHARED RESOURCES --------
- 
- // Mutex for console output
- mutex cout_mutex;
+ // Speed limits per (direction kind, state), indexed by the ArrivalState or
+ // DepartureState value. The enforced range decides whether a speed is a
+ // violation; the reported range is what goes on the AVN.
+ struct SpeedLimit {
+     int enforcedMin;
+     int enforcedMax;
+     int reportedMin;
+     int reportedMax;
+     
+     constexpr bool isViolatedBy(int speed) const {
+         return speed < enforcedMin || speed > enforcedMax;
+     }
+ };
  
- // Mutexes for runway access
- mutex runway_a_mutex;
- mutex runway_b_mutex;
- mutex runway_c_mutex;
+ enum SpeedLimitKind { ARRIVAL_LIMITS = 0, DEPARTURE_LIMITS = 1 };
+ const int SPEED_LIMIT_STATES = 5;
+ constexpr int NO_MIN_SPEED = numeric_limits<int>::min();
  
- // Mutex for AVN data
- mutex avn_mutex;
+ // Every rule a what-if run may change: run length, spawn gaps and emergency
+ // odds per stream (North, South, East, West), violation odds, fines and the
+ // speed limits. DEFAULT_RULES holds the constants above; --rules loads a set
+ // from a file.
+ struct RuleSet {
+     int simulationTime;
+     int streamInterval[4];
+     int emergencyPercent[4];
+     int violationPercent;
+     int commercialFine;
+     int cargoFine;
+     int holdingMin, holdingMax;
+     int approachMin, approachMax;
+     int landingStart;
+     int taxiMin, taxiMax;
+     int gateMax;
+     int takeoffMax;
+     int climbMin, climbMax;
+     int cruiseMin, cruiseMax;
+     
+     // Per (direction kind, state), indexed by the ArrivalState or
+     // DepartureState value; rebuilt from the speeds by deriveLimits()
+     SpeedLimit limits[2][SPEED_LIMIT_STATES];
+     
+     // Landing is only limited by its start speed: reaching LANDING_TIME moves the
+     // flight to Taxi in the same step, so the end-of-landing limit never applies.
+     constexpr void deriveLimits() {
+         // Arrivals: HOLDING, APPROACH, LANDING, TAXI, AT_GATE
+         limits[ARRIVAL_LIMITS][0] = { NO_MIN_SPEED, holdingMax, holdingMin, holdingMax };
+         limits[ARRIVAL_LIMITS][1] = { approachMin, approachMax, approachMin, approachMax };
+         limits[ARRIVAL_LIMITS][2] = { NO_MIN_SPEED, landingStart, 0, landingStart };
+         limits[ARRIVAL_LIMITS][3] = { NO_MIN_SPEED, taxiMax, taxiMin, taxiMax };
+         limits[ARRIVAL_LIMITS][4] = { NO_MIN_SPEED, gateMax, 0, gateMax };
+         // Departures: AT_GATE, TAXI, TAKEOFF_ROLL, CLIMB, CRUISE
+         limits[DEPARTURE_LIMITS][0] = { NO_MIN_SPEED, gateMax, 0, gateMax };
+         limits[DEPARTURE_LIMITS][1] = { NO_MIN_SPEED, taxiMax, taxiMin, taxiMax };
+         limits[DEPARTURE_LIMITS][2] = { NO_MIN_SPEED, takeoffMax, 0, takeoffMax };
+         limits[DEPARTURE_LIMITS][3] = { NO_MIN_SPEED, climbMax, climbMin, climbMax };
+         limits[DEPARTURE_LIMITS][4] = { cruiseMin, cruiseMax, cruiseMin, cruiseMax };
+     }
+     
+     constexpr int fineFor(FlightType type) const {
+         return type == FlightType::COMMERCIAL ? commercialFine : cargoFine;
+     }
+     
+     // All ints, so no padding to compare
+     bool operator==(const RuleSet& other) const {
+         return memcmp(this, &other, sizeof(RuleSet)) == 0;
+     }
+ };
  
- // Random number generator
- random_device rd;
- mt19937 gen(rd());
+ constexpr RuleSet makeDefaultRules() {
+     RuleSet rules = {
+         SIMULATION_TIME,
+         { ARRIVAL_NORTH_INTERVAL, ARRIVAL_SOUTH_INTERVAL, DEPARTURE_EAST_INTERVAL, DEPARTURE_WEST_INTERVAL },
+         { NORTH_EMERGENCY_PROBABILITY, SOUTH_EMERGENCY_PROBABILITY, EAST_EMERGENCY_PROBABILITY, WEST_EMERGENCY_PROBABILITY },
+         VIOLATION_PROBABILITY,
+         COMMERCIAL_FINE, CARGO_FINE,
+         HOLDING_MIN_SPEED, HOLDING_MAX_SPEED,
+         APPROACH_MIN_SPEED, APPROACH_MAX_SPEED,
+         LANDING_START_SPEED,
+         TAXI_MIN_SPEED, TAXI_MAX_SPEED,
+         GATE_MAX_SPEED,
+         TAKEOFF_MAX_SPEED,
+         CLIMB_MIN_SPEED, CLIMB_MAX_SPEED,
+         CRUISE_MIN_SPEED, CRUISE_MAX_SPEED,
+         {}
+     };
+     rules.deriveLimits();
+     return rules;
+ }
  
- // -------- CLASS DEFINITIONS --------
+ constexpr RuleSet DEFAULT_RULES = makeDefaultRules();
  
- // Forward declarations
- class Aircraft;
- class FlightScheduler;
+ // The default limits, for code that is not parameterised on a rule set
+ constexpr const SpeedLimit (&SPEED_LIMITS)[2][SPEED_LIMIT_STATES] = DEFAULT_RULES.limits;
  
- // Airspace Violation Notice (AVN)
- class AVN {
- public:
-     int id;
-     string airline;
-     string flightNumber;
-     FlightType aircraftType;
-     int recordedSpeed;
-     int permissibleSpeedMin;
-     int permissibleSpeedMax;
-     time_t issueTime;
-     time_t dueDate;
-     double fineAmount;
-     double serviceFee;
-     double totalAmount;
-     PaymentStatus status;
+ // Rule file keys: the four streams' spawn gaps and emergency odds are
+ // <stream>_interval and <stream>_emergency; the rest map to a field
+ const char* const RULE_STREAM_NAMES[4] = {"north", "south", "east", "west"};
+ const pair<const char*, int RuleSet::*> RULE_FIELDS[] = {
+     {"simulation_time", &RuleSet::simulationTime},
+     {"violation_percent", &RuleSet::violationPercent},
+     {"commercial_fine", &RuleSet::commercialFine},
+     {"cargo_fine", &RuleSet::cargoFine},
+     {"holding_min_speed", &RuleSet::holdingMin},
+     {"holding_max_speed", &RuleSet::holdingMax},
+     {"approach_min_speed", &RuleSet::approachMin},
+     {"approach_max_speed", &RuleSet::approachMax},
+     {"landing_start_speed", &RuleSet::landingStart},
+     {"taxi_min_speed", &RuleSet::taxiMin},
+     {"taxi_max_speed", &RuleSet::taxiMax},
+     {"gate_max_speed", &RuleSet::gateMax},
+     {"takeoff_max_speed", &RuleSet::takeoffMax},
+     {"climb_min_speed", &RuleSet::climbMin},
+     {"climb_max_speed", &RuleSet::climbMax},
+     {"cruise_min_speed", &RuleSet::cruiseMin},
+     {"cruise_max_speed", &RuleSet::cruiseMax},
+ };
  
-     AVN(int id, const string& airline, const string& flightNumber, FlightType type, 
-         int recordedSpeed, int permissibleSpeedMin, int permissibleSpeedMax) 
-         : id(id), airline(airline), flightNumber(flightNumber), aircraftType(type),
-           recordedSpeed(recordedSpeed), permissibleSpeedMin(permissibleSpeedMin), 
-           permissibleSpeedMax(permissibleSpeedMax), status(PaymentStatus::UNPAID) {
-         
-         // Set issue time to current time
-         issueTime = time(nullptr);
-         
-         // Set due date to 3 days from now
-         dueDate = issueTime + (3 * 24 * 60 * 60);
-         
-         // Calculate fine amount based on aircraft type
-         if (type == FlightType::COMMERCIAL) {
-             fineAmount = COMMERCIAL_FINE;
-         } else {
-             fineAmount = CARGO_FINE;
+ // Where a rule file key is stored, or nullptr for an unknown key
+ inline int* ruleField(RuleSet& rules, const string& key) {
+     for (const auto& field : RULE_FIELDS) {
+         if (key == field.first) {
+             return &(rules.*field.second);
          }
-         
-         // Calculate service fee
-         serviceFee = fineAmount * SERVICE_FEE_PERCENTAGE;
-         
-         // Calculate total amount
-         totalAmount = fineAmount + serviceFee;
      }
- 
-     string getStatusString() const {
-         switch (status) {
-             case PaymentStatus::UNPAID: return "Unpaid";
-             case PaymentStatus::PAID: return "Paid";
-             case PaymentStatus::OVERDUE: return "Overdue";
-             default: return "Unknown";
+     for (int i = 0; i < 4; i++) {
+         if (key == string(RULE_STREAM_NAMES[i]) + "_interval") {
+             return &rules.streamInterval[i];
+         }
+         if (key == string(RULE_STREAM_NAMES[i]) + "_emergency") {
+             return &rules.emergencyPercent[i];
          }
      }
+     return nullptr;
+ }
  
-     string getAircraftTypeString() const {
-         switch (aircraftType) {
-             case FlightType::COMMERCIAL: return "Commercial";
-             case FlightType::CARGO: return "Cargo";
-             case FlightType::EMERGENCY: return "Emergency";
-             default: return "Unknown";
+ // Why a rule set cannot be flown, or nullptr if it can
+ inline const char* ruleSetError(const RuleSet& rules) {
+     if (rules.simulationTime < 0) {
+         return "simulation_time is negative";
+     }
+     for (int i = 0; i < 4; i++) {
+         if (rules.streamInterval[i] <= 0) {
+             return "spawn intervals must be positive";
+         }
+         if (rules.emergencyPercent[i] < 0 || rules.emergencyPercent[i] > 100) {
+             return "emergency odds must be 0-100";
          }
      }
- 
-     string getFormattedTime(time_t timeValue) const {
-         struct tm* timeinfo = localtime(&timeValue);
-         char buffer[80];
-         strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", timeinfo);
-         return string(buffer);
+     if (rules.violationPercent < 0 || rules.violationPercent > 100) {
+         return "violation_percent must be 0-100";
      }
- 
-     void printDetails() const {
-         lock_guard<mutex> lock(cout_mutex);
-         cout << "============= AVN DETAILS =============" << endl;
-         cout << "AVN ID: " << id << endl;
-         cout << "Airline: " << airline << endl;
-         cout << "Flight Number: " << flightNumber << endl;
-         cout << "Aircraft Type: " << getAircraftTypeString() << endl;
-         cout << "Speed Recorded: " << recordedSpeed << " km/h" << endl;
-         cout << "Permissible Speed Range: " << permissibleSpeedMin << "-" << permissibleSpeedMax << " km/h" << endl;
-         cout << "Issue Date/Time: " << getFormattedTime(issueTime) << endl;
-         cout << "Due Date: " << getFormattedTime(dueDate) << endl;
-         cout << "Fine Amount: PKR " << fixed << setprecision(2) << fineAmount << endl;
-         cout << "Service Fee: PKR " << fixed << setprecision(2) << serviceFee << endl;
-         cout << "Total Due: PKR " << fixed << setprecision(2) << totalAmount << endl;
-         cout << "Payment Status: " << getStatusString() << endl;
-         cout << "=======================================" << endl;
+     if (rules.commercialFine < 0 || rules.cargoFine < 0) {
+         return "fines are negative";
      }
- };
+     if (rules.holdingMin > rules.holdingMax || rules.approachMin > rules.approachMax ||
+         rules.taxiMin > rules.taxiMax || rules.climbMin > rules.climbMax || rules.cruiseMin > rules.cruiseMax) {
+         return "a minimum speed is above its maximum";
+     }
+     return nullptr;
+ }
  
- // Airline class
- class Airline {
- public:
-     string name;
-     int totalAircrafts;
-     int activeFlights;
-     vector<shared_ptr<AVN>> violations;
+ // Read "key = value" lines over the rules given, so a file need only list
+ // what it changes. Blank lines and lines starting with '#' are skipped. Any
+ // error is reported and leaves rules unchanged.
+ inline bool loadRuleSet(const string& path, RuleSet& rules) {
+     ifstream in(path);
+     if (!in) {
+         cerr << "Cannot open rules " << path << ": " << strerror(errno) << endl;
+         return false;
+     }
      
-     Airline(const string& name, int totalAircrafts, int activeFlights)
-         : name(name), totalAircrafts(totalAircrafts), activeFlights(activeFlights) {}
+     RuleSet loaded = rules;
+     string line;
+     for (size_t lineNumber = 1; getline(in, line); lineNumber++) {
+         size_t first = line.find_first_not_of(" \t\r");
+         if (first == string::npos || line[first] == '#') {
+             continue;
+         }
+         size_t equals = line.find('=');
+         if (equals == string::npos) {
+             cerr << path << ":" << lineNumber << ": expected key = value" << endl;
+             return false;
+         }
+         size_t keyEnd = line.find_last_not_of(" \t", equals - 1);
+         string key = (keyEnd == string::npos || keyEnd < first) ? "" : line.substr(first, keyEnd - first + 1);
+         transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return tolower(c); });
+         int* field = ruleField(loaded, key);
+         if (!field) {
+             cerr << path << ":" << lineNumber << ": unknown rule \"" << key << "\"" << endl;
+             return false;
+         }
+         
+         size_t valueBegin = line.find_first_not_of(" \t", equals + 1);
+         size_t valueEnd = line.find_last_not_of(" \t\r");
+         const char* begin = line.data() + (valueBegin == string::npos ? line.size() : valueBegin);
+         const char* end = line.data() + (valueEnd == string::npos || valueEnd < equals ? equals + 1 : valueEnd + 1);
+         if (begin >= end || from_chars(begin, end, *field).ptr != end) {
+             cerr << path << ":" << lineNumber << ": " << key << " needs an integer" << endl;
+             return false;
+         }
+     }
      
-     void addViolation(shared_ptr<AVN> violation) {
-         lock_guard<mutex> lock(avn_mutex);
-         violations.push_back(violation);
+     if (const char* error = ruleSetError(loaded)) {
+         cerr << path << ": " << error << endl;
+         return false;
      }
+     loaded.deriveLimits();
+     rules = loaded;
+     return true;
+ }
  
-     void printViolations() const {
-         lock_guard<mutex> lock(cout_mutex);
-         cout << "==== Violations for " << name << " ====" << endl;
+ static_assert(static_cast<int>(ArrivalState::AT_GATE) == SPEED_LIMIT_STATES - 1, "arrival limit table out of date");
+ static_assert(static_cast<int>(DepartureState::CRUISE) == SPEED_LIMIT_STATES - 1, "departure limit table out of date");
+ static_assert(SPEED_LIMITS[ARRIVAL_LIMITS][static_cast<int>(ArrivalState::APPROACH)].isViolatedBy(APPROACH_MAX_SPEED + 1),
+               "speed limits must be usable at compile time");
+ 
+ // Batched violation scan over a fleet partition. For each entry, flags[i] is
+ // set when speeds[i] breaks limits[states[i]] and that state has no fine
+ // yet in violated[i]. Runs four lanes at a time with vector compares and
+ // selects in place of the per-state branches, plus a scalar tail.
+ typedef int SpeedLanes __attribute__((vector_size(16)));
+ typedef uint8_t ByteLanes __attribute__((vector_size(4)));
+ const size_t SPEED_LANE_COUNT = 4;
+ 
+ inline void scanSpeedViolations(const SpeedLimit* limits, const uint8_t* states, const int* speeds,
+                                 const uint8_t* violated, uint8_t* flags, size_t count) {
+     size_t i = 0;
+     
+     for (; i + SPEED_LANE_COUNT <= count; i += SPEED_LANE_COUNT) {
+         ByteLanes stateBytes, doneBytes;
+         SpeedLanes speed;
+         memcpy(&stateBytes, states + i, sizeof(stateBytes));
+         memcpy(&doneBytes, violated + i, sizeof(doneBytes));
+         memcpy(&speed, speeds + i, sizeof(speed));
+         SpeedLanes state = __builtin_convertvector(stateBytes, SpeedLanes);
+         SpeedLanes done = __builtin_convertvector(doneBytes, SpeedLanes);
          
-         if (violations.empty()) {
-             cout << "No violations recorded." << endl;
-         } else {
-             for (const auto& avn : violations) {
-                 cout << "AVN ID: " << avn->id << " | Flight: " << avn->flightNumber 
-                      << " | Status: " << avn->getStatusString() 
-                      << " | Amount: PKR " << fixed << setprecision(2) << avn->totalAmount << endl;
-             }
+         SpeedLanes low = state * 0 + limits[0].enforcedMin;
+         SpeedLanes high = state * 0 + limits[0].enforcedMax;
+         SpeedLanes bit = state * 0 + 1;
+         #pragma GCC unroll 8
+         for (int s = 1; s < SPEED_LIMIT_STATES; s++) {
+             SpeedLanes match = (state == s);
+             low = match ? limits[s].enforcedMin : low;
+             high = match ? limits[s].enforcedMax : high;
+             bit = match ? (1 << s) : bit;
          }
-         cout << "================================" << endl;
+         
+         SpeedLanes fresh = (done & bit) == 0;
+         SpeedLanes hit = ((speed < low) | (speed > high)) & fresh & 1;
+         ByteLanes hitBytes = __builtin_convertvector(hit, ByteLanes);
+         memcpy(flags + i, &hitBytes, sizeof(hitBytes));
      }
+     
+     for (; i < count; i++) {
+         const SpeedLimit& limit = limits[states[i]];
+         flags[i] = limit.isViolatedBy(speeds[i]) && !(violated[i] & (1u << states[i]));
+     }
+ }
+ 
+ // State transition times (in simulation seconds)
+ const int HOLDING_TIME = 20;
+ const int APPROACH_TIME = 15;
+ const int LANDING_TIME = 10;
+ const int TAXI_TIME = 15; // Arrivals and departures
+ const int TAKEOFF_TIME = 10;
+ const int CLIMB_TIME = 20;
+ 
+ // Event time for something that is not going to happen on its own
+ const int NO_EVENT_TIME = numeric_limits<int>::max();
+ 
+ // Seconds of predicted delay the lookahead runway policy weighs
+ const int RUNWAY_LOOKAHEAD_HORIZON = 60;
+ 
+ // -------- RUNWAY TOPOLOGY --------
+ 
+ // What a runway is for. Cargo and emergency mark a priority runway that
+ // flights of that type try first, before a runway of their own direction.
+ enum RunwayCapability : uint8_t {
+     RUNWAY_ARRIVALS = 1,
+     RUNWAY_DEPARTURES = 2,
+     RUNWAY_CARGO = 4,
+     RUNWAY_EMERGENCY = 8
  };
  
- // Aircraft class (base for both arrival and departure)
- class Aircraft {
- protected:
-     static int nextId;
+ const int MAX_RUNWAYS = 26; // Named A to Z
+ const char* const DEFAULT_RUNWAY_TOPOLOGY = "a,d,adce";
+ 
+ // "A" for runway 0, "B" for runway 1, ...
+ inline string runwayLetter(int index) {
+     return string(1, static_cast<char>('A' + index));
+ }
+ 
+ // The airport's runways, fixed at startup. Written as one capability group
+ // per runway, comma separated, with a = arrivals, d = departures, c = cargo
+ // and e = emergency: the default "a,d,adce" is RWY-A for arrivals, RWY-B for
+ // departures and RWY-C for both, taking cargo and emergencies first.
+ class RunwayTopology {
+ private:
+     vector<uint8_t> capabilities;
      
  public:
-     int id;
-     string flightNumber;
-     string airline;
-     FlightType type;
-     Direction direction;
-     int priority;
-     int currentSpeed;
-     bool hasActiveViolation;
-     shared_ptr<AVN> currentViolation;
-     chrono::system_clock::time_point scheduledTime;
-     chrono::system_clock::time_point actualTime;
-     Runway assignedRunway;
-     bool isEmergency;
-     // Add to Aircraft base class (around line 240) after the other member variables:
-
-// Track which states have already had violations
-std::set<string> violatedStates;
-// Add a new member variable to the Aircraft base class (around line 241)
-bool maintainViolationSpeed = false;
-int violationSpeed = 0;
-
-     Aircraft(const string& flightNumber, const string& airline, FlightType type, 
-              Direction direction, int priority, 
-              chrono::system_clock::time_point scheduledTime)
-         : id(nextId++), flightNumber(flightNumber), airline(airline), type(type),
-           direction(direction), priority(priority), currentSpeed(0),
-           hasActiveViolation(false), scheduledTime(scheduledTime),
-           assignedRunway(Runway::NONE), isEmergency(false) {}
+     RunwayTopology() {
+         parse(DEFAULT_RUNWAY_TOPOLOGY);
+     }
      
-     virtual ~Aircraft() {}
+     // Replace the layout with spec. A bad spec is reported and leaves the
+     // layout unchanged.
+     bool parse(const string& spec) {
+         vector<uint8_t> parsed;
+         uint8_t current = 0;
+         for (size_t i = 0; i <= spec.size(); i++) {
+             char c = (i < spec.size()) ? static_cast<char>(tolower(spec[i])) : ',';
+             switch (c) {
+                 case 'a': current |= RUNWAY_ARRIVALS; break;
+                 case 'd': current |= RUNWAY_DEPARTURES; break;
+                 case 'c': current |= RUNWAY_CARGO; break;
+                 case 'e': current |= RUNWAY_EMERGENCY; break;
+                 case ',':
+                     if (!(current & (RUNWAY_ARRIVALS | RUNWAY_DEPARTURES))) {
+                         cerr << "Runway " << parsed.size() + 1 << " in \"" << spec << "\" serves neither arrivals nor departures" << endl;
+                         return false;
+                     }
+                     parsed.push_back(current);
+                     current = 0;
+                     break;
+                 default:
+                     cerr << "Unknown runway capability '" << spec[i] << "' in \"" << spec << "\" (expected a, d, c or e)" << endl;
+                     return false;
+             }
+         }
+         
+         if (parsed.size() > MAX_RUNWAYS) {
+             cerr << "At most " << MAX_RUNWAYS << " runways are supported" << endl;
+             return false;
+         }
+         uint8_t served = 0;
+         for (uint8_t runway : parsed) {
+             served |= runway;
+         }
+         if (!(served & RUNWAY_ARRIVALS) || !(served & RUNWAY_DEPARTURES)) {
+             cerr << "Runway topology \"" << spec << "\" needs a runway for arrivals and one for departures" << endl;
+             return false;
+         }
+         capabilities = move(parsed);
+         return true;
+     }
      
-     virtual void updateStatus(int simulationTime) = 0;
-     virtual void checkViolation() = 0;
-     virtual string getStateString() const = 0;
-     virtual bool isCompleted() const = 0;
+     size_t size() const {
+         return capabilities.size();
+     }
      
-     string getRunwayString() const {
-         switch (assignedRunway) {
-             case Runway::RWY_A: return "RWY-A";
-             case Runway::RWY_B: return "RWY-B";
-             case Runway::RWY_C: return "RWY-C";
-             case Runway::NONE: return "None";
-             default: return "Unknown";
-         }
+     uint8_t capabilitiesOf(size_t runway) const {
+         return capabilities[runway];
      }
      
-     string getDirectionString() const {
-         switch (direction) {
-             case Direction::NORTH: return "North";
-             case Direction::SOUTH: return "South";
-             case Direction::EAST: return "East";
-             case Direction::WEST: return "West";
-             default: return "Unknown";
-         }
+     bool serves(size_t runway, bool arrival) const {
+         return capabilities[runway] & (arrival ? RUNWAY_ARRIVALS : RUNWAY_DEPARTURES);
      }
      
-     string getTypeString() const {
-         switch (type) {
-             case FlightType::COMMERCIAL: return "Commercial";
-             case FlightType::CARGO: return "Cargo";
-             case FlightType::EMERGENCY: return "Emergency";
-             default: return "Unknown";
+     bool isPriorityRunway(size_t runway) const {
+         return capabilities[runway] & (RUNWAY_CARGO | RUNWAY_EMERGENCY);
+     }
+     
+     // A priority runway that flights of this type try first
+     bool prefers(size_t runway, FlightType type) const {
+         return (type == FlightType::CARGO && (capabilities[runway] & RUNWAY_CARGO)) ||
+                (type == FlightType::EMERGENCY && (capabilities[runway] & RUNWAY_EMERGENCY));
+     }
+     
+     string str() const {
+         string spec;
+         for (size_t r = 0; r < capabilities.size(); r++) {
+             if (r > 0) {
+                 spec += ',';
+             }
+             const char letters[] = "adce";
+             for (int bit = 0; bit < 4; bit++) {
+                 if (capabilities[r] & (1 << bit)) {
+                     spec += letters[bit];
+                 }
+             }
          }
+         return spec;
      }
+ };
+ 
+ // Runway layout and allocation policy for a run
+ struct RunwayConfig {
+     RunwayTopology topology;
+     RunwayPolicy policy = RunwayPolicy::GREEDY;
+ };
+ 
+ // -------- SPEED PROFILES --------
+ 
+ // How a ramped state's speed moves from its start to its end speed
+ enum RampShape : uint8_t {
+     LINEAR_RAMP,   // Constant acceleration
+     EASE_IN_RAMP,  // Slow to change at first, as a heavy aircraft is
+     EASE_OUT_RAMP  // Most of the change early, then settling
+ };
+ 
+ // How speed evolves through each flight state. A state either draws its
+ // speed once on entry, within [entryMin, entryMax], and holds it, or follows
+ // a ramp from rampFrom to rampTo over rampTime seconds.
+ struct SpeedPhase {
+     int entryMin;
+     int entryMax;
+     int rampFrom;
+     int rampTo;
+     int rampTime; // 0 for states without a ramp
+     RampShape shape;
      
-     virtual string getSummary() const {
-         stringstream ss;
-         ss << flightNumber << " | " << airline << " | " << getTypeString() 
-            << " | " << getDirectionString() << " | " << getStateString()
-            << " | Speed: " << currentSpeed << " km/h | Runway: " << getRunwayString();
-         if (isEmergency) ss << " | EMERGENCY";
-         if (hasActiveViolation) ss << " | VIOLATION";
-         return ss.str();
+     // Entry speed from one 32-bit draw, scaled onto the range with a
+     // multiply and shift rather than a distribution built per entry
+     template <typename Generator>
+     int drawEntry(Generator& generator) const {
+         uint64_t span = static_cast<uint64_t>(entryMax - entryMin) + 1;
+         return entryMin + static_cast<int>((static_cast<uint32_t>(generator()) * span) >> 32);
      }
  };
  
- int Aircraft::nextId = 1000;
+ const int FLIGHT_TYPE_COUNT = 3;
+ const int MAX_RAMP_TIME = 10; // Longest ramped state, in seconds
  
- // Arrival Flight class
- class ArrivalFlight : public Aircraft {
+ static_assert(LANDING_TIME <= MAX_RAMP_TIME && TAKEOFF_TIME <= MAX_RAMP_TIME, "ramp table too short");
+ 
+ // Which part of each state's permitted speed range a flight type flies
+ enum SpeedBand : uint8_t { FULL_BAND, LOWER_BAND, UPPER_BAND };
+ 
+ struct TypeSpeedStyle {
+     SpeedBand band;
+     RampShape landing;
+     RampShape takeoff;
+ };
+ 
+ // Indexed by FlightType. Cargo flies the slow half of each range, brakes
+ // late on landing and gathers speed slowly on takeoff; emergencies fly the
+ // fast half, brake hard and leave quickly. Every curve stays inside the
+ // speed limits, so only injected violations break them.
+ constexpr TypeSpeedStyle TYPE_SPEED_STYLES[FLIGHT_TYPE_COUNT] = {
+     { FULL_BAND, LINEAR_RAMP, LINEAR_RAMP },     // COMMERCIAL
+     { LOWER_BAND, EASE_IN_RAMP, EASE_IN_RAMP },  // CARGO
+     { UPPER_BAND, EASE_OUT_RAMP, EASE_OUT_RAMP } // EMERGENCY
+ };
+ 
+ // Every type's phases, and each ramp's speed at every whole second, built
+ // from a rule set's speeds. Ticks are whole seconds, so a ramp step is one
+ // table read.
+ class SpeedProfiles {
  private:
-     ArrivalState state;
-     int stateTime; // Time spent in current state
+     SpeedPhase phases[FLIGHT_TYPE_COUNT][2][SPEED_LIMIT_STATES];
+     int16_t ramps[FLIGHT_TYPE_COUNT][2][SPEED_LIMIT_STATES][MAX_RAMP_TIME + 1];
      
-     // State transition times (in simulation seconds)
-     const int HOLDING_TIME = 20;
-     const int APPROACH_TIME = 15;
-     const int LANDING_TIME = 10;
-     const int TAXI_TIME = 15;
+     static constexpr SpeedPhase entryPhase(SpeedBand band, int low, int high) {
+         int middle = low + (high - low) / 2;
+         return { band == UPPER_BAND ? middle : low, band == LOWER_BAND ? middle : high, 0, 0, 0, LINEAR_RAMP };
+     }
      
- public:
-     ArrivalFlight(const string& flightNumber, const string& airline, FlightType type, 
-                   Direction direction, int priority, 
-                   chrono::system_clock::time_point scheduledTime)
-         : Aircraft(flightNumber, airline, type, direction, priority, scheduledTime),
-           state(ArrivalState::HOLDING), stateTime(0) {
-         
-         // Set initial speed based on state
-         uniform_int_distribution<> holdingDist(HOLDING_MIN_SPEED, HOLDING_MAX_SPEED);
-         currentSpeed = holdingDist(gen);
+     static constexpr SpeedPhase rampPhase(int from, int to, int time, RampShape shape) {
+         return { from, from, from, to, time, shape };
      }
      
-     ArrivalState getState() const {
-         return state;
+     static constexpr int rampPoint(const SpeedPhase& phase, int second) {
+         long long change = phase.rampTo - phase.rampFrom;
+         long long steps = phase.rampTime;
+         switch (phase.shape) {
+             case EASE_IN_RAMP:
+                 return phase.rampFrom + change * second * second / (steps * steps);
+             case EASE_OUT_RAMP:
+                 return phase.rampTo - change * (steps - second) * (steps - second) / (steps * steps);
+             default:
+                 return phase.rampFrom + change * second / steps;
+         }
      }
      
-     string getStateString() const override {
-         switch (state) {
-             case ArrivalState::HOLDING: return "Holding";
-             case ArrivalState::APPROACH: return "Approach";
-             case ArrivalState::LANDING: return "Landing";
-             case ArrivalState::TAXI: return "Taxi";
-             case ArrivalState::AT_GATE: return "At Gate";
-             default: return "Unknown";
+ public:
+     constexpr explicit SpeedProfiles(const RuleSet& rules) : phases{}, ramps{} {
+         for (int type = 0; type < FLIGHT_TYPE_COUNT; type++) {
+             const TypeSpeedStyle& style = TYPE_SPEED_STYLES[type];
+             SpeedPhase* arrival = phases[type][ARRIVAL_LIMITS];
+             arrival[0] = entryPhase(style.band, rules.holdingMin, rules.holdingMax);
+             arrival[1] = entryPhase(style.band, rules.approachMin, rules.approachMax);
+             arrival[2] = rampPhase(rules.landingStart, LANDING_END_SPEED, LANDING_TIME, style.landing);
+             arrival[3] = entryPhase(style.band, rules.taxiMin, rules.taxiMax);
+             arrival[4] = entryPhase(FULL_BAND, 0, 0);
+             SpeedPhase* departure = phases[type][DEPARTURE_LIMITS];
+             departure[0] = entryPhase(FULL_BAND, 0, 0);
+             departure[1] = entryPhase(style.band, rules.taxiMin, rules.taxiMax);
+             departure[2] = rampPhase(0, rules.takeoffMax, TAKEOFF_TIME, style.takeoff);
+             departure[3] = entryPhase(style.band, rules.climbMin, rules.climbMax);
+             departure[4] = entryPhase(style.band, rules.cruiseMin, rules.cruiseMax);
+             
+             for (int kind = 0; kind < 2; kind++) {
+                 for (int state = 0; state < SPEED_LIMIT_STATES; state++) {
+                     const SpeedPhase& phase = phases[type][kind][state];
+                     // Past its ramp time a state holds the end speed
+                     for (int second = 0; phase.rampTime > 0 && second <= MAX_RAMP_TIME; second++) {
+                         ramps[type][kind][state][second] = rampPoint(phase, min(second, phase.rampTime));
+                     }
+                 }
+             }
          }
      }
      
-     // For ArrivalFlight::updateStatus (around line 398)
-
-void updateStatus(int simulationTime) override {
-    stateTime++;
-    
-    // Store previous state to detect state transitions
-    ArrivalState previousState = state;
-    
-    // Update speed and state based on current state and time spent in that state
-    switch (state) {
-        case ArrivalState::HOLDING:
-            if (stateTime >= HOLDING_TIME && assignedRunway != Runway::NONE) {
-                state = ArrivalState::APPROACH;
-                stateTime = 0;
-                // Reset violation settings when changing state
-                maintainViolationSpeed = false;
-                
-                if (!maintainViolationSpeed) {
-                    uniform_int_distribution<> approachDist(APPROACH_MIN_SPEED, APPROACH_MAX_SPEED);
-                    currentSpeed = approachDist(gen);
-                }
-            }
-            break;
-            
-        case ArrivalState::APPROACH:
-            if (stateTime >= APPROACH_TIME) {
-                state = ArrivalState::LANDING;
-                stateTime = 0;
-                // Reset violation settings when changing state
-                maintainViolationSpeed = false;
-                
-                if (!maintainViolationSpeed) {
-                    currentSpeed = LANDING_START_SPEED;
-                }
-            }
-            break;
-            
-        case ArrivalState::LANDING:
-            if (!maintainViolationSpeed) {
-                // Gradually decrease speed during landing
-                currentSpeed = max(LANDING_END_SPEED, LANDING_START_SPEED - 
-                                  (LANDING_START_SPEED - LANDING_END_SPEED) * stateTime / LANDING_TIME);
-            }
-            
-            if (stateTime >= LANDING_TIME) {
-                state = ArrivalState::TAXI;
-                stateTime = 0;
-                // Reset violation settings when changing state
-                maintainViolationSpeed = false;
-                
-                if (!maintainViolationSpeed) {
-                    uniform_int_distribution<> taxiDist(TAXI_MIN_SPEED, TAXI_MAX_SPEED);
-                    currentSpeed = taxiDist(gen);
-                }
-            }
-            break;
-            
-        case ArrivalState::TAXI:
-            if (stateTime >= TAXI_TIME) {
-                state = ArrivalState::AT_GATE;
-                stateTime = 0;
-                // Reset violation settings when changing state
-                maintainViolationSpeed = false;
-                currentSpeed = 0;
-            }
-            break;
-            
-        case ArrivalState::AT_GATE:
-            maintainViolationSpeed = false;
-            currentSpeed = 0;
-            break;
-    }
-    
-    // If state has changed, clear violation speed
-    if (previousState != state) {
-        maintainViolationSpeed = false;
-    }
-    
-    // Randomly introduce speed violations with a configurable probability
-    if (!hasActiveViolation && !isEmergency && !maintainViolationSpeed) {  // Don't give violations to emergency flights
-        uniform_int_distribution<> violationChanceDist(1, 100);
-        
-        // Only proceed with violation logic if the random check passes
-        // Make this a lower probability to ensure fewer aircraft get violations
-        if (violationChanceDist(gen) <= VIOLATION_PROBABILITY / 3) {
-            uniform_int_distribution<> violationDist(1, 100);
-            if (violationDist(gen) <= VIOLATION_PROBABILITY) {
-                // Determine excess speed based on current state
-                int excessSpeed = 0;
-                uniform_int_distribution<> excessDist(5, MAX_VIOLATION_SPEED_EXCESS);
-                
-                switch (state) {
-                    case ArrivalState::HOLDING:
-                        excessSpeed = excessDist(gen);
-                        currentSpeed = HOLDING_MAX_SPEED + excessSpeed;
-                        maintainViolationSpeed = true;
-                        violationSpeed = currentSpeed;
-                        break;
-                        
-                    case ArrivalState::APPROACH:
-                        excessSpeed = excessDist(gen);
-                        currentSpeed = APPROACH_MAX_SPEED + excessSpeed;
-                        maintainViolationSpeed = true;
-                        violationSpeed = currentSpeed;
-                        break;
-                        
-                    case ArrivalState::LANDING:
-                        if (stateTime > LANDING_TIME / 2) {
-                            excessSpeed = excessDist(gen);
-                            // Higher speed than should be at this point in landing
-                            currentSpeed += excessSpeed;
-                            maintainViolationSpeed = true;
-                            violationSpeed = currentSpeed;
-                        }
-                        break;
-                        
-                    case ArrivalState::TAXI:
-                        excessSpeed = excessDist(gen) / 2; // Less excess for taxi speeds
-                        currentSpeed = TAXI_MAX_SPEED + excessSpeed;
-                        maintainViolationSpeed = true;
-                        violationSpeed = currentSpeed;
-                        break;
-                        
-                    default:
-                        break;
-                }
-            }
-        }
-    } else if (maintainViolationSpeed) {
-        // Maintain the violation speed until state changes
-        currentSpeed = violationSpeed;
-    }
-    
-    // Check for violations
-    checkViolation();
-}
+     const SpeedPhase& phase(FlightType type, SpeedLimitKind kind, int state) const {
+         return phases[static_cast<int>(type)][kind][state];
+     }
      
-     // Modify the checkViolation method in ArrivalFlight class (around line 634)
+     // Speed stateTime seconds into a ramped state, holding the end speed past the ramp
+     int rampSpeed(FlightType type, SpeedLimitKind kind, int state, int stateTime) const {
+         return ramps[static_cast<int>(type)][kind][state][min(max(stateTime, 0), MAX_RAMP_TIME)];
+     }
+     
+     // Speed on entering a state: the start of its ramp, or a draw from its entry range
+     template <typename Generator>
+     int entrySpeed(FlightType type, SpeedLimitKind kind, int state, Generator& generator) const {
+         const SpeedPhase& entered = phase(type, kind, state);
+         if (entered.rampTime > 0) {
+             return ramps[static_cast<int>(type)][kind][state][0];
+         }
+         return entered.entryMin == entered.entryMax ? entered.entryMin : entered.drawEntry(generator);
+     }
+ };
+ 
+ // How a flight class reaches its rules and the speed profiles built from
+ // them. FixedRules bakes a constexpr set into the instantiation, so the
+ // limits and ramps in updateStatus and checkViolation fold to constants;
+ // LoadedRules follows the run's set through a pointer.
+ struct LoadedRules {
+     static const RuleSet& get(const RuleSet* loaded) {
+         return *loaded;
+     }
+     
+     static const SpeedProfiles& speeds(const SpeedProfiles* loaded) {
+         return *loaded;
+     }
+ };
+ 
+ template <const RuleSet& Fixed>
+ struct FixedRules {
+     static constexpr SpeedProfiles PROFILES{Fixed};
+     
+     static constexpr const RuleSet& get(const RuleSet*) {
+         return Fixed;
+     }
+     
+     static constexpr const SpeedProfiles& speeds(const SpeedProfiles*) {
+         return PROFILES;
+     }
+ };
+ 
+ // Flights fly the fixed instantiation whenever the run's set equals this one
+ using ProductionRules = FixedRules<DEFAULT_RULES>;
 
-void checkViolation() override {
-    // Get current state as a string
-    string currentStateStr = getStateString();
-    
-    // Skip violation check if we already had a violation in this state
-    if (violatedStates.find(currentStateStr) != violatedStates.end()) {
-        return;
-    }
-    
-    bool violation = false;
-    int minSpeed = 0, maxSpeed = 0;
-    
-    switch (state) {
-        case ArrivalState::HOLDING:
-            if (currentSpeed > HOLDING_MAX_SPEED) {
-                violation = true;
-                minSpeed = HOLDING_MIN_SPEED;
-                maxSpeed = HOLDING_MAX_SPEED;
-            }
-            break;
-            
-        case ArrivalState::APPROACH:
-            if (currentSpeed < APPROACH_MIN_SPEED || currentSpeed > APPROACH_MAX_SPEED) {
-                violation = true;
-                minSpeed = APPROACH_MIN_SPEED;
-                maxSpeed = APPROACH_MAX_SPEED;
-            }
-            break;
-            
-        case ArrivalState::LANDING:
-            if (currentSpeed > LANDING_START_SPEED || 
-                (stateTime >= LANDING_TIME && currentSpeed > LANDING_END_SPEED)) {
-                violation = true;
-                minSpeed = 0;
-                maxSpeed = LANDING_START_SPEED;
-            }
-            break;
-            
-        case ArrivalState::TAXI:
-            if (currentSpeed > TAXI_MAX_SPEED) {
-                violation = true;
-                minSpeed = TAXI_MIN_SPEED;
-                maxSpeed = TAXI_MAX_SPEED;
-            }
-            break;
-            
-        case ArrivalState::AT_GATE:
-            if (currentSpeed > GATE_MAX_SPEED) {
-                violation = true;
-                minSpeed = 0;
-                maxSpeed = GATE_MAX_SPEED;
-            }
-            break;
-    }
-    
-    // If there's a violation
-    if (violation) {
-        hasActiveViolation = true;
-        
-        // Create new AVN
-        static int avnIdCounter = 1000;
-        currentViolation = make_shared<AVN>(
-            avnIdCounter++, airline, flightNumber, type,
-            currentSpeed, minSpeed, maxSpeed
-        );
-        
-        // Add this state to the set of states that have had violations
-        violatedStates.insert(currentStateStr);
-        
-        lock_guard<mutex> lock(cout_mutex);
-        cout << "\nVIOLATION DETECTED! Flight " << flightNumber 
-             << " (" << airline << ") - Speed: " << currentSpeed 
-             << " km/h in " << getStateString() << " state.\n";
-    }
-}
+ // -------- FLIGHT STATE MACHINES --------
+ 
+ // The arrival and departure state machines: when a flight changes state,
+ // when it holds a runway, and the speed an injected violation gives it.
+ // ArrivalFlight, DepartureFlight and the fleet store all step through these.
+ struct ArrivalMachine {
+     using State = ArrivalState;
+     static constexpr SpeedLimitKind KIND = ARRIVAL_LIMITS;
      
-     bool isCompleted() const override {
+     // Where a flight goes after stateTime seconds in state
+     static State next(State state, int stateTime, bool runwayAssigned) {
+         switch (state) {
+             case ArrivalState::HOLDING:
+                 return (stateTime >= HOLDING_TIME && runwayAssigned) ? ArrivalState::APPROACH : state;
+             case ArrivalState::APPROACH:
+                 return (stateTime >= APPROACH_TIME) ? ArrivalState::LANDING : state;
+             case ArrivalState::LANDING:
+                 return (stateTime >= LANDING_TIME) ? ArrivalState::TAXI : state;
+             case ArrivalState::TAXI:
+                 return (stateTime >= TAXI_TIME) ? ArrivalState::AT_GATE : state;
+             default:
+                 return state;
+         }
+     }
+     
+     static bool isDone(State state) {
          return state == ArrivalState::AT_GATE;
      }
+     
+     // Seconds from stateTime until next() moves on, with the runway as it is
+     // now; NO_EVENT_TIME while waiting for a runway or done
+     static int secondsToTransition(State state, int stateTime, bool runwayAssigned) {
+         switch (state) {
+             case ArrivalState::HOLDING:
+                 return runwayAssigned ? max(1, HOLDING_TIME - stateTime) : NO_EVENT_TIME;
+             case ArrivalState::APPROACH: return APPROACH_TIME - stateTime;
+             case ArrivalState::LANDING: return LANDING_TIME - stateTime;
+             case ArrivalState::TAXI: return TAXI_TIME - stateTime;
+             default: return NO_EVENT_TIME;
+         }
+     }
+     
+     // States in which injectSpeed() can ever succeed
+     static bool takesInjection(State state) {
+         return state != ArrivalState::AT_GATE;
+     }
+     
+     // Arrivals clear the runway once taxiing
+     static bool hasClearedRunway(State state) {
+         return state == ArrivalState::TAXI || state == ArrivalState::AT_GATE;
+     }
+     
+     // Approach starts once the holding time is up and a runway is assigned
+     static int runwayLeadTime(State state, int stateTime) {
+         return state == ArrivalState::HOLDING ? max(0, HOLDING_TIME - 1 - stateTime) : 0;
+     }
+     
+     static int runwayTimeRemaining(State state, int stateTime) {
+         switch (state) {
+             case ArrivalState::HOLDING: return max(1, HOLDING_TIME - stateTime) + APPROACH_TIME + LANDING_TIME;
+             case ArrivalState::APPROACH: return APPROACH_TIME - stateTime + LANDING_TIME;
+             case ArrivalState::LANDING: return LANDING_TIME - stateTime;
+             default: return 0;
+         }
+     }
+     
+     // Speed after an injected violation; false if the state takes none now
+     template <typename Generator>
+     static bool injectSpeed(const RuleSet& rules, State state, int stateTime, int& speed, Generator& rng) {
+         uniform_int_distribution<> excessDist(5, MAX_VIOLATION_SPEED_EXCESS);
+         switch (state) {
+             case ArrivalState::HOLDING:
+                 speed = rules.holdingMax + excessDist(rng);
+                 return true;
+             case ArrivalState::APPROACH:
+                 speed = rules.approachMax + excessDist(rng);
+                 return true;
+             case ArrivalState::LANDING:
+                 // Higher speed than should be at this point in landing
+                 if (stateTime > LANDING_TIME / 2) {
+                     speed += excessDist(rng);
+                     return true;
+                 }
+                 return false;
+             case ArrivalState::TAXI:
+                 speed = rules.taxiMax + excessDist(rng) / 2; // Less excess for taxi speeds
+                 return true;
+             default:
+                 return false;
+         }
+     }
  };
  
- // Departure Flight class
- class DepartureFlight : public Aircraft {
+ struct DepartureMachine {
+     using State = DepartureState;
+     static constexpr SpeedLimitKind KIND = DEPARTURE_LIMITS;
+     
+     static State next(State state, int stateTime, bool runwayAssigned) {
+         switch (state) {
+             case DepartureState::AT_GATE:
+                 return runwayAssigned ? DepartureState::TAXI : state;
+             case DepartureState::TAXI:
+                 return (stateTime >= TAXI_TIME) ? DepartureState::TAKEOFF_ROLL : state;
+             case DepartureState::TAKEOFF_ROLL:
+                 return (stateTime >= TAKEOFF_TIME) ? DepartureState::CLIMB : state;
+             case DepartureState::CLIMB:
+                 return (stateTime >= CLIMB_TIME) ? DepartureState::CRUISE : state;
+             default:
+                 return state;
+         }
+     }
+     
+     static bool isDone(State state) {
+         return state == DepartureState::CRUISE;
+     }
+     
+     static int secondsToTransition(State state, int stateTime, bool runwayAssigned) {
+         switch (state) {
+             case DepartureState::AT_GATE: return runwayAssigned ? 1 : NO_EVENT_TIME;
+             case DepartureState::TAXI: return TAXI_TIME - stateTime;
+             case DepartureState::TAKEOFF_ROLL: return TAKEOFF_TIME - stateTime;
+             case DepartureState::CLIMB: return CLIMB_TIME - stateTime;
+             default: return NO_EVENT_TIME;
+         }
+     }
+     
+     static bool takesInjection(State state) {
+         return state != DepartureState::AT_GATE;
+     }
+     
+     // Departures clear the runway once climbing
+     static bool hasClearedRunway(State state) {
+         return state == DepartureState::CLIMB || state == DepartureState::CRUISE;
+     }
+     
+     // Departures start taxiing the tick they are assigned
+     static int runwayLeadTime(State, int) {
+         return 0;
+     }
+     
+     static int runwayTimeRemaining(State state, int stateTime) {
+         switch (state) {
+             case DepartureState::AT_GATE: return 1 + TAXI_TIME + TAKEOFF_TIME;
+             case DepartureState::TAXI: return TAXI_TIME - stateTime + TAKEOFF_TIME;
+             case DepartureState::TAKEOFF_ROLL: return TAKEOFF_TIME - stateTime;
+             default: return 0;
+         }
+     }
+     
+     template <typename Generator>
+     static bool injectSpeed(const RuleSet& rules, State state, int stateTime, int& speed, Generator& rng) {
+         uniform_int_distribution<> excessDist(5, MAX_VIOLATION_SPEED_EXCESS);
+         switch (state) {
+             case DepartureState::TAXI:
+                 speed = rules.taxiMax + excessDist(rng) / 2; // Less excess for taxi speeds
+                 return true;
+             case DepartureState::TAKEOFF_ROLL:
+                 // Only exceed speed when we're supposed to be at a moderate speed
+                 if (stateTime > TAKEOFF_TIME / 2) {
+                     speed = rules.takeoffMax + excessDist(rng);
+                     return true;
+                 }
+                 return false;
+             case DepartureState::CLIMB:
+                 speed = rules.climbMax + excessDist(rng);
+                 return true;
+             case DepartureState::CRUISE: {
+                 // Either too slow or too fast
+                 uniform_int_distribution<> sideDist(1, 100);
+                 if (sideDist(rng) > 50) {
+                     speed = rules.cruiseMax + excessDist(rng);
+                 } else {
+                     speed = rules.cruiseMin - excessDist(rng);
+                 }
+                 return true;
+             }
+             default:
+                 return false;
+         }
+     }
+ };
+ 
+ // The next elapsed seconds of a flight's state machine: follow the state's
+ // ramp in profiles unless holding an injected speed, then take any
+ // transition now due and enter the new state at entrySpeed(state). Callers
+ // step at least at every secondsToTransition() boundary, so at most one
+ // transition is due. Returns true on a transition.
+ template <typename Machine, typename EntrySpeed>
+ bool advanceFlight(const SpeedProfiles& profiles, typename Machine::State& state, int& stateTime, int& speed,
+                    bool& maintainViolation, FlightType type, bool runwayAssigned, int elapsed, EntrySpeed entrySpeed) {
+     stateTime += elapsed;
+     int index = static_cast<int>(state);
+     if (!maintainViolation && profiles.phase(type, Machine::KIND, index).rampTime > 0) {
+         speed = profiles.rampSpeed(type, Machine::KIND, index, stateTime);
+     }
+     
+     typename Machine::State next = Machine::next(state, stateTime, runwayAssigned);
+     if (next == state) {
+         return false;
+     }
+     state = next;
+     stateTime = 0;
+     maintainViolation = false;
+     speed = entrySpeed(static_cast<int>(next));
+     return true;
+ }
+ 
+ // nextInjection before a flight has drawn when its next violation roll succeeds
+ const int INJECTION_UNDRAWN = -1;
+ 
+ // Odds that one second's two violation rolls both come up
+ inline double injectionOdds(int violationPercent) {
+     // Make this a lower probability to ensure fewer aircraft get violations
+     return (violationPercent / 3) / 100.0 * min(violationPercent, 100) / 100.0;
+ }
+ 
+ // Seconds of failed rolls before the next successful one: geometric at
+ // odds, from one draw, so a flight need not roll every second
+ template <typename Generator>
+ int drawInjectionGap(double odds, Generator& rng) {
+     if (odds <= 0) {
+         return NO_EVENT_TIME;
+     }
+     if (odds >= 1) {
+         return 0;
+     }
+     double uniform = (static_cast<uint32_t>(rng()) + 1.0) / 4294967296.0;
+     double gap = floor(log(uniform) / log1p(-odds));
+     return gap < (1 << 30) ? static_cast<int>(gap) : NO_EVENT_TIME;
+ }
+ 
+ // The violation roll at second now, for a flight neither holding an
+ // injected speed nor an emergency. nextInjection is the second its next
+ // roll succeeds: drawn on the first roll in a state that can take one and
+ // after every success. True, with speed set to the injected speed, when
+ // that second is now and the state allows an injection.
+ template <typename Machine, typename Generator>
+ bool stepInjection(const RuleSet& rules, double odds, typename Machine::State state, int stateTime, int now,
+                    int& nextInjection, int& speed, Generator& rng) {
+     if (!Machine::takesInjection(state)) {
+         nextInjection = INJECTION_UNDRAWN;
+         return false;
+     }
+     if (nextInjection == INJECTION_UNDRAWN || nextInjection < now) {
+         int gap = drawInjectionGap(odds, rng);
+         nextInjection = (gap == NO_EVENT_TIME) ? NO_EVENT_TIME : now + gap;
+     }
+     if (nextInjection != now) {
+         return false;
+     }
+     int gap = drawInjectionGap(odds, rng);
+     nextInjection = (gap == NO_EVENT_TIME) ? NO_EVENT_TIME : now + 1 + gap;
+     return Machine::injectSpeed(rules, state, stateTime, speed, rng);
+ }
+ 
+ // -------- SHARED RESOURCES --------
+ 
+ // Mutex for console output
+ mutex cout_mutex;
+ 
+ // Heap allocation counter for --bench, only in builds made with
+ // -DACX_COUNT_ALLOCATIONS so normal builds keep the standard operator new
+ atomic<bool> countAllocations(false);
+ atomic<uint64_t> allocationCount(0);
+ 
+ #ifdef ACX_COUNT_ALLOCATIONS
+ constexpr bool ALLOCATIONS_COUNTED = true;
+ 
+ // The replacements below pair with each other; GCC cannot tell once inlined
+ #pragma GCC diagnostic push
+ #pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+ void* operator new(size_t size) {
+     if (countAllocations.load(memory_order_relaxed)) {
+         allocationCount.fetch_add(1, memory_order_relaxed);
+     }
+     while (true) {
+         if (void* memory = malloc(size ? size : 1)) {
+             return memory;
+         }
+         new_handler handler = get_new_handler();
+         if (!handler) {
+             throw bad_alloc();
+         }
+         handler();
+     }
+ }
+ 
+ void operator delete(void* memory) noexcept {
+     free(memory);
+ }
+ 
+ void operator delete(void* memory, size_t) noexcept {
+     free(memory);
+ }
+ #pragma GCC diagnostic pop
+ #else
+ constexpr bool ALLOCATIONS_COUNTED = false;
+ #endif
+ 
+ // Philox4x32-10 counter-based generator (Salmon et al., SC'11). A draw is a
+ // pure function of a 64-bit key and a 128-bit counter, so a stream keyed by
+ // (run seed, aircraft id) and counted by (tick, draw) gives the same values
+ // whichever thread steps the flight, in whatever order, and costs 36 bytes
+ // instead of mt19937's 5 KB. Works with the standard distributions.
+ class PhiloxStream {
  private:
-     DepartureState state;
-     int stateTime; // Time spent in current state
+     static constexpr uint32_t MULTIPLIER_0 = 0xD2511F53;
+     static constexpr uint32_t MULTIPLIER_1 = 0xCD9E8D57;
+     static constexpr uint32_t WEYL_0 = 0x9E3779B9;
+     static constexpr uint32_t WEYL_1 = 0xBB67AE85;
+     static constexpr int ROUNDS = 10;
      
-     // State transition times (in simulation seconds)
-     const int TAXI_TIME = 15;
-     const int TAKEOFF_TIME = 10;
-     const int CLIMB_TIME = 20;
+     uint32_t key[2];
+     uint32_t tick;       // Counter word 1
+     uint32_t blockIndex; // Counter word 0: blocks used so far this tick
+     uint32_t buffer[4];
+     uint32_t used;       // Words of buffer already returned
      
  public:
-     DepartureFlight(const string& flightNumber, const string& airline, FlightType type, 
-                     Direction direction, int priority, 
-                     chrono::system_clock::time_point scheduledTime)
-         : Aircraft(flightNumber, airline, type, direction, priority, scheduledTime),
-           state(DepartureState::AT_GATE), stateTime(0) {
-         
-         // Initial speed at gate is 0
-         currentSpeed = 0;
+     using result_type = uint32_t;
+     
+     PhiloxStream(uint32_t seed = 0, uint32_t stream = 0)
+         : key{seed, stream}, tick(0), blockIndex(0), buffer{}, used(4) {}
+     
+     static constexpr result_type min() { return 0; }
+     static constexpr result_type max() { return UINT32_MAX; }
+     
+     // One block: four 32-bit words for a counter under a key. Blocks are
+     // independent, so a caller may fill any number of them at once.
+     static void block(const uint32_t counter[4], const uint32_t streamKey[2], uint32_t out[4]) {
+         uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+         uint32_t k0 = streamKey[0], k1 = streamKey[1];
+         for (int round = 0; round < ROUNDS; round++) {
+             uint64_t product0 = static_cast<uint64_t>(MULTIPLIER_0) * c0;
+             uint64_t product1 = static_cast<uint64_t>(MULTIPLIER_1) * c2;
+             c0 = static_cast<uint32_t>(product1 >> 32) ^ c1 ^ k0;
+             c1 = static_cast<uint32_t>(product1);
+             c2 = static_cast<uint32_t>(product0 >> 32) ^ c3 ^ k1;
+             c3 = static_cast<uint32_t>(product0);
+             k0 += WEYL_0;
+             k1 += WEYL_1;
+         }
+         out[0] = c0;
+         out[1] = c1;
+         out[2] = c2;
+         out[3] = c3;
      }
      
-     DepartureState getState() const {
-         return state;
+     // Move to the first draw of a tick; staying in the current tick keeps
+     // the position, so several callers in one tick see fresh values
+     void enterTick(uint32_t newTick) {
+         if (newTick != tick) {
+             tick = newTick;
+             blockIndex = 0;
+             used = 4;
+         }
      }
      
-     string getStateString() const override {
-         switch (state) {
-             case DepartureState::AT_GATE: return "At Gate";
-             case DepartureState::TAXI: return "Taxi";
-             case DepartureState::TAKEOFF_ROLL: return "Takeoff Roll";
-             case DepartureState::CLIMB: return "Climb";
-             case DepartureState::CRUISE: return "Cruise";
-             default: return "Unknown";
+     result_type operator()() {
+         if (used == 4) {
+             const uint32_t counter[4] = {blockIndex++, tick, 0, 0};
+             block(counter, key, buffer);
+             used = 0;
          }
+         return buffer[used++];
      }
+ };
+ 
+ // Per-run state that would otherwise be global: each FlightScheduler owns one,
+ // so several schedulers can run side by side in one process.
+ struct SimulationContext {
+     PhiloxStream rng;    // Spawn draws: stream 0 of the run seed, counted by tick
+     uint32_t seed;       // Run seed, the key of every flight's stream
+     int nextAircraftId;  // Aircraft ID counter
+     int nextAVNId;       // AVN ID counter
+     int emergencyPercent; // Overrides the per-direction emergency odds when >= 0
+     int violationPercent; // Violation odds for new flights
+     RuleSet rules;        // Limits, fines and spawn rules of this run
+     SpeedProfiles profiles; // Every type's speeds under rules
      
-     // For DepartureFlight::updateStatus (around line 766)
-
-void updateStatus(int simulationTime) override {
-    stateTime++;
-    
-    // Store previous state to detect state transitions
-    DepartureState previousState = state;
-    
-    // Update speed and state based on current state and time spent in that state
-    switch (state) {
-        case DepartureState::AT_GATE:
-            if (assignedRunway != Runway::NONE) {
-                state = DepartureState::TAXI;
-                stateTime = 0;
-                // Reset violation settings when changing state
-                maintainViolationSpeed = false;
-                
-                if (!maintainViolationSpeed) {
-                    uniform_int_distribution<> taxiDist(TAXI_MIN_SPEED, TAXI_MAX_SPEED);
-                    currentSpeed = taxiDist(gen);
-                }
-            } else {
-                currentSpeed = 0;
-            }
-            break;
-            
-        case DepartureState::TAXI:
-            if (stateTime >= TAXI_TIME) {
-                state = DepartureState::TAKEOFF_ROLL;
-                stateTime = 0;
-                // Reset violation settings when changing state
-                maintainViolationSpeed = false;
-                
-                if (!maintainViolationSpeed) {
-                    currentSpeed = 0; // Start from standstill
-                }
-            }
-            break;
-            
-        case DepartureState::TAKEOFF_ROLL:
-            if (!maintainViolationSpeed) {
-                // Gradually increase speed during takeoff roll
-                currentSpeed = min(TAKEOFF_MAX_SPEED, 
-                                 (TAKEOFF_MAX_SPEED * stateTime) / TAKEOFF_TIME);
-            }
-            
-            if (stateTime >= TAKEOFF_TIME) {
-                state = DepartureState::CLIMB;
-                stateTime = 0;
-                // Reset violation settings when changing state
-                maintainViolationSpeed = false;
-                
-                if (!maintainViolationSpeed) {
-                    uniform_int_distribution<> climbDist(CLIMB_MIN_SPEED, CLIMB_MAX_SPEED);
-                    currentSpeed = climbDist(gen);
-                }
-            }
-            break;
-            
-        case DepartureState::CLIMB:
-            if (stateTime >= CLIMB_TIME) {
-                state = DepartureState::CRUISE;
-                stateTime = 0;
-                // Reset violation settings when changing state
-                maintainViolationSpeed = false;
-                
-                if (!maintainViolationSpeed) {
-                    uniform_int_distribution<> cruiseDist(CRUISE_MIN_SPEED, CRUISE_MAX_SPEED);
-                    currentSpeed = cruiseDist(gen);
-                }
-            }
-            break;
-            
-        case DepartureState::CRUISE:
-            // Maintain cruise speed
-            break;
-    }
-    
-    // If state has changed, clear violation speed
-    if (previousState != state) {
-        maintainViolationSpeed = false;
-    }
-    
-    // Randomly introduce speed violations with a configurable probability
-    if (!hasActiveViolation && !isEmergency && !maintainViolationSpeed) {  // Don't give violations to emergency flights
-        uniform_int_distribution<> violationChanceDist(1, 100);
-        
-        // Only proceed with violation logic if the random check passes
-        // Make this a lower probability to ensure fewer aircraft get violations
-        if (violationChanceDist(gen) <= VIOLATION_PROBABILITY / 3) {
-            uniform_int_distribution<> violationDist(1, 100);
-            if (violationDist(gen) <= VIOLATION_PROBABILITY) {
-                // Determine excess speed based on current state
-                int excessSpeed = 0;
-                uniform_int_distribution<> excessDist(5, MAX_VIOLATION_SPEED_EXCESS);
-                
-                switch (state) {
-                    case DepartureState::TAXI:
-                        excessSpeed = excessDist(gen) / 2; // Less excess for taxi speeds
-                        currentSpeed = TAXI_MAX_SPEED + excessSpeed;
-                        maintainViolationSpeed = true;
-                        violationSpeed = currentSpeed;
-                        break;
-                        
-                    case DepartureState::TAKEOFF_ROLL:
-                        if (stateTime > TAKEOFF_TIME / 2) {
-                            // Only exceed speed when we're supposed to be at a moderate speed
-                            excessSpeed = excessDist(gen);
-                            currentSpeed = TAKEOFF_MAX_SPEED + excessSpeed;
-                            maintainViolationSpeed = true;
-                            violationSpeed = currentSpeed;
-                        }
-                        break;
-                        
-                    case DepartureState::CLIMB:
-                        excessSpeed = excessDist(gen);
-                        currentSpeed = CLIMB_MAX_SPEED + excessSpeed;
-                        maintainViolationSpeed = true;
-                        violationSpeed = currentSpeed;
-                        break;
-                        
-                    case DepartureState::CRUISE:
-                        // Either too slow or too fast
-                        if (violationDist(gen) > 50) {
-                            excessSpeed = excessDist(gen);
-                            currentSpeed = CRUISE_MAX_SPEED + excessSpeed;
-                        } else {
-                            excessSpeed = excessDist(gen);
-                            currentSpeed = CRUISE_MIN_SPEED - excessSpeed;
-                        }
-                        maintainViolationSpeed = true;
-                        violationSpeed = currentSpeed;
-                        break;
-                        
-                    default:
-                        break;
-                }
-            }
-        }
-    } else if (maintainViolationSpeed) {
-        // Maintain the violation speed until state changes
-        currentSpeed = violationSpeed;
-    }
-    
-    // Check for violations
-    checkViolation();
-}
+     explicit SimulationContext(unsigned seed)
+         : rng(seed, 0), seed(seed), nextAircraftId(1000), nextAVNId(1000),
+           emergencyPercent(-1), violationPercent(DEFAULT_RULES.violationPercent), rules(DEFAULT_RULES),
+           profiles(DEFAULT_RULES) {}
+     
+     int emergencyOdds(int directionPercent) const {
+         return emergencyPercent >= 0 ? emergencyPercent : directionPercent;
+     }
+ };
+ 
+ // CLOCK_MONOTONIC in nanoseconds. Every process forked from the ATC reads the
+ // same clock, so these timestamps can be compared across the IPC channels.
+ inline uint64_t monotonicNs() {
+     timespec now;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+     return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + now.tv_nsec;
+ }
+ 
+ // HDR-style histogram: values are bucketed by power of two and each power of
+ // two is split into 16 linear sub-buckets, so every value from 0 to UINT64_MAX
+ // is kept to within 1/16 in under 8 KB. One thread records; any thread may
+ // read or merge() it meanwhile, since every counter is a relaxed atomic.
+ class LatencyHistogram {
+ public:
+     static constexpr int SUB_BUCKET_BITS = 4;
+     static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+     static constexpr int BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+     
+ private:
+     atomic<uint64_t> counts[BUCKETS];
+     atomic<uint64_t> total;
+     atomic<uint64_t> sum;
+     atomic<uint64_t> minValue;
+     atomic<uint64_t> maxValue;
+     
+     // Owner-only update: a plain load and store, no locked read-modify-write
+     static void add(atomic<uint64_t>& counter, uint64_t amount) {
+         counter.store(counter.load(memory_order_relaxed) + amount, memory_order_relaxed);
+     }
+     
+     static int bucketOf(uint64_t value) {
+         if (value < SUB_BUCKETS) {
+             return static_cast<int>(value);
+         }
+         int exponent = 63 - __builtin_clzll(value);
+         int sub = static_cast<int>((value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+         return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+     }
+     
+     // Largest value that lands in bucket
+     static uint64_t bucketHigh(int bucket) {
+         if (bucket < SUB_BUCKETS) {
+             return bucket;
+         }
+         int shift = bucket / SUB_BUCKETS - 1;
+         uint64_t sub = bucket % SUB_BUCKETS;
+         return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+     }
+     
+ public:
+     LatencyHistogram() : total(0), sum(0), minValue(UINT64_MAX), maxValue(0) {
+         for (auto& count : counts) {
+             count.store(0, memory_order_relaxed);
+         }
+     }
+     
+     void record(uint64_t value) {
+         add(counts[bucketOf(value)], 1);
+         add(total, 1);
+         add(sum, value);
+         if (value < minValue.load(memory_order_relaxed)) {
+             minValue.store(value, memory_order_relaxed);
+         }
+         if (value > maxValue.load(memory_order_relaxed)) {
+             maxValue.store(value, memory_order_relaxed);
+         }
+     }
+     
+     // Fold another histogram (possibly still being recorded) into this one
+     void merge(const LatencyHistogram& other) {
+         for (int i = 0; i < BUCKETS; i++) {
+             add(counts[i], other.counts[i].load(memory_order_relaxed));
+         }
+         add(total, other.total.load(memory_order_relaxed));
+         add(sum, other.sum.load(memory_order_relaxed));
+         minValue.store(min(minValue.load(memory_order_relaxed), other.minValue.load(memory_order_relaxed)), memory_order_relaxed);
+         maxValue.store(max(maxValue.load(memory_order_relaxed), other.maxValue.load(memory_order_relaxed)), memory_order_relaxed);
+     }
+     
+     uint64_t count() const {
+         return total.load(memory_order_relaxed);
+     }
+     
+     double mean() const {
+         uint64_t n = count();
+         return n ? static_cast<double>(sum.load(memory_order_relaxed)) / n : 0.0;
+     }
+     
+     uint64_t highest() const {
+         return maxValue.load(memory_order_relaxed);
+     }
+     
+     // Smallest bucket bound at or above the given fraction of recorded values
+     uint64_t valueAt(double fraction) const {
+         uint64_t n = count();
+         if (n == 0) {
+             return 0;
+         }
+         uint64_t rank = static_cast<uint64_t>(ceil(fraction * n));
+         uint64_t seen = 0;
+         for (int i = 0; i < BUCKETS; i++) {
+             seen += counts[i].load(memory_order_relaxed);
+             if (seen >= std::max<uint64_t>(rank, 1)) {
+                 return min(bucketHigh(i), highest());
+             }
+         }
+         return highest();
+     }
+     
+     // One summary line; values are divided by scale and shown in unit
+     void print(const string& label, double scale, const char* unit, ostream& out = cout) const {
+         out << left << setw(24) << label << right << " n " << setw(8) << count();
+         if (count() > 0) {
+             out << fixed << setprecision(1)
+                  << "  p50 " << setw(8) << valueAt(0.50) / scale
+                  << "  p99 " << setw(8) << valueAt(0.99) / scale
+                  << "  p99.9 " << setw(8) << valueAt(0.999) / scale
+                  << "  max " << setw(8) << highest() / scale << " " << unit;
+         }
+         out << endl;
+     }
+ };
+ 
+ // Single-producer/single-consumer ring of IPCMessage records shared between the
+ // ATC controller and the AVN Generator. It is mapped MAP_SHARED before fork(),
+ // so both processes see the same slots. The producer stages records with push()
+ // and publishes a whole tick's batch with commit(). An eventfd doorbell wakes
+ // the consumer, and is only written while the consumer is asleep.
+ class AVNEventRing {
+ public:
+     static constexpr uint64_t CAPACITY = 1024; // Must be a power of two
+     
+ private:
+     struct Shared {
+         alignas(64) atomic<uint64_t> head;      // Published by the producer
+         alignas(64) atomic<uint64_t> tail;      // Released by the consumer
+         alignas(64) atomic<uint32_t> sleeping;  // Consumer is blocked on the doorbell
+         atomic<uint32_t> closed;                // Producer will publish no more
+         IPCMessage slots[CAPACITY];
+         
+         Shared() : head(0), tail(0), sleeping(0), closed(0) {}
+     };
+     
+     static_assert((CAPACITY & (CAPACITY - 1)) == 0, "ring capacity must be a power of two");
+     static_assert(atomic<uint64_t>::is_always_lock_free, "ring counters must be lock-free to share across processes");
+     
+     Shared* shared;
+     int doorbell;
+     uint64_t stagedHead; // Producer-local: end of pushed but uncommitted records
+     
+     void ring() {
+         uint64_t one = 1;
+         write(doorbell, &one, sizeof(one));
+     }
+     
+ public:
+     AVNEventRing() : shared(nullptr), doorbell(-1), stagedHead(0) {
+         void* memory = mmap(nullptr, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+         if (memory == MAP_FAILED) {
+             return;
+         }
+         doorbell = eventfd(0, 0);
+         if (doorbell < 0) {
+             munmap(memory, sizeof(Shared));
+             return;
+         }
+         shared = new (memory) Shared();
+     }
+     
+     ~AVNEventRing() {
+         if (shared) {
+             munmap(shared, sizeof(Shared));
+         }
+         if (doorbell >= 0) {
+             ::close(doorbell);
+         }
+     }
+     
+     AVNEventRing(const AVNEventRing&) = delete;
+     AVNEventRing& operator=(const AVNEventRing&) = delete;
+     
+     bool valid() const {
+         return shared != nullptr;
+     }
+     
+     // Producer: stage a record, false if the ring is full
+     bool push(const IPCMessage& message) {
+         if (stagedHead - shared->tail.load(memory_order_acquire) >= CAPACITY) {
+             return false;
+         }
+         shared->slots[stagedHead & (CAPACITY - 1)] = message;
+         stagedHead++;
+         return true;
+     }
+     
+     // Producer: publish every staged record at once
+     void commit() {
+         if (stagedHead == shared->head.load(memory_order_relaxed)) {
+             return;
+         }
+         shared->head.store(stagedHead, memory_order_seq_cst);
+         if (shared->sleeping.load(memory_order_seq_cst)) {
+             ring();
+         }
+     }
+     
+     // Producer: tell the consumer to stop once the ring is empty
+     void close() {
+         commit();
+         shared->closed.store(1, memory_order_seq_cst);
+         ring();
+     }
+     
+     // Consumer: true once the producer closed the ring and it has been drained
+     bool finished() const {
+         return shared->closed.load(memory_order_acquire) &&
+                shared->tail.load(memory_order_relaxed) == shared->head.load(memory_order_acquire);
+     }
+     
+     // Consumer: eventfd to poll() on while asleep
+     int getDoorbell() const {
+         return doorbell;
+     }
+     
+     // Consumer: announce we are going to sleep, then re-check so a commit()
+     // racing with us either sees the flag or is seen here. False means
+     // records (or a close) arrived and the caller should not sleep.
+     bool prepareToSleep() {
+         shared->sleeping.store(1, memory_order_seq_cst);
+         if (shared->tail.load(memory_order_relaxed) != shared->head.load(memory_order_seq_cst) ||
+             shared->closed.load(memory_order_seq_cst)) {
+             shared->sleeping.store(0, memory_order_relaxed);
+             return false;
+         }
+         return true;
+     }
+     
+     // Consumer: back from poll(); reset the doorbell if it rang
+     void endSleep(bool rang) {
+         if (rang) {
+             uint64_t count;
+             read(doorbell, &count, sizeof(count));
+         }
+         shared->sleeping.store(0, memory_order_relaxed);
+     }
+     
+     // Consumer: hand every published record to handler in place, then free the slots
+     template <typename Handler>
+     size_t drain(Handler handler) {
+         uint64_t tail = shared->tail.load(memory_order_relaxed);
+         uint64_t head = shared->head.load(memory_order_acquire);
+         for (uint64_t i = tail; i < head; i++) {
+             handler(shared->slots[i & (CAPACITY - 1)]);
+         }
+         shared->tail.store(head, memory_order_release);
+         return head - tail;
+     }
+ };
+ 
+ // -------- CLASS DEFINITIONS --------
+ 
+ // Forward declarations
+ class Aircraft;
+ class FlightScheduler;
+ 
+ // Airspace Violation Notice (AVN)
+ class AVN {
+ public:
+     int id;
+     string airline;
+     string flightNumber;
+     FlightType aircraftType;
+     int recordedSpeed;
+     int permissibleSpeedMin;
+     int permissibleSpeedMax;
+     time_t issueTime;
+     time_t dueDate;
+     double fineAmount;
+     double serviceFee;
+     double totalAmount;
+     PaymentStatus status;
+     uint64_t detectedAtNs; // monotonicNs() when the violation was detected
+ 
+     AVN(int id, const string& airline, const string& flightNumber, FlightType type, 
+         int recordedSpeed, int permissibleSpeedMin, int permissibleSpeedMax, const RuleSet& rules = DEFAULT_RULES) 
+         : id(id), airline(airline), flightNumber(flightNumber), aircraftType(type),
+           recordedSpeed(recordedSpeed), permissibleSpeedMin(permissibleSpeedMin), 
+           permissibleSpeedMax(permissibleSpeedMax), status(PaymentStatus::UNPAID), detectedAtNs(0) {
+         
+         // Set issue time to current time
+         issueTime = time(nullptr);
+         
+         // Set due date to 3 days from now
+         dueDate = issueTime + (3 * 24 * 60 * 60);
+         
+         // Calculate fine amount based on aircraft type
+         fineAmount = rules.fineFor(type);
+         
+         // Calculate service fee
+         serviceFee = fineAmount * SERVICE_FEE_PERCENTAGE;
+         
+         // Calculate total amount
+         totalAmount = fineAmount + serviceFee;
+     }
+ 
+     string getStatusString() const {
+         switch (status) {
+             case PaymentStatus::UNPAID: return "Unpaid";
+             case PaymentStatus::PAID: return "Paid";
+             case PaymentStatus::OVERDUE: return "Overdue";
+             default: return "Unknown";
+         }
+     }
+ 
+     string getAircraftTypeString() const {
+         switch (aircraftType) {
+             case FlightType::COMMERCIAL: return "Commercial";
+             case FlightType::CARGO: return "Cargo";
+             case FlightType::EMERGENCY: return "Emergency";
+             default: return "Unknown";
+         }
+     }
+ 
+     string getFormattedTime(time_t timeValue) const {
+         struct tm* timeinfo = localtime(&timeValue);
+         char buffer[80];
+         strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", timeinfo);
+         return string(buffer);
+     }
+ 
+     void printDetails() const {
+         lock_guard<mutex> lock(cout_mutex);
+         cout << "============= AVN DETAILS =============" << endl;
+         cout << "AVN ID: " << id << endl;
+         cout << "Airline: " << airline << endl;
+         cout << "Flight Number: " << flightNumber << endl;
+         cout << "Aircraft Type: " << getAircraftTypeString() << endl;
+         cout << "Speed Recorded: " << recordedSpeed << " km/h" << endl;
+         cout << "Permissible Speed Range: " << permissibleSpeedMin << "-" << permissibleSpeedMax << " km/h" << endl;
+         cout << "Issue Date/Time: " << getFormattedTime(issueTime) << endl;
+         cout << "Due Date: " << getFormattedTime(dueDate) << endl;
+         cout << "Fine Amount: PKR " << fixed << setprecision(2) << fineAmount << endl;
+         cout << "Service Fee: PKR " << fixed << setprecision(2) << serviceFee << endl;
+         cout << "Total Due: PKR " << fixed << setprecision(2) << totalAmount << endl;
+         cout << "Payment Status: " << getStatusString() << endl;
+         cout << "=======================================" << endl;
+     }
+ };
+ 
+ // Index over the AVNs held in memory, so lookups don't scan the history.
+ // An open-addressing table maps id -> slot, and each slot is threaded onto
+ // an intrusive list for its airline and onto the unpaid or paid list. With
+ // a limit set, adding past it evicts the AVN paid longest ago, or the oldest
+ // unpaid one if none are paid, and its slot is reused.
+ class AVNIndex {
+ private:
+     static constexpr int32_t NO_SLOT = -1;
+     
+     struct Links {
+         int32_t airline;      // Interned airline id
+         int32_t prevInAirline;
+         int32_t nextInAirline;
+         int32_t prevInStatus; // Unpaid or paid list; the free list uses nextInStatus
+         int32_t nextInStatus;
+     };
+     
+     struct List {
+         int32_t head = NO_SLOT;
+         int32_t tail = NO_SLOT;
+         size_t count = 0;
+     };
+     
+     vector<shared_ptr<AVN>> avns;  // By slot; empty while a slot is free
+     vector<Links> links;           // Parallel to avns
+     vector<int32_t> table;         // Open addressing, linear probing; NO_SLOT = empty
+     
+     unordered_map<string, int32_t> airlineIds;
+     vector<List> airlineLists;
+     
+     List unpaid;
+     List paid;                     // In payment order
+     int32_t freeSlots;
+     size_t held;
+     size_t issued;
+     size_t evicted;
+     size_t limit;                  // 0 = unlimited
+     
+     size_t bucketFor(int id) const {
+         // Fibonacci hashing spreads the sequential ids over the table
+         return (static_cast<uint32_t>(id) * 2654435769u) & (table.size() - 1);
+     }
+     
+     void insertBucket(int32_t slot) {
+         size_t bucket = bucketFor(avns[slot]->id);
+         while (table[bucket] != NO_SLOT) {
+             bucket = (bucket + 1) & (table.size() - 1);
+         }
+         table[bucket] = slot;
+     }
+     
+     // Backward-shift deletion, so probes never need tombstones
+     void eraseBucket(int32_t slot) {
+         size_t mask = table.size() - 1;
+         size_t hole = bucketFor(avns[slot]->id);
+         while (table[hole] != slot) {
+             hole = (hole + 1) & mask;
+         }
+         table[hole] = NO_SLOT;
+         for (size_t next = (hole + 1) & mask; table[next] != NO_SLOT; next = (next + 1) & mask) {
+             size_t home = bucketFor(avns[table[next]]->id);
+             if (((next - home) & mask) >= ((next - hole) & mask)) {
+                 table[hole] = table[next];
+                 table[next] = NO_SLOT;
+                 hole = next;
+             }
+         }
+     }
+     
+     void rehash(size_t buckets) {
+         table.assign(buckets, NO_SLOT);
+         for (size_t slot = 0; slot < avns.size(); slot++) {
+             if (avns[slot]) {
+                 insertBucket(slot);
+             }
+         }
+     }
+     
+     int32_t findSlot(int id) const {
+         if (table.empty()) {
+             return NO_SLOT;
+         }
+         size_t bucket = bucketFor(id);
+         while (table[bucket] != NO_SLOT) {
+             if (avns[table[bucket]]->id == id) {
+                 return table[bucket];
+             }
+             bucket = (bucket + 1) & (table.size() - 1);
+         }
+         return NO_SLOT;
+     }
+     
+     void pushBack(List& list, int32_t slot, int32_t Links::*prev, int32_t Links::*next) {
+         links[slot].*prev = list.tail;
+         links[slot].*next = NO_SLOT;
+         if (list.tail != NO_SLOT) {
+             links[list.tail].*next = slot;
+         } else {
+             list.head = slot;
+         }
+         list.tail = slot;
+         list.count++;
+     }
+     
+     void unlink(List& list, int32_t slot, int32_t Links::*prev, int32_t Links::*next) {
+         Links& link = links[slot];
+         if (link.*prev != NO_SLOT) {
+             links[link.*prev].*next = link.*next;
+         } else {
+             list.head = link.*next;
+         }
+         if (link.*next != NO_SLOT) {
+             links[link.*next].*prev = link.*prev;
+         } else {
+             list.tail = link.*prev;
+         }
+         link.*prev = link.*next = NO_SLOT;
+         list.count--;
+     }
+     
+     List& statusList(int32_t slot) {
+         return (avns[slot]->status == PaymentStatus::PAID) ? paid : unpaid;
+     }
+     
+     void evict(int32_t slot) {
+         eraseBucket(slot);
+         unlink(airlineLists[links[slot].airline], slot, &Links::prevInAirline, &Links::nextInAirline);
+         unlink(statusList(slot), slot, &Links::prevInStatus, &Links::nextInStatus);
+         avns[slot].reset();
+         links[slot].nextInStatus = freeSlots;
+         freeSlots = slot;
+         held--;
+         evicted++;
+     }
+     
+ public:
+     AVNIndex() : freeSlots(NO_SLOT), held(0), issued(0), evicted(0), limit(0) {}
+     
+     // Most AVNs held at once (0 = unlimited); applies from the next add
+     void setLimit(size_t maxHeld) {
+         limit = maxHeld;
+     }
+     
+     void add(const shared_ptr<AVN>& avn) {
+         while (limit > 0 && held >= limit) {
+             evict(paid.head != NO_SLOT ? paid.head : unpaid.head);
+         }
+         
+         int32_t slot;
+         if (freeSlots != NO_SLOT) {
+             slot = freeSlots;
+             freeSlots = links[slot].nextInStatus;
+             avns[slot] = avn;
+         } else {
+             slot = avns.size();
+             avns.push_back(avn);
+             links.emplace_back();
+         }
+         held++;
+         issued++;
+         
+         // Keep the load factor at or below one half
+         if (held * 2 > table.size()) {
+             rehash(max<size_t>(16, table.size() * 2));
+         } else {
+             insertBucket(slot);
+         }
+         
+         auto inserted = airlineIds.emplace(avn->airline, airlineLists.size());
+         int32_t airline = inserted.first->second;
+         if (inserted.second) {
+             airlineLists.emplace_back();
+         }
+         links[slot].airline = airline;
+         pushBack(airlineLists[airline], slot, &Links::prevInAirline, &Links::nextInAirline);
+         pushBack(statusList(slot), slot, &Links::prevInStatus, &Links::nextInStatus);
+     }
+     
+     AVN* find(int id) const {
+         int32_t slot = findSlot(id);
+         return (slot == NO_SLOT) ? nullptr : avns[slot].get();
+     }
+     
+     // Mark an AVN paid and move it to the paid list; false if unknown
+     bool markPaid(int id) {
+         int32_t slot = findSlot(id);
+         if (slot == NO_SLOT) {
+             return false;
+         }
+         if (avns[slot]->status != PaymentStatus::PAID) {
+             unlink(unpaid, slot, &Links::prevInStatus, &Links::nextInStatus);
+             avns[slot]->status = PaymentStatus::PAID;
+             pushBack(paid, slot, &Links::prevInStatus, &Links::nextInStatus);
+         }
+         return true;
+     }
+     
+     // Visit an airline's held AVNs in issue order
+     template <typename Visitor>
+     int forEachByAirline(const string& airline, Visitor visit) const {
+         auto it = airlineIds.find(airline);
+         if (it == airlineIds.end()) {
+             return 0;
+         }
+         const List& list = airlineLists[it->second];
+         for (int32_t slot = list.head; slot != NO_SLOT; slot = links[slot].nextInAirline) {
+             visit(*avns[slot]);
+         }
+         return list.count;
+     }
+     
+     // Visit unpaid AVNs in issue order
+     template <typename Visitor>
+     void forEachUnpaid(Visitor visit) const {
+         for (int32_t slot = unpaid.head; slot != NO_SLOT; slot = links[slot].nextInStatus) {
+             visit(*avns[slot]);
+         }
+     }
+     
+     // AVNs held now
+     size_t size() const {
+         return held;
+     }
+     
+     bool empty() const {
+         return held == 0;
+     }
+     
+     // Every AVN ever added, including evicted ones
+     size_t getIssuedCount() const {
+         return issued;
+     }
+     
+     size_t getEvictedCount() const {
+         return evicted;
+     }
+     
+     size_t getUnpaidCount() const {
+         return unpaid.count;
+     }
+ };
+ 
+ // -------- FRAMED PIPE PROTOCOL --------
+ 
+ // Every message on the portal, AVN Generator and StripePay pipes is a frame:
+ // a FrameHeader followed by payloadLength bytes holding `count` records of
+ // the header's type. Both ends are forks of one binary, so fields use native
+ // byte order. Strings are a uint16 length followed by the bytes. A response
+ // too large for one frame is streamed as several frames with the same
+ // requestId, all but the last flagged FRAME_MORE.
+ //
+ // Records by type:
+ //   AVN_CREATED, QUERY_AVN and QUERY_AIRLINE responses: AVN record
+ //   PAYMENT_REQUEST, PAYMENT_CONFIRMATION: int32 avnId, double amount
+ //   QUERY_AVN request: int32 avnId
+ //   QUERY_AIRLINE request: string airline
+ // A query that matches nothing is answered with a zero-record frame.
+ struct FrameHeader {
+     uint32_t payloadLength;
+     uint16_t type;       // MessageType
+     uint16_t flags;
+     uint32_t count;      // Records in this frame
+     uint32_t requestId;  // Echoed on responses; 0 for notifications
+ };
+ 
+ const uint16_t FRAME_MORE = 1;
+ // Frames no larger than PIPE_BUF are written to a pipe atomically
+ const size_t FRAME_MAX_SIZE = PIPE_BUF;
+ const size_t FRAME_MAX_STRING = 255;
+ 
+ // Builds frames in memory and writes them out in one go. Records of the
+ // same type and requestId share a frame until it reaches FRAME_MAX_SIZE.
+ class FrameWriter {
+ private:
+     vector<char> buffer;
+     FrameHeader header;  // Open frame, copied into place by endFrame()
+     size_t frameStart;   // Header offset of the open frame
+     size_t recordStart;  // Offset of the record being built
+     bool frameOpen;
+     
+     void startFrame(MessageType type, uint32_t requestId) {
+         header = {0, static_cast<uint16_t>(type), 0, 0, requestId};
+         frameStart = buffer.size();
+         buffer.resize(buffer.size() + sizeof(FrameHeader));
+         frameOpen = true;
+     }
+     
+     void putBytes(const void* data, size_t size) {
+         const char* bytes = static_cast<const char*>(data);
+         buffer.insert(buffer.end(), bytes, bytes + size);
+     }
+     
+ public:
+     FrameWriter() : header(), frameStart(0), recordStart(0), frameOpen(false) {
+         buffer.reserve(FRAME_MAX_SIZE);
+     }
+     
+     // Start a record, continuing the open frame when type and requestId match
+     void beginRecord(MessageType type, uint32_t requestId = 0) {
+         if (frameOpen && (header.type != static_cast<uint16_t>(type) || header.requestId != requestId)) {
+             endFrame();
+         }
+         if (!frameOpen) {
+             startFrame(type, requestId);
+         }
+         recordStart = buffer.size();
+     }
+     
+     void putInt(int32_t value) { putBytes(&value, sizeof(value)); }
+     void putUint64(uint64_t value) { putBytes(&value, sizeof(value)); }
+     void putDouble(double value) { putBytes(&value, sizeof(value)); }
+     void putByte(uint8_t value) { putBytes(&value, sizeof(value)); }
+     
+     void putString(const string& value) {
+         uint16_t length = min(value.size(), FRAME_MAX_STRING);
+         putBytes(&length, sizeof(length));
+         putBytes(value.data(), length);
+     }
+     
+     void endRecord() {
+         // Record overflowed the frame: close the frame without it and
+         // carry the record over into a continuation frame
+         if (buffer.size() - frameStart > FRAME_MAX_SIZE && header.count > 0) {
+             vector<char> record(buffer.begin() + recordStart, buffer.end());
+             buffer.resize(recordStart);
+             MessageType type = static_cast<MessageType>(header.type);
+             uint32_t requestId = header.requestId;
+             header.flags |= FRAME_MORE;
+             endFrame();
+             startFrame(type, requestId);
+             buffer.insert(buffer.end(), record.begin(), record.end());
+         }
+         header.count++;
+     }
+     
+     // Close the open frame, if any
+     void endFrame() {
+         if (frameOpen) {
+             header.payloadLength = buffer.size() - frameStart - sizeof(FrameHeader);
+             memcpy(buffer.data() + frameStart, &header, sizeof(header));
+             frameOpen = false;
+         }
+     }
+     
+     // Zero-record frame, e.g. a query that matched nothing
+     void emptyFrame(MessageType type, uint32_t requestId) {
+         endFrame();
+         startFrame(type, requestId);
+         endFrame();
+     }
+     
+     bool empty() const {
+         return buffer.empty();
+     }
+     
+     // Move every finished frame to the end of out, for callers that do
+     // their own (non-blocking) writes
+     void takeBytes(vector<char>& out) {
+         endFrame();
+         out.insert(out.end(), buffer.begin(), buffer.end());
+         buffer.clear();
+     }
+     
+     // Write every finished frame to fd; false if the pipe is gone
+     bool flush(int fd) {
+         endFrame();
+         const char* data = buffer.data();
+         size_t remaining = buffer.size();
+         while (remaining > 0) {
+             ssize_t written = write(fd, data, remaining);
+             if (written <= 0) {
+                 buffer.clear();
+                 return false;
+             }
+             data += written;
+             remaining -= written;
+         }
+         buffer.clear();
+         return true;
+     }
+ };
+ 
+ // Reads the records of one frame's payload
+ class FrameCursor {
+ private:
+     const char* data;
+     size_t remaining;
+     bool valid;
+     
+     bool take(void* out, size_t size) {
+         if (!valid || remaining < size) {
+             valid = false;
+             return false;
+         }
+         memcpy(out, data, size);
+         data += size;
+         remaining -= size;
+         return true;
+     }
+     
+ public:
+     FrameCursor(const char* payload, size_t length) : data(payload), remaining(length), valid(true) {}
+     
+     int32_t getInt() { int32_t value = 0; take(&value, sizeof(value)); return value; }
+     uint64_t getUint64() { uint64_t value = 0; take(&value, sizeof(value)); return value; }
+     double getDouble() { double value = 0; take(&value, sizeof(value)); return value; }
+     uint8_t getByte() { uint8_t value = 0; take(&value, sizeof(value)); return value; }
+     
+     string getString() {
+         uint16_t length = 0;
+         if (!take(&length, sizeof(length)) || remaining < length) {
+             valid = false;
+             return string();
+         }
+         string value(data, length);
+         data += length;
+         remaining -= length;
+         return value;
+     }
+     
+     // False once a read ran past the payload
+     bool ok() const {
+         return valid;
+     }
+ };
+ 
+ // Reassembles frames from a pipe that may deliver them in pieces
+ class FrameReader {
+ private:
+     int fd;
+     vector<char> buffer;
+     size_t filled;
+     size_t consumed;
+     
+ public:
+     explicit FrameReader(int fd) : fd(fd), buffer(2 * FRAME_MAX_SIZE), filled(0), consumed(0) {}
+     
+     // One read() of whatever the pipe holds; false on EOF or error
+     bool fill() {
+         // Drop frames already handed out
+         memmove(buffer.data(), buffer.data() + consumed, filled - consumed);
+         filled -= consumed;
+         consumed = 0;
+         if (filled == buffer.size()) {
+             buffer.resize(buffer.size() * 2);
+         }
+         
+         ssize_t bytesRead = read(fd, buffer.data() + filled, buffer.size() - filled);
+         if (bytesRead <= 0) {
+             return false;
+         }
+         filled += bytesRead;
+         return true;
+     }
+     
+     // Next complete frame; the cursor stays valid until the next fill()
+     bool next(FrameHeader& header, FrameCursor& cursor) {
+         if (filled - consumed < sizeof(FrameHeader)) {
+             return false;
+         }
+         memcpy(&header, buffer.data() + consumed, sizeof(header));
+         size_t frameSize = sizeof(FrameHeader) + header.payloadLength;
+         if (filled - consumed < frameSize) {
+             if (frameSize > buffer.size()) {
+                 buffer.resize(frameSize);
+             }
+             return false;
+         }
+         cursor = FrameCursor(buffer.data() + consumed + sizeof(FrameHeader), header.payloadLength);
+         consumed += frameSize;
+         return true;
+     }
+     
+     int getFd() const {
+         return fd;
+     }
+ };
+ 
+ // Frames waiting for a non-blocking pipe or socket. A write never stalls the
+ // caller: what the fd cannot take stays queued, and EPOLLOUT is armed on the
+ // caller's epoll set only while something is.
+ class FrameOutbox {
+ private:
+     int fd;
+     uint32_t readEvents; // Events fd is already registered for when it is also read, else 0
+     vector<char> pending;
+     bool watching;
+     
+ public:
+     explicit FrameOutbox(int fd = -1, uint32_t readEvents = 0) : fd(fd), readEvents(readEvents), watching(false) {}
+     
+     void queue(FrameWriter& frames) {
+         frames.takeBytes(pending);
+     }
+     
+     // Write what the fd will take; false once the reader is gone
+     bool flush(int epollFd) {
+         size_t sent = 0;
+         bool open = fd >= 0;
+         while (open && sent < pending.size()) {
+             ssize_t written = write(fd, pending.data() + sent, pending.size() - sent);
+             if (written > 0) {
+                 sent += written;
+             } else if (written < 0 && errno == EINTR) {
+                 continue;
+             } else if (written < 0 && errno == EAGAIN) {
+                 break;
+             } else {
+                 open = false;
+             }
+         }
+         pending.erase(pending.begin(), open ? pending.begin() + sent : pending.end());
+         
+         bool wantWritable = open && !pending.empty();
+         if (wantWritable != watching) {
+             epoll_event event = {};
+             event.events = readEvents | (wantWritable ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+             event.data.fd = fd;
+             int op = readEvents ? EPOLL_CTL_MOD : (wantWritable ? EPOLL_CTL_ADD : EPOLL_CTL_DEL);
+             epoll_ctl(epollFd, op, fd, &event);
+             watching = wantWritable;
+         }
+         if (!open) {
+             fd = -1;
+         }
+         return open;
+     }
+     
+     size_t size() const {
+         return pending.size();
+     }
+     
+     int getFd() const {
+         return fd;
+     }
+ };
+ 
+ // AVN as carried in AVN_CREATED and query responses
+ struct AVNRecord {
+     int id;
+     string airline;
+     string flightNumber;
+     FlightType aircraftType;
+     int recordedSpeed;
+     int permissibleSpeedMin;
+     int permissibleSpeedMax;
+     double totalAmount;
+     PaymentStatus status;
+     uint64_t detectedAtNs;
+     
+     static void write(FrameWriter& writer, const AVN& avn) {
+         writer.putInt(avn.id);
+         writer.putString(avn.airline);
+         writer.putString(avn.flightNumber);
+         writer.putByte(static_cast<uint8_t>(avn.aircraftType));
+         writer.putInt(avn.recordedSpeed);
+         writer.putInt(avn.permissibleSpeedMin);
+         writer.putInt(avn.permissibleSpeedMax);
+         writer.putDouble(avn.totalAmount);
+         writer.putByte(static_cast<uint8_t>(avn.status));
+         writer.putUint64(avn.detectedAtNs);
+     }
+     
+     static AVNRecord read(FrameCursor& cursor) {
+         AVNRecord record;
+         record.id = cursor.getInt();
+         record.airline = cursor.getString();
+         record.flightNumber = cursor.getString();
+         record.aircraftType = static_cast<FlightType>(cursor.getByte());
+         record.recordedSpeed = cursor.getInt();
+         record.permissibleSpeedMin = cursor.getInt();
+         record.permissibleSpeedMax = cursor.getInt();
+         record.totalAmount = cursor.getDouble();
+         record.status = static_cast<PaymentStatus>(cursor.getByte());
+         record.detectedAtNs = cursor.getUint64();
+         return record;
+     }
+ };
+ 
+ // Interned airline table. Flights carry an index into it and refer to the
+ // one copy of the name held here. Listed in name order, the order flights
+ // have always drawn airlines in, so a seed still spawns the same schedule.
+ enum AirlineId : uint8_t {
+     AGHAKHAN_AIR_AMBULANCE, AIRBLUE, BLUE_DART, FEDEX, PIA, PAKISTAN_AIRFORCE, AIRLINE_COUNT
+ };
+ 
+ struct AirlineProfile {
+     string name;
+     int totalAircrafts;
+     int activeFlights;
+     bool cargo; // Non-emergency flights are cargo
+ };
+ 
+ const AirlineProfile AIRLINE_PROFILES[AIRLINE_COUNT] = {
+     {"AghaKhan Air Ambulance", 2, 1, false},
+     {"AirBlue", 4, 4, false},
+     {"Blue Dart", 2, 2, true},
+     {"FedEx", 3, 2, true},
+     {"PIA", 6, 4, false},
+     {"Pakistan Airforce", 2, 1, false},
+ };
+ 
+ // Id of the airline with this name, AIRLINE_COUNT if none
+ inline AirlineId airlineIdOf(const char* name) {
+     for (int id = 0; id < AIRLINE_COUNT; id++) {
+         if (AIRLINE_PROFILES[id].name == name) {
+             return static_cast<AirlineId>(id);
+         }
+     }
+     return AIRLINE_COUNT;
+ }
+ 
+ // -------- AVN LEDGER --------
+ 
+ // One AVN as stored in the ledger file. Fixed size, no pointers; status is
+ // the only field written after the record is appended.
+ struct LedgerRecord {
+     int32_t id;
+     uint8_t aircraftType;    // FlightType
+     atomic<uint8_t> status;  // PaymentStatus, flipped in place
+     uint8_t airlineId;       // AirlineId, AIRLINE_COUNT for a name not in AIRLINE_PROFILES
+     uint8_t reserved;
+     int32_t recordedSpeed;
+     int32_t permissibleSpeedMin;
+     int32_t permissibleSpeedMax;
+     int32_t previousOfAirline; // Index of the airline's previous record, -1 for its first
+     int64_t issueTime;
+     int64_t dueDate;
+     double fineAmount;
+     double serviceFee;
+     double totalAmount;
+     uint64_t detectedAtNs;
+     char airline[40];
+     char flightNumber[16];
+     
+     // Rebuild the AVN, e.g. for printDetails()
+     AVN toAVN() const {
+         AVN avn(id, airline, flightNumber, static_cast<FlightType>(aircraftType),
+                 recordedSpeed, permissibleSpeedMin, permissibleSpeedMax);
+         avn.issueTime = issueTime;
+         avn.dueDate = dueDate;
+         avn.fineAmount = fineAmount;
+         avn.serviceFee = serviceFee;
+         avn.totalAmount = totalAmount;
+         avn.status = static_cast<PaymentStatus>(status.load(memory_order_acquire));
+         avn.detectedAtNs = detectedAtNs;
+         return avn;
+     }
+     
+     AVNRecord toRecord() const {
+         AVNRecord record;
+         record.id = id;
+         record.airline = airline;
+         record.flightNumber = flightNumber;
+         record.aircraftType = static_cast<FlightType>(aircraftType);
+         record.recordedSpeed = recordedSpeed;
+         record.permissibleSpeedMin = permissibleSpeedMin;
+         record.permissibleSpeedMax = permissibleSpeedMax;
+         record.totalAmount = totalAmount;
+         record.status = static_cast<PaymentStatus>(status.load(memory_order_acquire));
+         record.detectedAtNs = detectedAtNs;
+         return record;
+     }
+ };
+ 
+ static_assert(sizeof(LedgerRecord) == 128, "ledger records are a fixed on-disk size");
+ static_assert(atomic<uint8_t>::is_always_lock_free, "ledger status must be lock-free to share across processes");
+ 
+ // Append-only AVN ledger: a header page followed by LedgerRecords, mapped
+ // MAP_SHARED. It is opened before fork(); the AVN Generator appends and
+ // flips payment status, and the other processes call makeReadOnly().
+ // Records are written before count is published, so a crash mid-append
+ // leaves a torn record past count that the next append overwrites. AVN ids
+ // are appended in increasing order, so lookups are a binary search.
+ // Each airline's records are chained newest to oldest from a tail in the
+ // header, so an airline query walks only that airline's AVNs. The header
+ // also keeps the unpaid count and a log of the latest payments, which
+ // readers follow from a cursor instead of rescanning statuses.
+ // Without a path the ledger is anonymous and lasts only for the run.
+ class AVNLedger {
+ public:
+     static constexpr uint64_t CAPACITY = 1 << 20;    // Records mapped for a new ledger
+     static constexpr uint64_t GROW_RECORDS = 4096;   // File growth step
+     static constexpr size_t HEADER_BYTES = 4096;
+     static constexpr int FIRST_AVN_ID = 1000;
+     static constexpr uint64_t PAID_LOG_SIZE = 256;   // Payments a reader may fall behind by
+     
+ private:
+     // One chain per airline, plus one for names outside AIRLINE_PROFILES
+     static constexpr int AIRLINE_CHAINS = AIRLINE_COUNT + 1;
+     
+     struct Header {
+         char magic[8];
+         uint32_t version;
+         uint32_t recordSize;
+         uint64_t capacity;
+         atomic<uint64_t> count;  // Records published
+         atomic<uint64_t> unpaid; // Published records not yet paid
+         uint64_t linked;         // Records [0, linked) are on their chain and in unpaid
+         atomic<int32_t> airlineTail[AIRLINE_CHAINS]; // Newest record per chain, -1 for none
+         atomic<uint64_t> paidSequence;               // Payments logged so far
+         atomic<int32_t> paidLog[PAID_LOG_SIZE];      // AVN id of payment n at n % PAID_LOG_SIZE
+     };
+     
+     static constexpr char MAGIC[8] = {'A', 'C', 'X', 'L', 'E', 'D', 'G', 'R'};
+     static constexpr uint32_t VERSION = 2;
+     static_assert(sizeof(Header) <= HEADER_BYTES, "ledger header must fit its page");
+     
+     Header* header;
+     LedgerRecord* records;
+     size_t mappedBytes;
+     int fd;                // File-backed writers only
+     uint64_t fileRecords;  // Records the file currently has room for
+     
+     static size_t bytesFor(uint64_t recordCount) {
+         return HEADER_BYTES + recordCount * sizeof(LedgerRecord);
+     }
+     
+     bool map(int flags, uint64_t capacity) {
+         mappedBytes = bytesFor(capacity);
+         void* memory = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, flags, fd, 0);
+         if (memory == MAP_FAILED) {
+             cerr << "AVN ledger mmap failed: " << strerror(errno) << endl;
+             return false;
+         }
+         header = static_cast<Header*>(memory);
+         records = reinterpret_cast<LedgerRecord*>(static_cast<char*>(memory) + HEADER_BYTES);
+         return true;
+     }
+     
+     void initHeader(uint64_t capacity) {
+         memcpy(header->magic, MAGIC, sizeof(MAGIC));
+         header->version = VERSION;
+         header->recordSize = sizeof(LedgerRecord);
+         header->capacity = capacity;
+         header->count.store(0, memory_order_release);
+         header->unpaid.store(0, memory_order_relaxed);
+         header->linked = 0;
+         for (auto& tail : header->airlineTail) {
+             tail.store(-1, memory_order_relaxed);
+         }
+         header->paidSequence.store(0, memory_order_release);
+     }
+     
+     // Writer: make published record index its chain's tail and count it in
+     // unpaid. Its previousOfAirline already holds the old tail.
+     void link(uint64_t index) {
+         const LedgerRecord& record = records[index];
+         atomic<int32_t>& tail = header->airlineTail[record.airlineId];
+         tail.store(static_cast<int32_t>(index), memory_order_release);
+         if (record.status.load(memory_order_relaxed) != static_cast<uint8_t>(PaymentStatus::PAID)) {
+             header->unpaid.fetch_add(1, memory_order_relaxed);
+         }
+         header->linked = index + 1;
+     }
+     
+     // Writer, on open: finish linking records published before a crash, or
+     // rebuild every chain if the published count was cut back past them
+     void repairChains() {
+         uint64_t count = header->count.load(memory_order_acquire);
+         if (header->linked > count) {
+             header->linked = 0;
+             header->unpaid.store(0, memory_order_relaxed);
+             for (auto& tail : header->airlineTail) {
+                 tail.store(-1, memory_order_relaxed);
+             }
+         }
+         for (uint64_t index = header->linked; index < count; index++) {
+             records[index].previousOfAirline = header->airlineTail[records[index].airlineId].load(memory_order_relaxed);
+             link(index);
+         }
+     }
+     
+     void release() {
+         if (header) {
+             if (fd >= 0) {
+                 msync(header, bytesFor(size()), MS_SYNC);
+             }
+             munmap(header, mappedBytes);
+             header = nullptr;
+             records = nullptr;
+         }
+         if (fd >= 0) {
+             ::close(fd);
+             fd = -1;
+         }
+     }
+     
+ public:
+     AVNLedger() : header(nullptr), records(nullptr), mappedBytes(0), fd(-1), fileRecords(0) {}
+     
+     ~AVNLedger() {
+         release();
+     }
+     
+     AVNLedger(const AVNLedger&) = delete;
+     AVNLedger& operator=(const AVNLedger&) = delete;
+     
+     // Shared anonymous ledger for a run without a ledger file
+     bool openAnonymous() {
+         release();
+         if (!map(MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, CAPACITY)) {
+             return false;
+         }
+         fileRecords = CAPACITY;
+         initHeader(CAPACITY);
+         return true;
+     }
+     
+     // Open or create a ledger file. An existing file is mapped as it is:
+     // nothing is parsed, and records past the published count are dropped.
+     bool open(const string& path) {
+         release();
+         fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+         if (fd < 0) {
+             cerr << "Cannot open AVN ledger " << path << ": " << strerror(errno) << endl;
+             return false;
+         }
+         if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+             cerr << "AVN ledger " << path << " is in use by another run" << endl;
+             release();
+             return false;
+         }
+         
+         struct stat info;
+         if (fstat(fd, &info) != 0) {
+             cerr << "Cannot stat AVN ledger " << path << ": " << strerror(errno) << endl;
+             release();
+             return false;
+         }
+         
+         if (info.st_size == 0) {
+             // New ledger
+             if (ftruncate(fd, bytesFor(GROW_RECORDS)) != 0 || !map(MAP_SHARED, CAPACITY)) {
+                 cerr << "Cannot create AVN ledger " << path << endl;
+                 release();
+                 return false;
+             }
+             fileRecords = GROW_RECORDS;
+             initHeader(CAPACITY);
+             return true;
+         }
+         
+         Header existing;
+         if (static_cast<size_t>(info.st_size) < HEADER_BYTES ||
+             pread(fd, &existing, sizeof(existing), 0) != static_cast<ssize_t>(sizeof(existing)) ||
+             memcmp(existing.magic, MAGIC, sizeof(MAGIC)) != 0 || existing.version != VERSION ||
+             existing.recordSize != sizeof(LedgerRecord)) {
+             cerr << "AVN ledger " << path << " is not a version " << VERSION << " ledger" << endl;
+             release();
+             return false;
+         }
+         if (!map(MAP_SHARED, existing.capacity)) {
+             release();
+             return false;
+         }
+         fileRecords = (info.st_size - HEADER_BYTES) / sizeof(LedgerRecord);
+         uint64_t published = header->count.load(memory_order_acquire);
+         if (published > fileRecords) {
+             header->count.store(fileRecords, memory_order_release);
+         }
+         repairChains();
+         return true;
+     }
+     
+     // Drop write access in this process; later appends are the writer's
+     void makeReadOnly() {
+         if (header) {
+             mprotect(header, mappedBytes, PROT_READ);
+         }
+         if (fd >= 0) {
+             ::close(fd);
+             fd = -1;
+         }
+     }
+     
+     bool valid() const {
+         return header != nullptr;
+     }
+     
+     size_t size() const {
+         return header ? header->count.load(memory_order_acquire) : 0;
+     }
+     
+     size_t capacity() const {
+         return header ? header->capacity : 0;
+     }
+     
+     const LedgerRecord& at(size_t index) const {
+         return records[index];
+     }
+     
+     // Id the next appended AVN should carry
+     int nextId() const {
+         size_t count = size();
+         return count ? records[count - 1].id + 1 : FIRST_AVN_ID;
+     }
+     
+     // Writer: append an AVN; false if the ledger is full or cannot grow
+     bool append(const AVN& avn) {
+         uint64_t count = header->count.load(memory_order_relaxed);
+         if (count >= header->capacity) {
+             return false;
+         }
+         if (count >= fileRecords) {
+             uint64_t grown = min<uint64_t>(fileRecords + GROW_RECORDS, header->capacity);
+             if (ftruncate(fd, bytesFor(grown)) != 0) {
+                 return false;
+             }
+             fileRecords = grown;
+         }
+         
+         LedgerRecord& record = records[count];
+         record.id = avn.id;
+         record.aircraftType = static_cast<uint8_t>(avn.aircraftType);
+         record.status.store(static_cast<uint8_t>(avn.status), memory_order_relaxed);
+         record.airlineId = airlineIdOf(avn.airline.c_str());
+         record.reserved = 0;
+         record.recordedSpeed = avn.recordedSpeed;
+         record.permissibleSpeedMin = avn.permissibleSpeedMin;
+         record.permissibleSpeedMax = avn.permissibleSpeedMax;
+         record.previousOfAirline = header->airlineTail[record.airlineId].load(memory_order_relaxed);
+         record.issueTime = avn.issueTime;
+         record.dueDate = avn.dueDate;
+         record.fineAmount = avn.fineAmount;
+         record.serviceFee = avn.serviceFee;
+         record.totalAmount = avn.totalAmount;
+         record.detectedAtNs = avn.detectedAtNs;
+         strncpy(record.airline, avn.airline.c_str(), sizeof(record.airline) - 1);
+         record.airline[sizeof(record.airline) - 1] = '\0';
+         strncpy(record.flightNumber, avn.flightNumber.c_str(), sizeof(record.flightNumber) - 1);
+         record.flightNumber[sizeof(record.flightNumber) - 1] = '\0';
+         
+         header->count.store(count + 1, memory_order_release);
+         link(count);
+         return true;
+     }
+     
+     const LedgerRecord* find(int id) const {
+         const LedgerRecord* begin = records;
+         const LedgerRecord* end = records + size();
+         const LedgerRecord* it = lower_bound(begin, end, id, [](const LedgerRecord& record, int value) {
+             return record.id < value;
+         });
+         return (it != end && it->id == id) ? it : nullptr;
+     }
+     
+     // Writer: flip an AVN to paid and log the payment; false if unknown
+     bool markPaid(int id) {
+         LedgerRecord* record = const_cast<LedgerRecord*>(find(id));
+         if (!record) {
+             return false;
+         }
+         uint8_t previous = record->status.exchange(static_cast<uint8_t>(PaymentStatus::PAID), memory_order_acq_rel);
+         if (previous != static_cast<uint8_t>(PaymentStatus::PAID)) {
+             header->unpaid.fetch_sub(1, memory_order_relaxed);
+             uint64_t sequence = header->paidSequence.load(memory_order_relaxed);
+             header->paidLog[sequence % PAID_LOG_SIZE].store(id, memory_order_relaxed);
+             header->paidSequence.store(sequence + 1, memory_order_release);
+         }
+         return true;
+     }
+     
+     // Visit an airline's AVNs in issue order, walking only its chain;
+     // returns how many matched
+     template <typename Visitor>
+     int forEachByAirline(const string& airline, Visitor visit) const {
+         if (!header) {
+             return 0;
+         }
+         AirlineId chain = airlineIdOf(airline.c_str());
+         vector<int32_t> matches;
+         for (int32_t index = header->airlineTail[chain].load(memory_order_acquire); index >= 0;
+              index = records[index].previousOfAirline) {
+             // Names outside AIRLINE_PROFILES share a chain
+             if (chain != AIRLINE_COUNT || airline == records[index].airline) {
+                 matches.push_back(index);
+             }
+         }
+         for (auto it = matches.rbegin(); it != matches.rend(); ++it) {
+             visit(records[*it]);
+         }
+         return static_cast<int>(matches.size());
+     }
+     
+     size_t countUnpaid() const {
+         return header ? header->unpaid.load(memory_order_relaxed) : 0;
+     }
+     
+     // Payments logged so far; a reader starts its cursor here
+     uint64_t paidSequence() const {
+         return header ? header->paidSequence.load(memory_order_acquire) : 0;
+     }
+     
+     // Visit the ids paid since cursor, oldest first, and move cursor past
+     // them. False, with cursor moved to the end, if more than PAID_LOG_SIZE
+     // payments came in since: the caller must check statuses itself.
+     template <typename Visitor>
+     bool forEachPaidSince(uint64_t& cursor, Visitor visit) const {
+         uint64_t end = paidSequence();
+         if (end - cursor > PAID_LOG_SIZE) {
+             cursor = end;
+             return false;
+         }
+         int32_t paid[PAID_LOG_SIZE];
+         size_t taken = 0;
+         for (uint64_t sequence = cursor; sequence < end; sequence++) {
+             paid[taken++] = header->paidLog[sequence % PAID_LOG_SIZE].load(memory_order_relaxed);
+         }
+         // The writer may have lapped the slots while they were read
+         if (paidSequence() - cursor > PAID_LOG_SIZE) {
+             cursor = paidSequence();
+             return false;
+         }
+         cursor = end;
+         for (size_t i = 0; i < taken; i++) {
+             visit(paid[i]);
+         }
+         return true;
+     }
+ };
+ 
+ // Airline class
+ class Airline {
+ public:
+     string name;
+     int totalAircrafts;
+     int activeFlights;
+     deque<shared_ptr<AVN>> violations; // The latest violationLimit of them
+     size_t violationLimit; // 0 = unlimited
+     int totalViolations;
+     mutex violationsMutex; // Mutex for AVN data
+     
+     Airline(const string& name, int totalAircrafts, int activeFlights)
+         : name(name), totalAircrafts(totalAircrafts), activeFlights(activeFlights),
+           violationLimit(AVN_RETENTION), totalViolations(0) {}
+     
+     void addViolation(shared_ptr<AVN> violation) {
+         lock_guard<mutex> lock(violationsMutex);
+         violations.push_back(violation);
+         totalViolations++;
+         if (violationLimit > 0 && violations.size() > violationLimit) {
+             violations.pop_front();
+         }
+     }
+ 
+     void printViolations() const {
+         lock_guard<mutex> lock(cout_mutex);
+         cout << "==== Violations for " << name << " ====" << endl;
+         
+         if (violations.empty()) {
+             cout << "No violations recorded." << endl;
+         } else {
+             if (static_cast<size_t>(totalViolations) > violations.size()) {
+                 cout << "Latest " << violations.size() << " of " << totalViolations << " violations:" << endl;
+             }
+             for (const auto& avn : violations) {
+                 cout << "AVN ID: " << avn->id << " | Flight: " << avn->flightNumber 
+                      << " | Status: " << avn->getStatusString() 
+                      << " | Amount: PKR " << fixed << setprecision(2) << avn->totalAmount << endl;
+             }
+         }
+         cout << "================================" << endl;
+     }
+ };
+ 
+ // Flight number ("PI-1042") stored inline, so creating a flight formats it
+ // without touching the heap. Same size as the IPC flightNumber field.
+ struct FlightNumber {
+     char text[16];
+     
+     FlightNumber() {
+         text[0] = '\0';
+     }
+     
+     // First two letters of the airline, a dash, then the number
+     FlightNumber(const string& airline, unsigned number) {
+         size_t length = min<size_t>(airline.size(), 2);
+         memcpy(text, airline.data(), length);
+         text[length++] = '-';
+         *to_chars(text + length, text + sizeof(text) - 1, number).ptr = '\0';
+     }
+     
+     const char* c_str() const {
+         return text;
+     }
+     
+     string str() const {
+         return text;
+     }
+ };
+ 
+ inline ostream& operator<<(ostream& out, const FlightNumber& number) {
+     return out << number.text;
+ }
+ 
+ // -------- FLIGHT SCHEDULE FILES --------
+ 
+ // A timetable to fly instead of the fixed-interval streams: CSV rows of
+ //   time,direction,airline,type[,flight]
+ // time is simulated seconds from the start of the run and must not go
+ // backwards. direction is North/South (arrivals) or East/West (departures).
+ // airline is one of AIRLINE_PROFILES, type Commercial, Cargo or Emergency
+ // (only the first letter of either is read). Without a flight column
+ // flights are numbered like generated ones. Blank lines, lines starting
+ // with '#' and a header line are skipped.
+ struct ScheduledFlight {
+     int time;
+     Direction direction;
+     AirlineId airline;
+     FlightType type;
+     FlightNumber flightNumber; // Empty when the row has none
+ };
+ 
+ const size_t SCHEDULE_RELEASE_BYTES = 16 << 20; // Parsed input handed back to the kernel in steps of this size
+ const size_t SCHEDULE_ERRORS_SHOWN = 10;
+ 
+ // Reads a timetable straight out of a read-only mapping, one row ahead of
+ // the simulation, so a file of any length costs a row's worth of memory
+ // plus whatever pages are in flight. Parsed pages are dropped as it goes.
+ class ScheduleLoader {
+ private:
+     int fd;
+     const char* data;
+     size_t size;
+     size_t offset;      // Start of the next unparsed line
+     size_t released;    // Bytes before this have been dropped from the mapping
+     size_t lineNumber;
+     string path;
+     ScheduledFlight pending;
+     bool hasPending;
+     int lastTime;
+     size_t rowsRead;
+     size_t rowsRejected;
+     
+     static bool sameText(const char* begin, const char* end, const string& text) {
+         if (static_cast<size_t>(end - begin) != text.size()) {
+             return false;
+         }
+         for (size_t i = 0; i < text.size(); i++) {
+             if (tolower(static_cast<unsigned char>(begin[i])) != tolower(static_cast<unsigned char>(text[i]))) {
+                 return false;
+             }
+         }
+         return true;
+     }
+     
+     // Next comma-separated field of [cursor, end), spaces trimmed
+     static bool nextField(const char*& cursor, const char* end, const char*& fieldBegin, const char*& fieldEnd) {
+         if (cursor > end) {
+             return false;
+         }
+         const char* comma = static_cast<const char*>(memchr(cursor, ',', end - cursor));
+         fieldBegin = cursor;
+         fieldEnd = comma ? comma : end;
+         cursor = fieldEnd + 1;
+         while (fieldBegin < fieldEnd && isspace(static_cast<unsigned char>(*fieldBegin))) fieldBegin++;
+         while (fieldEnd > fieldBegin && isspace(static_cast<unsigned char>(fieldEnd[-1]))) fieldEnd--;
+         return true;
+     }
+     
+     // Parse one line; returns the reason when it is not a valid row
+     const char* parseRow(const char* begin, const char* end, ScheduledFlight& row) {
+         const char* cursor = begin;
+         const char* field;
+         const char* fieldEnd;
+         
+         if (!nextField(cursor, end, field, fieldEnd) ||
+             from_chars(field, fieldEnd, row.time).ptr != fieldEnd || field == fieldEnd || row.time < 0) {
+             return "bad time";
+         }
+         
+         if (!nextField(cursor, end, field, fieldEnd) || field == fieldEnd) {
+             return "missing direction";
+         }
+         switch (toupper(static_cast<unsigned char>(*field))) {
+             case 'N': row.direction = Direction::NORTH; break;
+             case 'S': row.direction = Direction::SOUTH; break;
+             case 'E': row.direction = Direction::EAST; break;
+             case 'W': row.direction = Direction::WEST; break;
+             default: return "bad direction";
+         }
+         
+         if (!nextField(cursor, end, field, fieldEnd)) {
+             return "missing airline";
+         }
+         row.airline = AIRLINE_COUNT;
+         for (int id = 0; id < AIRLINE_COUNT; id++) {
+             if (sameText(field, fieldEnd, AIRLINE_PROFILES[id].name)) {
+                 row.airline = static_cast<AirlineId>(id);
+                 break;
+             }
+         }
+         if (row.airline == AIRLINE_COUNT) {
+             return "unknown airline";
+         }
+         
+         if (!nextField(cursor, end, field, fieldEnd) || field == fieldEnd) {
+             return "missing type";
+         }
+         switch (toupper(static_cast<unsigned char>(*field))) {
+             case 'C': row.type = (fieldEnd - field > 1 && toupper(static_cast<unsigned char>(field[1])) == 'A')
+                                  ? FlightType::CARGO : FlightType::COMMERCIAL; break;
+             case 'E': row.type = FlightType::EMERGENCY; break;
+             default: return "bad type";
+         }
+         
+         row.flightNumber = FlightNumber();
+         if (nextField(cursor, end, field, fieldEnd) && field < fieldEnd) {
+             size_t length = min<size_t>(fieldEnd - field, sizeof(row.flightNumber.text) - 1);
+             memcpy(row.flightNumber.text, field, length);
+             row.flightNumber.text[length] = '\0';
+         }
+         return nullptr;
+     }
+     
+     void reject(const char* reason) {
+         rowsRejected++;
+         if (rowsRejected <= SCHEDULE_ERRORS_SHOWN) {
+             cerr << path << ":" << lineNumber << ": " << reason << ", row skipped" << endl;
+         }
+     }
+     
+     // Parse forward to the next valid row
+     void advance() {
+         hasPending = false;
+         while (!hasPending && offset < size) {
+             const char* begin = data + offset;
+             const char* newline = static_cast<const char*>(memchr(begin, '\n', size - offset));
+             const char* end = newline ? newline : data + size;
+             offset = (end - data) + 1;
+             lineNumber++;
+             if (end > begin && end[-1] == '\r') {
+                 end--;
+             }
+             
+             const char* first = begin;
+             while (first < end && isspace(static_cast<unsigned char>(*first))) first++;
+             if (first == end || *first == '#' || (lineNumber == 1 && isalpha(static_cast<unsigned char>(*first)))) {
+                 continue;
+             }
+             
+             const char* error = parseRow(first, end, pending);
+             if (!error && pending.time < lastTime) {
+                 error = "time goes backwards";
+             }
+             if (error) {
+                 reject(error);
+                 continue;
+             }
+             lastTime = pending.time;
+             rowsRead++;
+             hasPending = true;
+         }
+         
+         // Hand parsed pages back rather than letting a long file pile up in memory
+         if (offset - released >= SCHEDULE_RELEASE_BYTES) {
+             size_t page = sysconf(_SC_PAGESIZE);
+             size_t upTo = min(offset, size) / page * page;
+             madvise(const_cast<char*>(data) + released, upTo - released, MADV_DONTNEED);
+             released = upTo;
+         }
+     }
+     
+ public:
+     ScheduleLoader() : fd(-1), data(nullptr), size(0), offset(0), released(0), lineNumber(0), pending(),
+                        hasPending(false), lastTime(0), rowsRead(0), rowsRejected(0) {}
+     
+     ~ScheduleLoader() {
+         if (data) {
+             munmap(const_cast<char*>(data), size);
+         }
+         if (fd >= 0) {
+             ::close(fd);
+         }
+     }
+     
+     ScheduleLoader(const ScheduleLoader&) = delete;
+     ScheduleLoader& operator=(const ScheduleLoader&) = delete;
+     
+     // Map a timetable and read its first row; prints the reason on failure
+     bool open(const string& schedulePath) {
+         path = schedulePath;
+         fd = ::open(path.c_str(), O_RDONLY);
+         struct stat info;
+         if (fd < 0 || fstat(fd, &info) != 0) {
+             cerr << "Cannot open schedule " << path << ": " << strerror(errno) << endl;
+             return false;
+         }
+         size = info.st_size;
+         if (size > 0) {
+             void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+             if (mapping == MAP_FAILED) {
+                 cerr << "Cannot map schedule " << path << ": " << strerror(errno) << endl;
+                 size = 0;
+                 return false;
+             }
+             data = static_cast<const char*>(mapping);
+             madvise(mapping, size, MADV_SEQUENTIAL);
+         }
+         advance();
+         return true;
+     }
+     
+     // Time of the next row, or -1 once the timetable is exhausted
+     int peekTime() const {
+         return hasPending ? pending.time : -1;
+     }
+     
+     bool next(ScheduledFlight& row) {
+         if (!hasPending) {
+             return false;
+         }
+         row = pending;
+         advance();
+         return true;
+     }
+     
+     size_t getRowsRead() const {
+         return rowsRead;
+     }
+     
+     size_t getRowsRejected() const {
+         return rowsRejected;
+     }
+ };
+ 
+ // -------- SIMULATION TRACE --------
+ 
+ // A trace holds every random outcome of a run, so the run can be replayed
+ // without the RNG. The file is a TraceHeader followed by fixed-size
+ // TraceRecords in tick order, native byte order like the pipe frames.
+ // Within a tick, spawns come first, then runway events, then the flights'
+ // own outcomes in active-list order.
+ //
+ // Records by kind:
+ //   SPAWN: a = stream | emergency << 2 | airline << 3, b = initial speed,
+ //          value = run seed keying the flight's random stream
+ //   SPEED: value = speed drawn on entering a state
+ //   VIOLATION: value = injected violation speed
+ //   RUNWAY_ASSIGN, RUNWAY_RELEASE: a = runway
+ // aircraftId is the flight the record is about (for SPAWN, the id it gets).
+ enum TraceKind : uint8_t { TRACE_SPAWN, TRACE_SPEED, TRACE_VIOLATION, TRACE_RUNWAY_ASSIGN, TRACE_RUNWAY_RELEASE };
+ 
+ struct TraceRecord {
+     uint32_t tick;
+     int32_t aircraftId;
+     uint8_t kind;   // TraceKind
+     uint8_t a;
+     uint16_t b;
+     uint32_t value;
+     
+     bool operator==(const TraceRecord& other) const {
+         return tick == other.tick && aircraftId == other.aircraftId && kind == other.kind &&
+                a == other.a && b == other.b && value == other.value;
+     }
+ };
+ static_assert(sizeof(TraceRecord) == 16, "TraceRecord must stay 16 bytes");
+ 
+ struct TraceHeader {
+     char magic[8];      // "ACXTRACE"
+     uint32_t version;
+     uint32_t recordSize;
+     uint32_t seed;      // Of the recorded run, for reference
+     int32_t duration;   // Simulated seconds recorded
+ };
+ 
+ const char TRACE_MAGIC[8] = {'A', 'C', 'X', 'T', 'R', 'A', 'C', 'E'};
+ const uint32_t TRACE_VERSION = 1;
+ const size_t TRACE_BUFFER_RECORDS = 4096; // Records per write() or read()
+ 
+ // Buffers records and writes them out TRACE_BUFFER_RECORDS at a time
+ class TraceWriter {
+ private:
+     int fd;
+     vector<TraceRecord> buffer;
+     size_t recordCount;
+     bool failed;
+     
+     bool writeAll(const void* data, size_t size) {
+         const char* bytes = static_cast<const char*>(data);
+         while (size > 0) {
+             ssize_t written = write(fd, bytes, size);
+             if (written <= 0) {
+                 if (written < 0 && errno == EINTR) {
+                     continue;
+                 }
+                 return false;
+             }
+             bytes += written;
+             size -= written;
+         }
+         return true;
+     }
+     
+     void flush() {
+         if (!buffer.empty() && !failed && !writeAll(buffer.data(), buffer.size() * sizeof(TraceRecord))) {
+             cerr << "Trace write failed: " << strerror(errno) << endl;
+             failed = true;
+         }
+         buffer.clear();
+     }
+     
+ public:
+     TraceWriter() : fd(-1), recordCount(0), failed(false) {
+         buffer.reserve(TRACE_BUFFER_RECORDS);
+     }
+     
+     ~TraceWriter() {
+         finish();
+     }
+     
+     // Create path (truncating it) and write the header
+     bool create(const string& path, uint32_t seed, int duration) {
+         fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+         if (fd < 0) {
+             cerr << "Cannot create trace " << path << ": " << strerror(errno) << endl;
+             return false;
+         }
+         TraceHeader header = {};
+         memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+         header.version = TRACE_VERSION;
+         header.recordSize = sizeof(TraceRecord);
+         header.seed = seed;
+         header.duration = duration;
+         if (!writeAll(&header, sizeof(header))) {
+             cerr << "Cannot write trace " << path << ": " << strerror(errno) << endl;
+             failed = true;
+             return false;
+         }
+         return true;
+     }
+     
+     void add(const TraceRecord& record) {
+         buffer.push_back(record);
+         recordCount++;
+         if (buffer.size() == TRACE_BUFFER_RECORDS) {
+             flush();
+         }
+     }
+     
+     // Write what is buffered and close; false if any write failed
+     bool finish() {
+         if (fd >= 0) {
+             flush();
+             ::close(fd);
+             fd = -1;
+         }
+         return !failed;
+     }
+     
+     size_t getRecordCount() const {
+         return recordCount;
+     }
+ };
+ 
+ // Streams records back from a trace file, TRACE_BUFFER_RECORDS at a time
+ class TraceReader {
+ private:
+     int fd;
+     TraceHeader header;
+     vector<char> buffer;
+     size_t filled;
+     size_t consumed;
+     
+     // Top the buffer up with one read(); false at end of file
+     bool fill() {
+         memmove(buffer.data(), buffer.data() + consumed, filled - consumed);
+         filled -= consumed;
+         consumed = 0;
+         ssize_t bytesRead;
+         do {
+             bytesRead = read(fd, buffer.data() + filled, buffer.size() - filled);
+         } while (bytesRead < 0 && errno == EINTR);
+         if (bytesRead <= 0) {
+             return false;
+         }
+         filled += bytesRead;
+         return true;
+     }
+     
+     bool available() {
+         while (filled - consumed < sizeof(TraceRecord)) {
+             if (fd < 0 || !fill()) {
+                 return false;
+             }
+         }
+         return true;
+     }
+     
+ public:
+     TraceReader() : fd(-1), header(), buffer(TRACE_BUFFER_RECORDS * sizeof(TraceRecord)), filled(0), consumed(0) {}
+     
+     ~TraceReader() {
+         if (fd >= 0) {
+             ::close(fd);
+         }
+     }
+     
+     // Open path and check its header; prints the reason on failure
+     bool open(const string& path) {
+         fd = ::open(path.c_str(), O_RDONLY);
+         if (fd < 0) {
+             cerr << "Cannot open trace " << path << ": " << strerror(errno) << endl;
+             return false;
+         }
+         if (read(fd, &header, sizeof(header)) != static_cast<ssize_t>(sizeof(header)) ||
+             memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+             header.version != TRACE_VERSION || header.recordSize != sizeof(TraceRecord)) {
+             cerr << path << " is not an AirControlX trace" << endl;
+             ::close(fd);
+             fd = -1;
+             return false;
+         }
+         return true;
+     }
+     
+     const TraceHeader& getHeader() const {
+         return header;
+     }
+     
+     // Tick of the next record, or -1 at the end of the trace
+     long peekTick() {
+         if (!available()) {
+             return -1;
+         }
+         TraceRecord record;
+         memcpy(&record, buffer.data() + consumed, sizeof(record));
+         return record.tick;
+     }
+     
+     bool next(TraceRecord& record) {
+         if (!available()) {
+             return false;
+         }
+         memcpy(&record, buffer.data() + consumed, sizeof(record));
+         consumed += sizeof(record);
+         return true;
+     }
+ };
+ 
+ // How a flight treats its random outcomes
+ enum class TraceMode : uint8_t { OFF, RECORD, REPLAY };
+ 
+ // One outcome a flight drew this tick (RECORD), or is to use instead of
+ // drawing (REPLAY)
+ struct TraceDecision {
+     TraceKind kind;
+     int value;
+ };
+ 
+ // Aircraft class (base for both arrival and departure)
+ class Aircraft {
+ protected:
+     // Per-flight random stream, keyed by the run seed and the flight's id
+     // (ids start at 1000, clear of the spawn stream) and positioned at each
+     // tick's first draw, so a tick can step flights on any thread in any order
+     PhiloxStream rng;
+     
+     // Outcome waiting in traceDecisions, removed once used
+     bool takeDecision(TraceKind kind, int& value) {
+         for (size_t i = 0; i < traceDecisions.size(); i++) {
+             if (traceDecisions[i].kind == kind) {
+                 value = traceDecisions[i].value;
+                 traceDecisions.erase(traceDecisions.begin() + i);
+                 return true;
+             }
+         }
+         return false;
+     }
+     
+     // Speed on entering a state of this type's profile in profiles: the start of
+     // the state's ramp, or a speed drawn from its entry range. Replay takes
+     // drawn speeds from the trace, falling back to the RNG (and counting a
+     // miss) if the trace has none.
+     int entrySpeed(const SpeedProfiles& profiles, SpeedLimitKind kind, int state) {
+         const SpeedPhase& phase = profiles.phase(type, kind, state);
+         if (phase.rampTime > 0) {
+             return profiles.rampSpeed(type, kind, state, 0);
+         }
+         if (phase.entryMin == phase.entryMax) {
+             return phase.entryMin;
+         }
+         int speed;
+         if (traceMode == TraceMode::REPLAY) {
+             if (takeDecision(TRACE_SPEED, speed)) {
+                 return speed;
+             }
+             traceMisses++;
+         }
+         speed = profiles.entrySpeed(type, kind, state, rng);
+         if (traceMode == TraceMode::RECORD) {
+             traceDecisions.push_back({TRACE_SPEED, speed});
+         }
+         return speed;
+     }
+     
+     // The violation roll at second now for the current state; sets
+     // maintainViolationSpeed and violationSpeed when it injects
+     virtual void rollViolation(int now) = 0;
+     
+     // Randomly introduce speed violations with a configurable probability.
+     // Replay applies the injection traced for this tick instead of rolling.
+     void injectViolation(int now) {
+         if (!hasActiveViolation && !isEmergency && !maintainViolationSpeed) {  // Don't give violations to emergency flights
+             if (traceMode == TraceMode::REPLAY) {
+                 int speed;
+                 if (takeDecision(TRACE_VIOLATION, speed)) {
+                     currentSpeed = speed;
+                     maintainViolationSpeed = true;
+                     violationSpeed = speed;
+                 }
+                 return;
+             }
+             rollViolation(now);
+             if (maintainViolationSpeed && traceMode == TraceMode::RECORD) {
+                 traceDecisions.push_back({TRACE_VIOLATION, violationSpeed});
+             }
+         } else if (maintainViolationSpeed) {
+             // Maintain the violation speed until state changes
+             currentSpeed = violationSpeed;
+         }
+     }
+     
+ public:
+     int id;
+     FlightNumber flightNumber;
+     AirlineId airlineId;
+     const string& airline; // Interned name from AIRLINE_PROFILES
+     FlightType type;
+     Direction direction;
+     int priority;
+     int currentSpeed;
+     bool hasActiveViolation;
+     shared_ptr<AVN> currentViolation;
+     chrono::system_clock::time_point scheduledTime;
+     chrono::system_clock::time_point actualTime;
+     Runway assignedRunway;
+     int queuedAt; // Simulation time the flight joined a runway queue
+     bool isEmergency;
+     int queueSlot; // Position in the runway queue heap, -1 when not queued
+     double violationOdds; // Per-second odds of a violation, from the run's settings
+     int lastUpdate; // Last second updateStatus() stepped, set by the scheduler at spawn
+     int nextInjection; // Second the next violation roll succeeds, or INJECTION_UNDRAWN
+     int stepTime; // Second of this flight's live entry in the scheduler's step calendar
+     const RuleSet* loadedRules; // The run's rules, for flight classes on LoadedRules
+     const SpeedProfiles* loadedProfiles; // Speed profiles of those rules
+     // Add to Aircraft base class (around line 240) after the other member variables:
+
+// Track which states have already had violations (one bit per state)
+uint8_t violatedStates = 0;
+// Add a new member variable to the Aircraft base class (around line 241)
+bool maintainViolationSpeed = false;
+int violationSpeed = 0;
+
+     // Trace hooks, drained by the scheduler's serial emit stage each tick
+     TraceMode traceMode = TraceMode::OFF;
+     vector<TraceDecision> traceDecisions;
+     int traceMisses = 0; // Replay outcomes the trace did not supply
+
+     Aircraft(SimulationContext& context, const FlightNumber& flightNumber, AirlineId airlineId, FlightType type, 
+              Direction direction, int priority, 
+              chrono::system_clock::time_point scheduledTime)
+         : rng(context.seed, static_cast<uint32_t>(context.nextAircraftId)), id(context.nextAircraftId++), flightNumber(flightNumber), airlineId(airlineId),
+           airline(AIRLINE_PROFILES[airlineId].name), type(type),
+           direction(direction), priority(priority), currentSpeed(0),
+           hasActiveViolation(false), scheduledTime(scheduledTime),
+           assignedRunway(Runway::NONE), queuedAt(0), isEmergency(false), queueSlot(-1),
+           violationOdds(injectionOdds(context.violationPercent)), lastUpdate(0),
+           nextInjection(INJECTION_UNDRAWN), stepTime(NO_EVENT_TIME), loadedRules(&context.rules),
+           loadedProfiles(&context.profiles) {}
+     
+     virtual ~Aircraft() {}
+     
+     virtual void updateStatus(int simulationTime) = 0;
+     virtual void checkViolation() = 0;
+     virtual string getStateString() const = 0;
+     virtual bool isCompleted() const = 0;
+     virtual bool hasClearedRunway() const = 0;
+     
+     // Predicted from the state machine, for runway planning: seconds a
+     // runway assigned now would sit unused before this flight needs it,
+     // and seconds until the flight would clear it, as of the end of second asOf
+     virtual int runwayLeadTime(int asOf) const = 0;
+     virtual int runwayTimeRemaining(int asOf) const = 0;
+     
+     // Flights are only stepped at their own events, so ramped speeds are
+     // worked out for whoever reads them in between
+     virtual int speedAsOf(int asOf) const = 0;
+     
+     // The next second updateStatus() must run: the flight's next state
+     // transition, or its next successful violation roll when it can take one.
+     // Nothing else changes it until then, unless it is assigned a runway.
+     virtual int nextStepTime() const = 0;
+     
+     // nextStepTime() for a flight toTransition seconds from its next transition
+     int earliestStep(int toTransition) const {
+         int step = (toTransition == NO_EVENT_TIME) ? NO_EVENT_TIME : lastUpdate + toTransition;
+         if (!isEmergency && !maintainViolationSpeed && nextInjection != INJECTION_UNDRAWN) {
+             step = min(step, nextInjection);
+         }
+         return step;
+     }
+     
+     string getRunwayString() const {
+         return runwayString(assignedRunway);
+     }
+     
+     // North/South flights arrive, East/West flights depart
+     bool isArrival() const {
+         return direction == Direction::NORTH || direction == Direction::SOUTH;
+     }
+     
+     static string runwayString(Runway runway) {
+         if (runway == Runway::NONE) {
+             return "None";
+         }
+         return "RWY-" + runwayLetter(static_cast<int>(runway));
+     }
+     
+     string getDirectionString() const {
+         return directionString(direction);
+     }
+     
+     static string directionString(Direction direction) {
+         switch (direction) {
+             case Direction::NORTH: return "North";
+             case Direction::SOUTH: return "South";
+             case Direction::EAST: return "East";
+             case Direction::WEST: return "West";
+             default: return "Unknown";
+         }
+     }
+     
+     string getTypeString() const {
+         return typeString(type);
+     }
+     
+     static string typeString(FlightType type) {
+         switch (type) {
+             case FlightType::COMMERCIAL: return "Commercial";
+             case FlightType::CARGO: return "Cargo";
+             case FlightType::EMERGENCY: return "Emergency";
+             default: return "Unknown";
+         }
+     }
+     
+     virtual string getSummary() const {
+         stringstream ss;
+         ss << flightNumber << " | " << airline << " | " << getTypeString() 
+            << " | " << getDirectionString() << " | " << getStateString()
+            << " | Speed: " << currentSpeed << " km/h | Runway: " << getRunwayString();
+         if (isEmergency) ss << " | EMERGENCY";
+         if (hasActiveViolation) ss << " | VIOLATION";
+         return ss.str();
+     }
+ };
+ 
+ // Arrival Flight class, instantiated per rule policy (FixedRules or LoadedRules)
+ template <typename Rules>
+ class ArrivalFlight : public Aircraft {
+ private:
+     ArrivalState state;
+     int stateTime; // Time spent in current state
+     
+     // Limits and fines: constants under FixedRules, the run's set under LoadedRules
+     const RuleSet& rules() const {
+         return Rules::get(loadedRules);
+     }
+     
+     const SpeedProfiles& profiles() const {
+         return Rules::speeds(loadedProfiles);
+     }
+     
+ public:
+     // holdingSpeed is drawn by the scheduler from the spawn stream
+     ArrivalFlight(SimulationContext& context, const FlightNumber& flightNumber, AirlineId airlineId, FlightType type, 
+                   Direction direction, int priority, 
+                   chrono::system_clock::time_point scheduledTime, int holdingSpeed)
+         : Aircraft(context, flightNumber, airlineId, type, direction, priority, scheduledTime),
+           state(ArrivalState::HOLDING), stateTime(0) {
+         
+         // Set initial speed based on state
+         currentSpeed = holdingSpeed;
+     }
+     
+     ArrivalState getState() const {
+         return state;
+     }
+     
+     string getStateString() const override {
+         switch (state) {
+             case ArrivalState::HOLDING: return "Holding";
+             case ArrivalState::APPROACH: return "Approach";
+             case ArrivalState::LANDING: return "Landing";
+             case ArrivalState::TAXI: return "Taxi";
+             case ArrivalState::AT_GATE: return "At Gate";
+             default: return "Unknown";
+         }
+     }
+     
+     // For ArrivalFlight::updateStatus (around line 398)
+
+void updateStatus(int simulationTime) override {
+    rng.enterTick(simulationTime);
+    int elapsed = simulationTime - lastUpdate;
+    lastUpdate = simulationTime;
+    
+    // Update speed and state based on current state and time spent in that state
+    if (advanceFlight<ArrivalMachine>(profiles(), state, stateTime, currentSpeed, maintainViolationSpeed, type,
+                                  assignedRunway != Runway::NONE, elapsed,
+                                  [this](int entered) { return entrySpeed(profiles(), ARRIVAL_LIMITS, entered); })) {
+        nextInjection = INJECTION_UNDRAWN;
+    }
+    
+    // Randomly introduce speed violations (or hold an injected speed)
+    injectViolation(simulationTime);
+    
+    // Check for violations
+    checkViolation();
+}
+     
+// The violation roll at second now for the current state
+void rollViolation(int now) override {
+    int speed = currentSpeed;
+    if (stepInjection<ArrivalMachine>(rules(), violationOdds, state, stateTime, now, nextInjection, speed, rng)) {
+        currentSpeed = speed;
+        maintainViolationSpeed = true;
+        violationSpeed = currentSpeed;
+    }
+}
+     
+     // Modify the checkViolation method in ArrivalFlight class (around line 634)
+
+void checkViolation() override {
+    // Skip violation check if we already had a violation in this state
+    uint8_t stateBit = 1u << static_cast<int>(state);
+    if (violatedStates & stateBit) {
+        return;
+    }
+    
+    const SpeedLimit& limit = rules().limits[ARRIVAL_LIMITS][static_cast<int>(state)];
+    
+    // If there's a violation
+    if (limit.isViolatedBy(currentSpeed)) {
+        hasActiveViolation = true;
+        
+        // Create new AVN
+        currentViolation = make_shared<AVN>(
+            0, airline, flightNumber.str(), type, // Numbered by the scheduler's AVN stage
+            currentSpeed, limit.reportedMin, limit.reportedMax, rules()
+        );
+        currentViolation->detectedAtNs = monotonicNs();
+        
+        // Mark this state as having had a violation
+        violatedStates |= stateBit;
+    }
+}
+     
+     bool isCompleted() const override {
+         return ArrivalMachine::isDone(state);
+     }
+     
+     bool hasClearedRunway() const override {
+         return ArrivalMachine::hasClearedRunway(state);
+     }
+     
+     int runwayLeadTime(int asOf) const override {
+         return ArrivalMachine::runwayLeadTime(state, stateTime + (asOf - lastUpdate));
+     }
+     
+     int runwayTimeRemaining(int asOf) const override {
+         return ArrivalMachine::runwayTimeRemaining(state, stateTime + (asOf - lastUpdate));
+     }
+     
+     int speedAsOf(int asOf) const override {
+         int index = static_cast<int>(state);
+         if (!maintainViolationSpeed && profiles().phase(type, ARRIVAL_LIMITS, index).rampTime > 0) {
+             return profiles().rampSpeed(type, ARRIVAL_LIMITS, index, stateTime + (asOf - lastUpdate));
+         }
+         return currentSpeed;
+     }
+     
+     int nextStepTime() const override {
+         return earliestStep(ArrivalMachine::secondsToTransition(state, stateTime, assignedRunway != Runway::NONE));
+     }
+ };
+ 
+ // Departure Flight class, instantiated like ArrivalFlight
+ template <typename Rules>
+ class DepartureFlight : public Aircraft {
+ private:
+     DepartureState state;
+     int stateTime; // Time spent in current state
+     
+     // Limits and fines: constants under FixedRules, the run's set under LoadedRules
+     const RuleSet& rules() const {
+         return Rules::get(loadedRules);
+     }
+     
+     const SpeedProfiles& profiles() const {
+         return Rules::speeds(loadedProfiles);
+     }
+     
+ public:
+     DepartureFlight(SimulationContext& context, const FlightNumber& flightNumber, AirlineId airlineId, FlightType type, 
+                     Direction direction, int priority, 
+                     chrono::system_clock::time_point scheduledTime)
+         : Aircraft(context, flightNumber, airlineId, type, direction, priority, scheduledTime),
+           state(DepartureState::AT_GATE), stateTime(0) {
+         
+         // Initial speed at gate is 0
+         currentSpeed = 0;
+     }
+     
+     DepartureState getState() const {
+         return state;
+     }
+     
+     string getStateString() const override {
+         switch (state) {
+             case DepartureState::AT_GATE: return "At Gate";
+             case DepartureState::TAXI: return "Taxi";
+             case DepartureState::TAKEOFF_ROLL: return "Takeoff Roll";
+             case DepartureState::CLIMB: return "Climb";
+             case DepartureState::CRUISE: return "Cruise";
+             default: return "Unknown";
+         }
+     }
+     
+     // For DepartureFlight::updateStatus (around line 766)
+
+void updateStatus(int simulationTime) override {
+    rng.enterTick(simulationTime);
+    int elapsed = simulationTime - lastUpdate;
+    lastUpdate = simulationTime;
+    
+    // Update speed and state based on current state and time spent in that state
+    if (advanceFlight<DepartureMachine>(profiles(), state, stateTime, currentSpeed, maintainViolationSpeed, type,
+                                  assignedRunway != Runway::NONE, elapsed,
+                                  [this](int entered) { return entrySpeed(profiles(), DEPARTURE_LIMITS, entered); })) {
+        nextInjection = INJECTION_UNDRAWN;
+    }
+    
+    // Randomly introduce speed violations (or hold an injected speed)
+    injectViolation(simulationTime);
+    
+    // Check for violations
+    checkViolation();
+}
+     
+// The violation roll at second now for the current state
+void rollViolation(int now) override {
+    int speed = currentSpeed;
+    if (stepInjection<DepartureMachine>(rules(), violationOdds, state, stateTime, now, nextInjection, speed, rng)) {
+        currentSpeed = speed;
+        maintainViolationSpeed = true;
+        violationSpeed = currentSpeed;
+    }
+}
+     
+     // Modify the checkViolation method in DepartureFlight class (around line 853)
+
+void checkViolation() override {
+    // Skip violation check if we already had a violation in this state
+    uint8_t stateBit = 1u << static_cast<int>(state);
+    if (violatedStates & stateBit) {
+        return;
+    }
+    
+    const SpeedLimit& limit = rules().limits[DEPARTURE_LIMITS][static_cast<int>(state)];
+    
+    // If there's a violation
+    if (limit.isViolatedBy(currentSpeed)) {
+        hasActiveViolation = true;
+        
+        // Create new AVN
+        currentViolation = make_shared<AVN>(
+            0, airline, flightNumber.str(), type, // Numbered by the scheduler's AVN stage
+            currentSpeed, limit.reportedMin, limit.reportedMax, rules()
+        );
+        currentViolation->detectedAtNs = monotonicNs();
+        
+        // Mark this state as having had a violation
+        violatedStates |= stateBit;
+    }
+}
+     
+     bool isCompleted() const override {
+         return DepartureMachine::isDone(state);
+     }
+     
+     bool hasClearedRunway() const override {
+         return DepartureMachine::hasClearedRunway(state);
+     }
+     
+     int runwayLeadTime(int asOf) const override {
+         return DepartureMachine::runwayLeadTime(state, stateTime + (asOf - lastUpdate));
+     }
+     
+     int runwayTimeRemaining(int asOf) const override {
+         return DepartureMachine::runwayTimeRemaining(state, stateTime + (asOf - lastUpdate));
+     }
+     
+     int speedAsOf(int asOf) const override {
+         int index = static_cast<int>(state);
+         if (!maintainViolationSpeed && profiles().phase(type, DEPARTURE_LIMITS, index).rampTime > 0) {
+             return profiles().rampSpeed(type, DEPARTURE_LIMITS, index, stateTime + (asOf - lastUpdate));
+         }
+         return currentSpeed;
+     }
+     
+     int nextStepTime() const override {
+         return earliestStep(DepartureMachine::secondsToTransition(state, stateTime, assignedRunway != Runway::NONE));
+     }
+ };
+ 
+ // Block pool for aircraft. allocate_shared puts a flight and its control
+ // block in one block; when the last reference goes, the block joins a free
+ // list for its size and the next flight of that size reuses it. Blocks are
+ // cut from AIRCRAFT_POOL_CHUNK-byte chunks, so once the fleet has peaked new
+ // flights stop reaching the heap. Used from the tick thread only, and must
+ // outlive every aircraft it holds.
+ class AircraftPool {
+ private:
+     struct FreeBlock {
+         FreeBlock* next;
+     };
+     
+     struct SizeClass {
+         size_t size;
+         FreeBlock* free;
+     };
+     
+     vector<SizeClass> classes; // One per aircraft type, so a linear scan is enough
+     vector<unique_ptr<char[]>> chunks;
+     char* cursor;
+     size_t remaining;
+     
+     static size_t blockSize(size_t size) {
+         const size_t align = alignof(max_align_t);
+         return (size + align - 1) & ~(align - 1);
+     }
+     
+     SizeClass& sizeClass(size_t size) {
+         for (auto& entry : classes) {
+             if (entry.size == size) {
+                 return entry;
+             }
+         }
+         classes.push_back({size, nullptr});
+         return classes.back();
+     }
+     
+ public:
+     AircraftPool() : cursor(nullptr), remaining(0) {}
+     AircraftPool(const AircraftPool&) = delete;
+     AircraftPool& operator=(const AircraftPool&) = delete;
+     
+     void* allocate(size_t size) {
+         size = blockSize(size);
+         SizeClass& entry = sizeClass(size);
+         if (entry.free) {
+             FreeBlock* block = entry.free;
+             entry.free = block->next;
+             return block;
+         }
+         
+         if (remaining < size) {
+             size_t chunkSize = max(size, AIRCRAFT_POOL_CHUNK);
+             chunks.emplace_back(new char[chunkSize]);
+             cursor = chunks.back().get();
+             remaining = chunkSize;
+         }
+         void* block = cursor;
+         cursor += size;
+         remaining -= size;
+         return block;
+     }
+     
+     void deallocate(void* pointer, size_t size) {
+         SizeClass& entry = sizeClass(blockSize(size));
+         FreeBlock* block = static_cast<FreeBlock*>(pointer);
+         block->next = entry.free;
+         entry.free = block;
+     }
+     
+     size_t reservedBytes() const {
+         return chunks.size() * AIRCRAFT_POOL_CHUNK;
+     }
+ };
+ 
+ // Allocator that lets allocate_shared draw from an AircraftPool
+ template <typename T>
+ struct AircraftPoolAllocator {
+     using value_type = T;
+     
+     AircraftPool* pool;
+     
+     explicit AircraftPoolAllocator(AircraftPool* pool) : pool(pool) {}
+     
+     template <typename U>
+     AircraftPoolAllocator(const AircraftPoolAllocator<U>& other) : pool(other.pool) {}
+     
+     T* allocate(size_t count) {
+         return static_cast<T*>(pool->allocate(count * sizeof(T)));
+     }
+     
+     void deallocate(T* pointer, size_t count) {
+         pool->deallocate(pointer, count * sizeof(T));
+     }
+     
+     template <typename U>
+     bool operator==(const AircraftPoolAllocator<U>& other) const {
+         return pool == other.pool;
+     }
+     
+     template <typename U>
+     bool operator!=(const AircraftPoolAllocator<U>& other) const {
+         return pool != other.pool;
+     }
+ };
+ 
+ // Fixed-capacity ring; pushing when full overwrites the oldest entry
+ template <typename T>
+ class RingBuffer {
+ private:
+     vector<T> entries;
+     size_t start;
+     size_t count;
+     
+ public:
+     explicit RingBuffer(size_t capacity) : entries(capacity), start(0), count(0) {}
+     
+     // Empty the ring and change its capacity
+     void reset(size_t capacity) {
+         entries.assign(capacity, T());
+         start = count = 0;
+     }
+     
+     void push(const T& entry) {
+         if (entries.empty()) {
+             return;
+         }
+         if (count < entries.size()) {
+             entries[(start + count) % entries.size()] = entry;
+             count++;
+         } else {
+             entries[start] = entry;
+             start = (start + 1) % entries.size();
+         }
+     }
+     
+     // Visit entries oldest first
+     template <typename Visitor>
+     void forEach(Visitor visit) const {
+         for (size_t i = 0; i < count; i++) {
+             visit(entries[(start + i) % entries.size()]);
+         }
+     }
+     
+     size_t size() const {
+         return count;
+     }
+     
+     size_t capacity() const {
+         return entries.size();
+     }
+ };
+ 
+ // Summary kept once a flight completes and its aircraft goes back to the
+ // pool. Fixed size, no pointers.
+ struct CompletedFlightRecord {
+     int id = 0;
+     FlightNumber flightNumber;
+     AirlineId airline = AIRLINE_COUNT;
+     FlightType type = FlightType::COMMERCIAL;
+     Direction direction = Direction::NORTH;
+     bool emergency = false;
+     int queuedAt = 0;
+     int completedAt = 0;
+     int violations = 0; // Flight states in which it broke the speed rules
+ };
+ 
+ // How much history a run keeps in memory, and where completed flights are
+ // streamed (empty for nowhere)
+ struct RetentionConfig {
+     size_t avnLimit = AVN_RETENTION;
+     size_t completedHistory = COMPLETED_HISTORY;
+     string completedLog;
+ };
+ 
+ // Flight Scheduler
+ // Structure-of-arrays fleet store for large stress runs. Arrivals and
+ // departures live in separate partitions of parallel arrays, and each tick
+ // steps them through ArrivalMachine/DepartureMachine, the speed profiles
+ // and the violation roll the flight classes use, as tight loops over those
+ // arrays with no virtual calls, shared_ptr indirection or RTTI.
+ class FleetStore {
+ public:
+     enum PartitionKind { ARRIVALS = 0, DEPARTURES = 1 };
+     
+     struct Partition {
+         vector<int> id;
+         vector<uint8_t> state;            // ArrivalState or DepartureState value
+         vector<int> stateTime;
+         vector<int> currentSpeed;
+         vector<int> violationSpeed;
+         vector<uint8_t> assignedRunway;   // Runway value
+         vector<uint8_t> priority;
+         vector<uint8_t> type;             // FlightType value
+         vector<uint8_t> emergency;
+         vector<uint8_t> maintainViolation;
+         vector<uint8_t> violatedStates;   // One bit per state already fined
+         vector<int> nextInjection;        // As Aircraft::nextInjection
+         
+         size_t size() const {
+             return id.size();
+         }
+         
+         void add(int aircraftId, uint8_t initialState, int speed, FlightType flightType, int flightPriority, bool isEmergency) {
+             id.push_back(aircraftId);
+             state.push_back(initialState);
+             stateTime.push_back(0);
+             currentSpeed.push_back(speed);
+             violationSpeed.push_back(0);
+             assignedRunway.push_back(static_cast<uint8_t>(Runway::NONE));
+             priority.push_back(flightPriority);
+             type.push_back(static_cast<uint8_t>(flightType));
+             emergency.push_back(isEmergency);
+             maintainViolation.push_back(0);
+             violatedStates.push_back(0);
+             nextInjection.push_back(INJECTION_UNDRAWN);
+         }
+         
+         // Move entry from into slot to (used when compacting)
+         void moveEntry(size_t to, size_t from) {
+             id[to] = id[from];
+             state[to] = state[from];
+             stateTime[to] = stateTime[from];
+             currentSpeed[to] = currentSpeed[from];
+             violationSpeed[to] = violationSpeed[from];
+             assignedRunway[to] = assignedRunway[from];
+             priority[to] = priority[from];
+             type[to] = type[from];
+             emergency[to] = emergency[from];
+             maintainViolation[to] = maintainViolation[from];
+             violatedStates[to] = violatedStates[from];
+             nextInjection[to] = nextInjection[from];
+         }
+         
+         void resize(size_t count) {
+             id.resize(count);
+             state.resize(count);
+             stateTime.resize(count);
+             currentSpeed.resize(count);
+             violationSpeed.resize(count);
+             assignedRunway.resize(count);
+             priority.resize(count);
+             type.resize(count);
+             emergency.resize(count);
+             maintainViolation.resize(count);
+             violatedStates.resize(count);
+             nextInjection.resize(count);
+         }
+     };
+     
+     // Violation found during a tick
+     struct FleetViolation {
+         PartitionKind partition;
+         uint32_t index;
+         int speed;
+         int minSpeed;
+         int maxSpeed;
+     };
+     
+ private:
+     static constexpr uint32_t NO_AIRCRAFT = 0xFFFFFFFFu;
+     
+     Partition partitions[2];
+     
+     RuleSet rules;          // Limits, violation odds and speeds of the run
+     SpeedProfiles profiles; // Built from rules
+     double violationOdds;   // injectionOdds() of the rules' violation percent
+     uint32_t seed;          // Run seed, the key of every entry's stream
+     
+     // Runway waiting lists per partition, one FIFO bucket per priority (1-3).
+     // Spawn order stands in for scheduled time, so buckets keep
+     // CompareAircraftPriority order without a heap.
+     deque<uint32_t> waiting[2][3];
+     
+     // Runway occupants, indexed by runway number in the topology
+     RunwayTopology topology;
+     vector<PartitionKind> occupantPartition;
+     vector<uint32_t> occupantIndex;
+     
+     // Runways each partition and flight type may take, best first: the
+     // priority runways that prefer the type, then ordinary runways of the
+     // direction, then the direction's other priority runways
+     vector<int> runwayOrder[2][FLIGHT_TYPE_COUNT];
+     
+     int nextId;
+     int currentTime;
+     size_t retired[2];  // Completed entries awaiting compaction
+     
+     long long totalViolations;
+     long long totalCompleted;
+     long long totalAssignments;
+     vector<FleetViolation> tickViolations;
+     static constexpr size_t FLEET_SCAN_BLOCK = 256;
+     uint8_t violationFlags[FLEET_SCAN_BLOCK];  // Scratch output of scanSpeedViolations()
+     
+     static bool isDone(PartitionKind kind, uint8_t state) {
+         return (kind == ARRIVALS) ? ArrivalMachine::isDone(static_cast<ArrivalState>(state))
+                                   : DepartureMachine::isDone(static_cast<DepartureState>(state));
+     }
+     
+     bool runwayFree(int runway) const {
+         return occupantIndex[runway] == NO_AIRCRAFT;
+     }
+     
+     void occupy(int runway, PartitionKind kind, uint32_t index) {
+         occupantPartition[runway] = kind;
+         occupantIndex[runway] = index;
+         partitions[kind].assignedRunway[index] = static_cast<uint8_t>(runway);
+         totalAssignments++;
+     }
+     
+     void buildRunwayOrder() {
+         for (int kind = 0; kind < 2; kind++) {
+             for (int type = 0; type < FLIGHT_TYPE_COUNT; type++) {
+                 vector<int>& order = runwayOrder[kind][type];
+                 order.clear();
+                 for (int rank = 0; rank < 3; rank++) {
+                     for (int runway = 0; runway < static_cast<int>(topology.size()); runway++) {
+                         if (!topology.serves(runway, kind == ARRIVALS)) {
+                             continue;
+                         }
+                         int runwayRank = topology.prefers(runway, static_cast<FlightType>(type)) ? 0
+                                        : (topology.isPriorityRunway(runway) ? 2 : 1);
+                         if (runwayRank == rank) {
+                             order.push_back(runway);
+                         }
+                     }
+                 }
+             }
+         }
+     }
+     
+     // Head of the highest waiting bucket to the first free runway in its
+     // type's order, until the partition's runways are full or nobody waits
+     void assignPartition(PartitionKind kind) {
+         Partition& fleet = partitions[kind];
+         while (true) {
+             int bucket = 2;
+             while (bucket >= 0 && waiting[kind][bucket].empty()) {
+                 bucket--;
+             }
+             if (bucket < 0) {
+                 return;
+             }
+             
+             uint32_t index = waiting[kind][bucket].front();
+             const vector<int>& order = runwayOrder[kind][fleet.type[index]];
+             auto freeRunway = find_if(order.begin(), order.end(), [this](int runway) { return runwayFree(runway); });
+             if (freeRunway == order.end()) {
+                 return;
+             }
+             occupy(*freeRunway, kind, index);
+             waiting[kind][bucket].pop_front();
+         }
+     }
+     
+     void releaseRunways() {
+         for (size_t r = 0; r < occupantIndex.size(); r++) {
+             uint32_t index = occupantIndex[r];
+             if (index == NO_AIRCRAFT) {
+                 continue;
+             }
+             Partition& fleet = partitions[occupantPartition[r]];
+             uint8_t state = fleet.state[index];
+             bool cleared = (occupantPartition[r] == ARRIVALS)
+                 ? ArrivalMachine::hasClearedRunway(static_cast<ArrivalState>(state))
+                 : DepartureMachine::hasClearedRunway(static_cast<DepartureState>(state));
+             if (cleared) {
+                 fleet.assignedRunway[index] = static_cast<uint8_t>(Runway::NONE);
+                 occupantIndex[r] = NO_AIRCRAFT;
+             }
+         }
+     }
+     
+     void recordViolation(PartitionKind kind, uint32_t index, int speed, int minSpeed, int maxSpeed) {
+         tickViolations.push_back({kind, index, speed, minSpeed, maxSpeed});
+         totalViolations++;
+     }
+     
+     // Speed rule check, once per state, over entries [begin, end). Entries
+     // retired on earlier ticks keep their last speed, so they never flag again.
+     void checkSpeedRules(PartitionKind kind, size_t begin, size_t end) {
+         Partition& fleet = partitions[kind];
+         SpeedLimitKind limitKind = (kind == ARRIVALS) ? ARRIVAL_LIMITS : DEPARTURE_LIMITS;
+         scanSpeedViolations(rules.limits[limitKind], fleet.state.data() + begin, fleet.currentSpeed.data() + begin,
+                             fleet.violatedStates.data() + begin, violationFlags, end - begin);
+         
+         for (size_t i = begin; i < end; i++) {
+             if (!violationFlags[i - begin]) {
+                 continue;
+             }
+             const SpeedLimit& limit = rules.limits[limitKind][fleet.state[i]];
+             fleet.violatedStates[i] |= 1u << fleet.state[i];
+             recordViolation(kind, i, fleet.currentSpeed[i], limit.reportedMin, limit.reportedMax);
+         }
+     }
+     
+     // Aircraft::updateStatus over a partition: the flight classes' state
+     // machine and speed profiles, then the same injection rules. Each entry
+     // draws from its aircraft's Philox stream at this tick, like a flight's
+     // own rng, so draws do not depend on partition order or compaction.
+     template <typename Machine>
+     void stepPartition(PartitionKind kind) {
+         Partition& fleet = partitions[kind];
+         size_t count = fleet.size();
+         // Step in cache-sized blocks and scan each block while it is hot
+         for (size_t block = 0; block < count; block += FLEET_SCAN_BLOCK) {
+             size_t blockEnd = min(count, block + FLEET_SCAN_BLOCK);
+             for (size_t i = block; i < blockEnd; i++) {
+                 typename Machine::State state = static_cast<typename Machine::State>(fleet.state[i]);
+                 if (Machine::isDone(state)) {
+                     continue;
+                 }
+                 int stateTime = fleet.stateTime[i];
+                 int speed = fleet.currentSpeed[i];
+                 bool maintain = fleet.maintainViolation[i];
+                 FlightType flightType = static_cast<FlightType>(fleet.type[i]);
+                 bool runwayAssigned = fleet.assignedRunway[i] != static_cast<uint8_t>(Runway::NONE);
+                 PhiloxStream rng(seed, static_cast<uint32_t>(fleet.id[i]));
+                 rng.enterTick(currentTime);
+                 
+                 auto entrySpeed = [this, flightType, &rng](int entered) {
+                     return profiles.entrySpeed(flightType, Machine::KIND, entered, rng);
+                 };
+                 if (advanceFlight<Machine>(profiles, state, stateTime, speed, maintain, flightType, runwayAssigned, 1,
+                                            entrySpeed)) {
+                     fleet.state[i] = static_cast<uint8_t>(state);
+                     fleet.nextInjection[i] = INJECTION_UNDRAWN;
+                     if (Machine::isDone(state)) {
+                         // Last step for this entry; skipped from next tick on
+                         retired[kind]++;
+                         totalCompleted++;
+                     }
+                 }
+                 fleet.stateTime[i] = stateTime;
+                 
+                 // Random violation injection, as in Aircraft::injectViolation
+                 if (!fleet.emergency[i] && !maintain) {
+                     if (stepInjection<Machine>(rules, violationOdds, state, stateTime, currentTime, fleet.nextInjection[i],
+                                                speed, rng)) {
+                         maintain = true;
+                         fleet.violationSpeed[i] = speed;
+                     }
+                 } else if (maintain) {
+                     speed = fleet.violationSpeed[i];
+                 }
+                 fleet.currentSpeed[i] = speed;
+                 fleet.maintainViolation[i] = maintain;
+             }
+             
+             checkSpeedRules(kind, block, blockEnd);
+         }
+     }
+     
+     // Drop completed entries once they make up half a partition, remapping
+     // waiting lists and runway occupants to the new indices
+     void compact(PartitionKind kind) {
+         Partition& fleet = partitions[kind];
+         if (retired[kind] == 0 || retired[kind] * 2 < fleet.size()) {
+             return;
+         }
+         
+         vector<uint32_t> remap(fleet.size(), NO_AIRCRAFT);
+         size_t kept = 0;
+         for (size_t i = 0; i < fleet.size(); i++) {
+             if (isDone(kind, fleet.state[i])) {
+                 continue;
+             }
+             if (kept != i) {
+                 fleet.moveEntry(kept, i);
+             }
+             remap[i] = kept++;
+         }
+         fleet.resize(kept);
+         retired[kind] = 0;
+         
+         for (auto& bucket : waiting[kind]) {
+             for (auto& index : bucket) {
+                 index = remap[index];
+             }
+         }
+         for (size_t r = 0; r < occupantIndex.size(); r++) {
+             if (occupantIndex[r] != NO_AIRCRAFT && occupantPartition[r] == kind) {
+                 occupantIndex[r] = remap[occupantIndex[r]];
+             }
+         }
+     }
+     
+ public:
+     FleetStore(const RuleSet& rules, uint32_t seed, const RunwayTopology& topology)
+         : rules(rules), profiles(rules), violationOdds(injectionOdds(rules.violationPercent)), seed(seed),
+           topology(topology),
+           occupantPartition(topology.size(), ARRIVALS), occupantIndex(topology.size(), NO_AIRCRAFT),
+           nextId(1000), currentTime(0), totalViolations(0), totalCompleted(0), totalAssignments(0) {
+         buildRunwayOrder();
+         retired[ARRIVALS] = retired[DEPARTURES] = 0;
+     }
+     
+     void reserve(size_t arrivals, size_t departures) {
+         auto reservePartition = [](Partition& fleet, size_t count) {
+             fleet.id.reserve(count);
+             fleet.state.reserve(count);
+             fleet.stateTime.reserve(count);
+             fleet.currentSpeed.reserve(count);
+             fleet.violationSpeed.reserve(count);
+             fleet.assignedRunway.reserve(count);
+             fleet.priority.reserve(count);
+             fleet.type.reserve(count);
+             fleet.emergency.reserve(count);
+             fleet.maintainViolation.reserve(count);
+             fleet.violatedStates.reserve(count);
+             fleet.nextInjection.reserve(count);
+         };
+         reservePartition(partitions[ARRIVALS], arrivals);
+         reservePartition(partitions[DEPARTURES], departures);
+     }
+     
+     // Priority follows generateFlights(): emergency = 3, cargo = 2, commercial = 1
+     int addArrival(FlightType type, bool isEmergency, int holdingSpeed) {
+         int priority = isEmergency ? 3 : ((type == FlightType::CARGO) ? 2 : 1);
+         Partition& fleet = partitions[ARRIVALS];
+         fleet.add(nextId, static_cast<uint8_t>(ArrivalState::HOLDING), holdingSpeed, type, priority, isEmergency);
+         waiting[ARRIVALS][priority - 1].push_back(fleet.size() - 1);
+         return nextId++;
+     }
+     
+     int addDeparture(FlightType type, bool isEmergency) {
+         int priority = isEmergency ? 3 : ((type == FlightType::CARGO) ? 2 : 1);
+         Partition& fleet = partitions[DEPARTURES];
+         fleet.add(nextId, static_cast<uint8_t>(DepartureState::AT_GATE), 0, type, priority, isEmergency);
+         waiting[DEPARTURES][priority - 1].push_back(fleet.size() - 1);
+         return nextId++;
+     }
+     
+     // One simulated second, in FlightScheduler::updateSimulation() order
+     void step() {
+         currentTime++;
+         tickViolations.clear();
+         
+         assignPartition(ARRIVALS);
+         assignPartition(DEPARTURES);
+         releaseRunways();
+         
+         stepPartition<ArrivalMachine>(ARRIVALS);
+         stepPartition<DepartureMachine>(DEPARTURES);
+         
+         compact(ARRIVALS);
+         compact(DEPARTURES);
+     }
+     
+     const Partition& getPartition(PartitionKind kind) const {
+         return partitions[kind];
+     }
+     
+     const vector<FleetViolation>& getTickViolations() const {
+         return tickViolations;
+     }
+     
+     size_t activeCount() const {
+         return partitions[ARRIVALS].size() - retired[ARRIVALS] +
+                partitions[DEPARTURES].size() - retired[DEPARTURES];
+     }
+     
+     const SpeedProfiles& getProfiles() const { return profiles; }
+     int getCurrentTime() const { return currentTime; }
+     long long getTotalViolations() const { return totalViolations; }
+     long long getTotalCompleted() const { return totalCompleted; }
+     long long getTotalAssignments() const { return totalAssignments; }
+ };
+ 
+ // Priority queue comparator
+ struct CompareAircraftPriority {
+     bool operator()(const shared_ptr<Aircraft>& a, const shared_ptr<Aircraft>& b) const {
+         // First by priority (higher number = higher priority)
+         if (a->priority != b->priority) {
+             return a->priority < b->priority;
+         }
+         // Then by scheduled time
+         return a->scheduledTime > b->scheduledTime;
+     }
+ };
+ 
+ // Runway scheduling queue: an indexed binary max-heap in CompareAircraftPriority
+ // order. Each queued aircraft records its heap slot (Aircraft::queueSlot), so
+ // removal and priority changes are O(log n) and the head is O(1).
+ class RunwayQueue {
+ private:
+     vector<shared_ptr<Aircraft>> heap;
+     CompareAircraftPriority lowerPriority;
+     long long prioritySum = 0; // Over every queued aircraft
+     
+     void place(size_t slot, shared_ptr<Aircraft> aircraft) {
+         aircraft->queueSlot = static_cast<int>(slot);
+         heap[slot] = move(aircraft);
+     }
+     
+     void siftUp(size_t slot) {
+         shared_ptr<Aircraft> aircraft = move(heap[slot]);
+         while (slot > 0) {
+             size_t parent = (slot - 1) / 2;
+             if (!lowerPriority(heap[parent], aircraft)) {
+                 break;
+             }
+             place(slot, move(heap[parent]));
+             slot = parent;
+         }
+         place(slot, move(aircraft));
+     }
+     
+     void siftDown(size_t slot) {
+         shared_ptr<Aircraft> aircraft = move(heap[slot]);
+         size_t count = heap.size();
+         while (true) {
+             size_t child = 2 * slot + 1;
+             if (child >= count) {
+                 break;
+             }
+             if (child + 1 < count && lowerPriority(heap[child], heap[child + 1])) {
+                 child++;
+             }
+             if (!lowerPriority(aircraft, heap[child])) {
+                 break;
+             }
+             place(slot, move(heap[child]));
+             slot = child;
+         }
+         place(slot, move(aircraft));
+     }
+     
+     // Remove the entry at slot, filling the hole with the last entry
+     void erase(size_t slot) {
+         heap[slot]->queueSlot = -1;
+         prioritySum -= heap[slot]->priority;
+         shared_ptr<Aircraft> last = move(heap.back());
+         heap.pop_back();
+         if (slot < heap.size()) {
+             place(slot, move(last));
+             siftUp(slot);
+             siftDown(heap[slot]->queueSlot);
+         }
+     }
+     
+ public:
+     bool empty() const {
+         return heap.empty();
+     }
+     
+     size_t size() const {
+         return heap.size();
+     }
+     
+     // Total priority waiting, the weight of delaying the queue by a second
+     long long getPrioritySum() const {
+         return prioritySum;
+     }
+     
+     const shared_ptr<Aircraft>& top() const {
+         return heap.front();
+     }
+     
+     // Entry by heap slot. Slot 0 is the top and the runner-up is in slot 1
+     // or 2, so the first three slots hold the next two flights in line.
+     const shared_ptr<Aircraft>& at(size_t slot) const {
+         return heap[slot];
+     }
+     
+     bool contains(const shared_ptr<Aircraft>& aircraft) const {
+         int slot = aircraft->queueSlot;
+         return slot >= 0 && slot < static_cast<int>(heap.size()) && heap[slot] == aircraft;
+     }
+     
+     void push(shared_ptr<Aircraft> aircraft) {
+         prioritySum += aircraft->priority;
+         heap.emplace_back();
+         place(heap.size() - 1, move(aircraft));
+         siftUp(heap.size() - 1);
+     }
+     
+     void pop() {
+         erase(0);
+     }
+     
+     bool remove(const shared_ptr<Aircraft>& aircraft) {
+         if (!contains(aircraft)) {
+             return false;
+         }
+         erase(aircraft->queueSlot);
+         return true;
+     }
+     
+     // Change a queued aircraft's priority and restore heap order around it
+     bool updatePriority(const shared_ptr<Aircraft>& aircraft, int priority) {
+         if (!contains(aircraft)) {
+             return false;
+         }
+         prioritySum += priority - aircraft->priority;
+         aircraft->priority = priority;
+         size_t slot = aircraft->queueSlot;
+         siftUp(slot);
+         siftDown(aircraft->queueSlot);
+         return true;
+     }
+ };
+ 
+ // Metrics collected over one scheduler run
+ struct SimulationMetrics {
+     int simulatedTime = 0;
+     int flightsGenerated = 0;
+     int flightsCompleted = 0;
+     int flightsActive = 0;
+     int flightsQueued = 0;
+     int avnsIssued = 0;
+     int ticksProcessed = 0;
+     vector<int> runwayBusyTime; // Per runway of the topology
+     long long totalQueueWait = 0;
+     int maxQueueWait = 0;
+     int runwayAssignments = 0;
+     
+     double runwayUtilisation(int busyTime) const {
+         return 100.0 * busyTime / max(1, simulatedTime);
+     }
+     
+     double averageQueueWait() const {
+         return runwayAssignments ? static_cast<double>(totalQueueWait) / runwayAssignments : 0.0;
+     }
+ };
+ 
+ // Running aggregates, updated as the scheduler assigns and releases runways,
+ // issues AVNs and takes payments. Every read is O(1) (a histogram percentile
+ // walks a fixed bucket array), so a dashboard can poll it every frame without
+ // touching the flight lists or the AVN index. Updated only by the thread
+ // running the ticks.
+ class AnalyticsEngine {
+ public:
+     struct RunwayUsage {
+         long long closedBusyTime = 0; // Seconds held by occupants already released
+         int occupiedSince = -1;       // Tick the current occupant was assigned, -1 if free
+         uint64_t assignments = 0;
+         uint64_t releases = 0;        // Throughput: flights that have cleared the runway
+     };
+     
+     // Money is summed in whole paisa so long runs do not drift
+     struct AirlineBilling {
+         uint64_t violations = 0;
+         uint64_t paid = 0;
+         long long outstandingPaisa = 0; // Issued and not yet paid (totalAmount)
+         long long collectedPaisa = 0;   // Received
+         
+         double outstanding() const {
+             return outstandingPaisa / 100.0;
+         }
+         
+         double collected() const {
+             return collectedPaisa / 100.0;
+         }
+     };
+     
+ private:
+     vector<RunwayUsage> runways;
+     AirlineBilling airlines[AIRLINE_COUNT];
+     AirlineBilling allAirlines;
+     LatencyHistogram queueWait[FLIGHT_TYPE_COUNT]; // Simulated seconds from enqueue to runway
+     
+ public:
+     explicit AnalyticsEngine(size_t runwayCount = 0) : runways(runwayCount) {}
+     
+     // One usage record per runway; clears any recorded so far
+     void setRunwayCount(size_t runwayCount) {
+         runways.assign(runwayCount, RunwayUsage());
+     }
+     
+     size_t runwayCount() const {
+         return runways.size();
+     }
+     
+     void runwayAssigned(Runway runway, FlightType type, int wait, int now) {
+         RunwayUsage& usage = runways[static_cast<int>(runway)];
+         usage.occupiedSince = now;
+         usage.assignments++;
+         queueWait[static_cast<int>(type)].record(wait);
+     }
+     
+     void runwayReleased(Runway runway, int now) {
+         RunwayUsage& usage = runways[static_cast<int>(runway)];
+         if (usage.occupiedSince >= 0) {
+             usage.closedBusyTime += now - usage.occupiedSince;
+             usage.occupiedSince = -1;
+             usage.releases++;
+         }
+     }
+     
+     void avnIssued(AirlineId airline, double amount) {
+         for (AirlineBilling* billing : {&airlines[airline], &allAirlines}) {
+             billing->violations++;
+             billing->outstandingPaisa += llround(amount * 100);
+         }
+     }
+     
+     // totalAmount leaves the outstanding balance; amount is what was paid
+     void avnPaid(AirlineId airline, double totalAmount, double amount) {
+         for (AirlineBilling* billing : {&airlines[airline], &allAirlines}) {
+             billing->paid++;
+             billing->outstandingPaisa -= llround(totalAmount * 100);
+             billing->collectedPaisa += llround(amount * 100);
+         }
+     }
+     
+     // Seconds the runway has been held up to and including tick now
+     long long busyTime(Runway runway, int now) const {
+         const RunwayUsage& usage = runways[static_cast<int>(runway)];
+         return usage.closedBusyTime + (usage.occupiedSince >= 0 ? now - usage.occupiedSince + 1 : 0);
+     }
+     
+     const RunwayUsage& runway(Runway runway) const {
+         return runways[static_cast<int>(runway)];
+     }
+     
+     const AirlineBilling& airline(AirlineId airline) const {
+         return airlines[airline];
+     }
+     
+     const AirlineBilling& total() const {
+         return allAirlines;
+     }
+     
+     const LatencyHistogram& queueWaitFor(FlightType type) const {
+         return queueWait[static_cast<int>(type)];
+     }
+     
+     static AirlineId airlineNamed(const string& name) {
+         return airlineIdOf(name.c_str());
+     }
+     
+     void print(ostream& out, int now) const {
+         static const char* const TYPE_NAMES[FLIGHT_TYPE_COUNT] = {"Commercial", "Cargo", "Emergency"};
+         
+         out << "\n--- RUNWAY THROUGHPUT ---" << endl;
+         for (size_t r = 0; r < runways.size(); r++) {
+             out << "Runway " << runwayLetter(r) << ": " << runways[r].releases << " cleared, "
+                 << busyTime(static_cast<Runway>(r), now) << "s busy" << endl;
+         }
+         
+         out << "\n--- QUEUE WAIT BY TYPE ---" << endl;
+         for (int t = 0; t < FLIGHT_TYPE_COUNT; t++) {
+             queueWait[t].print(TYPE_NAMES[t], 1.0, "s", out);
+         }
+         
+         out << "\n--- AVN REVENUE ---" << endl;
+         for (int id = 0; id < AIRLINE_COUNT; id++) {
+             const AirlineBilling& billing = airlines[id];
+             if (billing.violations == 0) {
+                 continue;
+             }
+             out << AIRLINE_PROFILES[id].name << ": " << billing.violations << " violation(s), "
+                 << billing.paid << " paid, PKR " << fixed << setprecision(2) << billing.outstanding()
+                 << " outstanding" << endl;
+         }
+         out << "Total: " << allAirlines.violations << " violation(s), PKR " << fixed << setprecision(2)
+             << allAirlines.outstanding() << " outstanding, PKR " << allAirlines.collected() << " collected" << endl;
+     }
+ };
+ 
+ // Wall time spent in each stage of FlightScheduler::updateSimulation(),
+ // summed over the profiled ticks
+ struct TickPhaseTimes {
+     double generateNs = 0.0;
+     double assignNs = 0.0;
+     double updateNs = 0.0;
+     double emitNs = 0.0; // AVN emission and the hand-off to the event ring
+     double moveNs = 0.0;
+ };
+ 
+ // Fixed set of threads for the data-parallel stages of a tick. run() hands
+ // out task indices to the workers and the calling thread alike and returns
+ // once every task is done. With one thread all tasks run inline.
+ class TickWorkerPool {
+ private:
+     vector<thread> threads;
+     mutex stageMutex;
+     condition_variable stageReady;
+     condition_variable stageDone;
+     function<void(size_t)> task;
+     size_t taskCount;
+     atomic<size_t> nextTask;
+     size_t busyWorkers;
+     uint64_t stage; // Bumped once per run() to wake the workers
+     bool stopping;
+     
+     void runTasks() {
+         size_t index;
+         while ((index = nextTask.fetch_add(1, memory_order_relaxed)) < taskCount) {
+             task(index);
+         }
+     }
+     
+     void workerLoop() {
+         uint64_t seenStage = 0;
+         unique_lock<mutex> lock(stageMutex);
+         while (true) {
+             stageReady.wait(lock, [&]() { return stopping || stage != seenStage; });
+             if (stopping) {
+                 return;
+             }
+             seenStage = stage;
+             lock.unlock();
+             runTasks();
+             lock.lock();
+             if (--busyWorkers == 0) {
+                 stageDone.notify_one();
+             }
+         }
+     }
+     
+ public:
+     explicit TickWorkerPool(int threadCount)
+         : taskCount(0), nextTask(0), busyWorkers(0), stage(0), stopping(false) {
+         for (int i = 1; i < threadCount; i++) {
+             threads.emplace_back(&TickWorkerPool::workerLoop, this);
+         }
+     }
+     
+     ~TickWorkerPool() {
+         {
+             lock_guard<mutex> lock(stageMutex);
+             stopping = true;
+         }
+         stageReady.notify_all();
+         for (auto& worker : threads) {
+             worker.join();
+         }
+     }
+     
+     TickWorkerPool(const TickWorkerPool&) = delete;
+     TickWorkerPool& operator=(const TickWorkerPool&) = delete;
+     
+     int size() const {
+         return static_cast<int>(threads.size()) + 1;
+     }
+     
+     void run(size_t count, const function<void(size_t)>& stageTask) {
+         if (threads.empty() || count <= 1) {
+             for (size_t i = 0; i < count; i++) {
+                 stageTask(i);
+             }
+             return;
+         }
+         
+         {
+             lock_guard<mutex> lock(stageMutex);
+             task = stageTask;
+             taskCount = count;
+             nextTask.store(0, memory_order_relaxed);
+             busyWorkers = threads.size();
+             stage++;
+         }
+         stageReady.notify_all();
+         runTasks();
+         
+         unique_lock<mutex> lock(stageMutex);
+         stageDone.wait(lock, [this]() { return busyWorkers == 0; });
+     }
+ };
+ 
+ // Contents of the status screen, captured on the tick thread and formatted
+ // wherever it is printed
+ struct StatusSnapshot {
+     // Flights are copied by value: the renderer thread must never hold the
+     // last reference to a pooled aircraft
+     struct FlightView {
+         FlightNumber flightNumber;
+         AirlineId airline;
+         FlightType type;
+         Direction direction;
+         bool emergency;
+         string state;
+         int speed;
+         Runway runway;
+         bool violation;
+     };
+     
+     struct AVNView {
+         int id;
+         string airline;
+         string flightNumber;
+         int speed;
+         double amount;
+     };
+     
+     struct RunwayView {
+         bool occupied = false;
+         FlightNumber flightNumber;
+         AirlineId airline;
+         bool joinable = false; // New flights join this runway's queue
+         size_t queued = 0;
+     };
+     
+     int time = 0;
+     size_t completedCount = 0;
+     vector<RunwayView> runways;
+     vector<FlightView> flights;
+     size_t avnCount = 0;
+     vector<AVNView> unpaidAVNs;
+     string footer; // Printed after the status block when set
+     
+     void print(ostream& out) const {
+         out << "\n======== AIRCONTROLX STATUS ========" << endl;
+         out << "Simulation Time: " << time << " seconds" << endl;
+         out << "Active Flights: " << flights.size() << endl;
+         out << "Completed Flights: " << completedCount << endl;
+         
+         // Runway status
+         out << "\n--- RUNWAY STATUS ---" << endl;
+         for (size_t r = 0; r < runways.size(); r++) {
+             const RunwayView& occupant = runways[r];
+             out << "Runway " << runwayLetter(r) << ": ";
+             if (occupant.occupied) {
+                 out << occupant.flightNumber << " (" << AIRLINE_PROFILES[occupant.airline].name << ")" << endl;
+             } else {
+                 out << "Free" << endl;
+             }
+         }
+         
+         // Queue status
+         out << "\n--- QUEUE STATUS ---" << endl;
+         for (size_t r = 0; r < runways.size(); r++) {
+             if (runways[r].joinable) {
+                 out << "Runway " << runwayLetter(r) << " Queue: " << runways[r].queued << " flights waiting" << endl;
+             }
+         }
+         
+         // Active flights
+         out << "\n--- ACTIVE FLIGHTS ---" << endl;
+         for (const auto& view : flights) {
+             out << view.flightNumber << " | " << AIRLINE_PROFILES[view.airline].name << " | "
+                 << Aircraft::typeString(view.type) << " | " << Aircraft::directionString(view.direction)
+                 << " | " << view.state
+                 << " | Speed: " << view.speed << " km/h | Runway: " << Aircraft::runwayString(view.runway);
+             if (view.emergency) out << " | EMERGENCY";
+             if (view.violation) out << " | VIOLATION";
+             out << endl;
+         }
+         
+         out << "\n--- ACTIVE AVNs ---" << endl;
+         if (avnCount == 0) {
+             out << "No AVNs issued yet." << endl;
+         } else if (unpaidAVNs.empty()) {
+             out << "All AVNs have been paid." << endl;
+         } else {
+             for (const auto& avn : unpaidAVNs) {
+                 out << "AVN #" << avn.id << " | " << avn.airline << " flight " << avn.flightNumber 
+                     << " | Speed: " << avn.speed << " km/h"
+                     << " | Amount: PKR " << fixed << setprecision(2) << avn.amount << endl;
+             }
+         }
+         out << "=====================================" << endl;
+         
+         if (!footer.empty()) {
+             out << footer << endl;
+         }
+     }
+ };
+ 
+ // Unbounded lock-free multi-producer/single-consumer queue (Vyukov's linked
+ // design). push() never blocks; pop() belongs to a single consumer thread.
+ template <typename T>
+ class MPSCQueue {
+ private:
+     struct Node {
+         atomic<Node*> next;
+         T value;
+         
+         Node() : next(nullptr) {}
+         explicit Node(T&& value) : next(nullptr), value(move(value)) {}
+     };
+     
+     atomic<Node*> head; // Most recently pushed node
+     Node* tail;         // Consumer-owned; its successor is the next to pop
+     
+ public:
+     MPSCQueue() : head(new Node()), tail(head.load(memory_order_relaxed)) {}
+     
+     ~MPSCQueue() {
+         T discarded;
+         while (pop(discarded)) {}
+         delete tail;
+     }
+     
+     MPSCQueue(const MPSCQueue&) = delete;
+     MPSCQueue& operator=(const MPSCQueue&) = delete;
+     
+     void push(T value) {
+         Node* node = new Node(move(value));
+         Node* previous = head.exchange(node, memory_order_acq_rel);
+         previous->next.store(node, memory_order_release);
+     }
+     
+     // False when empty, or when a push is half done (it shows up next call)
+     bool pop(T& value) {
+         Node* next = tail->next.load(memory_order_acquire);
+         if (!next) {
+             return false;
+         }
+         value = move(next->value);
+         delete tail;
+         tail = next;
+         return true;
+     }
+ };
+ 
+ // Owns the console while the simulation runs. Producers post log lines on a
+ // lock-free queue and offer status snapshots through a one-slot mailbox that
+ // keeps only the newest. A render thread redraws at a fixed rate: the lines
+ // that arrived since the last frame, then the newest snapshot, in a single
+ // write under cout_mutex. Quiet mode prints the lines only.
+ class ConsoleRenderer {
+ private:
+     MPSCQueue<string> lines;
+     atomic<StatusSnapshot*> latest; // Newest undrawn snapshot, owned by the renderer
+     atomic<bool> snapshotDue;       // Re-armed every frame, so at most one capture per frame
+     bool quiet;
+     chrono::steady_clock::duration frameInterval;
+     mutex stopMutex;
+     condition_variable stopSignal;
+     bool stopping;
+     thread renderThread;
+     
+     void drawFrame() {
+         string frame;
+         string line;
+         while (lines.pop(line)) {
+             frame += line;
+             frame += '\n';
+         }
+         unique_ptr<StatusSnapshot> snapshot(latest.exchange(nullptr, memory_order_acq_rel));
+         if (snapshot) {
+             ostringstream out;
+             snapshot->print(out);
+             frame += out.str();
+         }
+         snapshotDue.store(!quiet, memory_order_release);
+         
+         if (!frame.empty()) {
+             lock_guard<mutex> lock(cout_mutex);
+             cout << frame << flush;
+         }
+     }
+     
+     void renderLoop() {
+         auto nextFrame = chrono::steady_clock::now();
+         unique_lock<mutex> lock(stopMutex);
+         while (!stopping) {
+             nextFrame += frameInterval;
+             stopSignal.wait_until(lock, nextFrame, [this]() { return stopping; });
+             lock.unlock();
+             drawFrame(); // Also the final flush once stopping
+             lock.lock();
+         }
+     }
+     
+ public:
+     ConsoleRenderer(int framesPerSecond, bool quiet)
+         : latest(nullptr), snapshotDue(!quiet), quiet(quiet),
+           frameInterval(chrono::duration_cast<chrono::steady_clock::duration>(
+               chrono::duration<double>(1.0 / max(1, framesPerSecond)))),
+           stopping(false) {
+         renderThread = thread(&ConsoleRenderer::renderLoop, this);
+     }
+     
+     ~ConsoleRenderer() {
+         stop();
+         delete latest.exchange(nullptr, memory_order_acq_rel);
+     }
+     
+     ConsoleRenderer(const ConsoleRenderer&) = delete;
+     ConsoleRenderer& operator=(const ConsoleRenderer&) = delete;
+     
+     // Draw what is still pending and release the console
+     void stop() {
+         {
+             lock_guard<mutex> lock(stopMutex);
+             stopping = true;
+         }
+         stopSignal.notify_one();
+         if (renderThread.joinable()) {
+             renderThread.join();
+         }
+     }
+     
+     void postLine(string line) {
+         lines.push(move(line));
+     }
+     
+     // True at most once per frame, and never in quiet mode; capture and post
+     // a snapshot when it is
+     bool wantsSnapshot() {
+         return snapshotDue.exchange(false, memory_order_acq_rel);
+     }
+     
+     void postSnapshot(unique_ptr<StatusSnapshot> snapshot) {
+         delete latest.exchange(snapshot.release(), memory_order_acq_rel);
+     }
+ };
+ 
+ // What a real-time run does with deadlines that passed while a tick ran long
+ enum class OverrunPolicy { CATCH_UP, SKIP };
+ 
+ // Drift-free pacing for real-time runs. Tick n is due at start + n periods
+ // on CLOCK_MONOTONIC and is waited for with an absolute clock_nanosleep, so
+ // time spent ticking and drawing never adds up. A tick released after its
+ // deadline is an overrun. Under CATCH_UP the missed ticks then run back to
+ // back (up to TICK_CATCH_UP_LIMIT) and simulated time stays locked to wall
+ // time; under SKIP they are dropped and the next tick waits for the next
+ // deadline still ahead.
+ class TickClock {
+ private:
+     uint64_t periodNs;
+     OverrunPolicy policy;
+     uint64_t startNs;
+     uint64_t nextTick;      // Deadline index of the next tick
+     uint64_t ticks;         // Released so far
+     uint64_t overruns;
+     uint64_t skipped;       // Deadlines dropped
+     uint64_t lastReleaseNs;
+     LatencyHistogram lateness; // Release time past the deadline, in ns
+     
+     static void sleepUntil(uint64_t ns) {
+         timespec deadline;
+         deadline.tv_sec = ns / 1000000000ull;
+         deadline.tv_nsec = ns % 1000000000ull;
+         while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+         }
+     }
+     
+ public:
+     // ticksPerSecond is the simulated seconds per wall second
+     TickClock(double ticksPerSecond, OverrunPolicy policy)
+         : periodNs(static_cast<uint64_t>(1e9 / ticksPerSecond)), policy(policy), startNs(monotonicNs()),
+           nextTick(0), ticks(0), overruns(0), skipped(0), lastReleaseNs(startNs) {}
+     
+     TickClock(const TickClock&) = delete;
+     TickClock& operator=(const TickClock&) = delete;
+     
+     static const char* policyName(OverrunPolicy policy) {
+         return policy == OverrunPolicy::SKIP ? "skip" : "catch-up";
+     }
+     
+     // Block until the next tick is due. The first is due at once.
+     void waitNextTick() {
+         uint64_t deadline = startNs + nextTick * periodNs;
+         uint64_t now = monotonicNs();
+         if (now < deadline) {
+             sleepUntil(deadline);
+             now = monotonicNs();
+         } else if (nextTick > 0) {
+             overruns++;
+             uint64_t behind = (now - deadline) / periodNs; // Later deadlines also gone by
+             uint64_t drop = (policy == OverrunPolicy::SKIP) ? behind
+                           : (behind > TICK_CATCH_UP_LIMIT ? behind - TICK_CATCH_UP_LIMIT : 0);
+             skipped += drop;
+             nextTick += drop;
+         }
+         lateness.record(now - deadline);
+         lastReleaseNs = now;
+         nextTick++;
+         ticks++;
+     }
+     
+     uint64_t getOverruns() const {
+         return overruns;
+     }
+     
+     uint64_t getSkipped() const {
+         return skipped;
+     }
+     
+     void printStats(ostream& out = cout) const {
+         // How far the last tick fell behind an unbroken schedule
+         double driftMs = ticks ? (static_cast<double>(lastReleaseNs - startNs) -
+                                   static_cast<double>(ticks - 1) * periodNs) / 1e6 : 0.0;
+         out << "\n======== TICK CLOCK ========" << endl;
+         out << "Period: " << fixed << setprecision(1) << periodNs / 1e6 << " ms"
+             << "  Overrun Policy: " << policyName(policy) << endl;
+         out << "Ticks: " << ticks << "  Overruns: " << overruns << "  Skipped: " << skipped << endl;
+         out << "Drift: " << fixed << setprecision(3) << driftMs << " ms" << endl;
+         lateness.print("Tick Lateness", 1e3, "us", out);
+         out << "============================" << endl;
+     }
+ };
+ 
+ // Reads keys from stdin on its own thread, in non-canonical no-echo mode,
+ // so a key press is taken even while a tick or a frame runs long. stop()
+ // wakes the thread through an eventfd and restores the terminal.
+ class KeyboardReader {
+ private:
+     int wakeFd;
+     termios savedSettings;
+     bool terminalSaved;
+     atomic<bool> quit;
+     thread readThread;
+     
+     void readLoop() {
+         pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+         while (true) {
+             if (poll(fds, 2, -1) < 0) {
+                 if (errno == EINTR) {
+                     continue;
+                 }
+                 return;
+             }
+             if (fds[1].revents) {
+                 return;
+             }
+             if (fds[0].revents) {
+                 char c;
+                 if (read(STDIN_FILENO, &c, 1) <= 0) {
+                     return; // End of input: nothing more to read
+                 }
+                 if (c == 'q' || c == 'Q') {
+                     quit.store(true, memory_order_release);
+                 }
+             }
+         }
+     }
+     
+ public:
+     KeyboardReader() : wakeFd(eventfd(0, EFD_CLOEXEC)), terminalSaved(false), quit(false) {
+         terminalSaved = (tcgetattr(STDIN_FILENO, &savedSettings) == 0);
+         if (terminalSaved) {
+             termios raw = savedSettings;
+             raw.c_lflag &= ~(ICANON | ECHO);
+             tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+         }
+         if (wakeFd >= 0) {
+             readThread = thread(&KeyboardReader::readLoop, this);
+         }
+     }
+     
+     ~KeyboardReader() {
+         stop();
+         if (wakeFd >= 0) {
+             ::close(wakeFd);
+         }
+     }
+     
+     KeyboardReader(const KeyboardReader&) = delete;
+     KeyboardReader& operator=(const KeyboardReader&) = delete;
+     
+     void stop() {
+         if (readThread.joinable()) {
+             uint64_t one = 1;
+             ssize_t ignored = write(wakeFd, &one, sizeof(one));
+             (void)ignored;
+             readThread.join();
+         }
+         if (terminalSaved) {
+             tcsetattr(STDIN_FILENO, TCSANOW, &savedSettings);
+             terminalSaved = false;
+         }
+     }
+     
+     // 'q' was pressed
+     bool quitRequested() const {
+         return quit.load(memory_order_acquire);
+     }
+ };
+ 
+ class FlightScheduler {
+ private:
+     SimulationContext context; // RNG and ID counters owned by this run
+     AircraftPool aircraftPool; // Declared first among flight holders so it is destroyed last
+     
+     size_t flightsGenerated; // Numbers new flights
+     size_t completedCount; // Completed flights go back to the pool; their summaries go below
+     RingBuffer<CompletedFlightRecord> completedHistory; // Most recent completions
+     ofstream completedLog; // Every completion as a CSV row, when open
+     vector<shared_ptr<Aircraft>> activeFlights;
+     map<string, shared_ptr<Airline>> airlines;
+     shared_ptr<Airline> airlineById[AIRLINE_COUNT];
+     vector<AirlineId> spawnAirlines; // Airlines new flights are drawn from
+     AVNIndex avnIndex; // AVNs issued in this run, up to the retention limit
+ 
+     int currentSimulationTime;
+     int ticksProcessed; // Seconds actually stepped (seconds with no event are skipped)
+     
+     // Future spawns, earliest first. Same-second events fire in enum order.
+     enum class SimEventType { NORTH_ARRIVAL, SOUTH_ARRIVAL, EAST_DEPARTURE, WEST_DEPARTURE };
+     
+     // What differs between the four spawn streams, indexed by SimEventType
+     struct FlightStream {
+         const char* label; // For the "New ..." log line
+         Direction direction;
+         bool arrival; // Sets the runways its flights can queue for
+         AirlineId emergencyAirline; // Always flies as an emergency on this stream (AIRLINE_COUNT for none)
+         unsigned numberBase;
+     };
+     static const FlightStream FLIGHT_STREAMS[4];
+     
+     struct SimEvent {
+         int time;
+         SimEventType type; // The spawn stream; flight steps have their own calendar below
+         
+         bool operator>(const SimEvent& other) const {
+             if (time != other.time) {
+                 return time > other.time;
+             }
+             return type > other.type;
+         }
+     };
+     priority_queue<SimEvent, vector<SimEvent>, greater<SimEvent>> eventQueue;
+     
+     void scheduleEvent(int time, SimEventType type) {
+         eventQueue.push({time, type});
+     }
+     
+     // Flight step calendar: (second, aircraft id) for each flight's
+     // nextStepTime(), earliest first. An entry whose flight has since been
+     // stepped, rescheduled or completed is dropped when it comes up.
+     typedef pair<int, int> FlightStep;
+     priority_queue<FlightStep, vector<FlightStep>, greater<FlightStep>> stepCalendar;
+     vector<Aircraft*> dueFlights; // Flights this tick steps; every other flight has nothing due
+     int runwayCheckTime; // Next second the runway stage must run after an assignment or release
+     bool completionsDue; // A flight stepped this tick has completed
+     
+     // What one runway step assigned and would have logged, applied serially
+     struct RunwayStepResult {
+         vector<shared_ptr<Aircraft>> assigned;
+         vector<string> log;
+         vector<pair<int, Runway>> released; // Flights that left the step's runways
+         
+         void clear() {
+             assigned.clear();
+             log.clear();
+             released.clear();
+         }
+     };
+     
+     // One runway and the queue of flights waiting for it. During assignment
+     // each ordinary runway belongs to one shard and the priority runways to
+     // the merge step, so they need no locks.
+     struct RunwayState {
+         bool available = true;
+         int freeTime = 0;
+         shared_ptr<Aircraft> occupant;
+         RunwayQueue queue;
+         size_t step = 0; // Index of the step its assignments and release go to
+     };
+     
+     RunwayTopology topology;
+     vector<RunwayState> runways;
+     vector<int> shardRunways;    // Ordinary runways, one shard step each
+     vector<int> priorityRunways; // Cargo/emergency runways, all in the last (merge) step
+     vector<int> joinRunways[2];  // Queues new departures [0] and arrivals [1] may join
+     vector<RunwayStepResult> runwaySteps;
+     
+     RunwayPolicy runwayPolicy;
+     
+     // The run's rules match ProductionRules, so new flights are created on
+     // the fixed instantiation instead of LoadedRules
+     bool productionRules;
+     
+     // Threads for the parallel stages of a tick
+     unique_ptr<TickWorkerPool> tickWorkers;
+     
+     // Always-on instrumentation, recorded by the thread running the ticks
+     struct TickStats {
+         LatencyHistogram generate, assign, update, emit, move; // ns per tick stage
+         LatencyHistogram queueWait; // Simulated seconds from enqueue to runway assignment
+     };
+     TickStats stats;
+     
+     AVNEventRing* avnRing; // Channel to the AVN Generator (null when headless)
+     const AVNLedger* ledger; // Read-only view of the generator's AVN ledger (null when headless)
+     uint64_t paidCursor;     // Ledger payments already applied to the AVNs held here
+     deque<IPCMessage> pendingAVNEvents; // Waiting for ring space, sent first next tick
+     
+     ScheduleLoader* schedule; // Timetable flown instead of the spawn streams (null for none)
+     
+     // Trace being recorded or replayed (at most one is set)
+     TraceWriter* traceOut;
+     TraceReader* traceIn;
+     vector<TraceRecord> runwayEvents; // This tick's runway events
+     vector<TraceRecord> tracedRunwayEvents; // Replay: the recorded ones, checked against runwayEvents
+     size_t traceDivergences; // Replay: recorded outcomes that did not line up with the run
+     bool verbose; // Print per-event log lines to the console
+     ConsoleRenderer* renderer; // Takes the log lines while the interactive simulation runs
+     
+     // Run metrics
+     AnalyticsEngine analytics;
+     long long totalQueueWait;
+     int maxQueueWait;
+     int runwayAssignments;
+     
+     // Verbose event line: through the renderer when one is attached, else
+     // straight to the console
+     void logLine(string line) {
+         if (renderer) {
+             renderer->postLine(move(line));
+             return;
+         }
+         lock_guard<mutex> lock(cout_mutex);
+         cout << line << endl;
+     }
+     
+     void recordQueueWait(const shared_ptr<Aircraft>& aircraft) {
+         int wait = currentSimulationTime - aircraft->queuedAt;
+         totalQueueWait += wait;
+         maxQueueWait = max(maxQueueWait, wait);
+         runwayAssignments++;
+         stats.queueWait.record(wait);
+         analytics.runwayAssigned(aircraft->assignedRunway, aircraft->type, wait, currentSimulationTime);
+     }
+     
+ public:
+     FlightScheduler(AVNEventRing* avnRing, unsigned seed = random_device{}()) : context(seed),
+     flightsGenerated(0), completedCount(0), completedHistory(COMPLETED_HISTORY), currentSimulationTime(0), 
+     ticksProcessed(0), runwayCheckTime(NO_EVENT_TIME), completionsDue(false),
+     runwayPolicy(RunwayPolicy::GREEDY), productionRules(true),
+     tickWorkers(new TickWorkerPool(1)), avnRing(avnRing), ledger(nullptr), paidCursor(0),
+     schedule(nullptr), traceOut(nullptr), traceIn(nullptr), traceDivergences(0), verbose(true), renderer(nullptr),
+     totalQueueWait(0), maxQueueWait(0), runwayAssignments(0) {
+     setTopology(RunwayTopology());
+     
+     // Initialize airlines
+     for (int id = 0; id < AIRLINE_COUNT; id++) {
+         const AirlineProfile& profile = AIRLINE_PROFILES[id];
+         airlineById[id] = make_shared<Airline>(profile.name, profile.totalAircrafts, profile.activeFlights);
+         airlines[profile.name] = airlineById[id];
+         if (profile.activeFlights > 0) {
+             spawnAirlines.push_back(static_cast<AirlineId>(id));
+         }
+     }
+     avnIndex.setLimit(AVN_RETENTION);
+     
+     // First flight of each stream, then every *_INTERVAL seconds
+     scheduleEvent(1, SimEventType::NORTH_ARRIVAL);
+     scheduleEvent(2, SimEventType::SOUTH_ARRIVAL);
+     scheduleEvent(3, SimEventType::EAST_DEPARTURE);
+     scheduleEvent(4, SimEventType::WEST_DEPARTURE);
+     }
+     
+     // One simulated second. Each stage's time goes into its histogram and,
+     // with phases set, is added to it as well.
+     void updateSimulation(TickPhaseTimes* phases = nullptr) {
+         uint64_t mark = monotonicNs();
+         auto lap = [&](LatencyHistogram& histogram, double TickPhaseTimes::*phase) {
+             uint64_t now = monotonicNs();
+             histogram.record(now - mark);
+             if (phases) {
+                 phases->*phase += now - mark;
+             }
+             mark = now;
+         };
+         
+         currentSimulationTime++;
+         ticksProcessed++;
+         
+         // Generate new flights
+         generateFlights();
+         lap(stats.generate, &TickPhaseTimes::generateNs);
+         
+         // Assign runways
+         assignRunways();
+         lap(stats.assign, &TickPhaseTimes::assignNs);
+         
+         // Update active flights, then issue their AVNs
+         updateFlights();
+         lap(stats.update, &TickPhaseTimes::updateNs);
+         emitViolations();
+         flushAVNEvents();
+         scheduleFlightSteps();
+         lap(stats.emit, &TickPhaseTimes::emitNs);
+         syncLedgerPayments();
+         
+         // Move completed flights
+         moveCompletedFlights();
+         lap(stats.move, &TickPhaseTimes::moveNs);
+     }
+     
+     int getCurrentTime() const {
+         return currentSimulationTime;
+     }
+     
+     void setVerbose(bool enabled) {
+         verbose = enabled;
+     }
+     
+     // Runway allocation policy. Call before the first tick.
+     void setRunwayPolicy(RunwayPolicy policy) {
+         runwayPolicy = policy;
+     }
+     
+     // Lay out the runways. Ordinary runways are each assigned by their own
+     // shard and priority runways by the merge step. New flights join the
+     // queue of an ordinary runway of their direction, or of a priority
+     // runway if their direction has no ordinary one. Call before the first tick.
+     void setTopology(const RunwayTopology& layout) {
+         topology = layout;
+         runways.clear();
+         runways.resize(layout.size());
+         shardRunways.clear();
+         priorityRunways.clear();
+         for (int runway = 0; runway < static_cast<int>(layout.size()); runway++) {
+             (layout.isPriorityRunway(runway) ? priorityRunways : shardRunways).push_back(runway);
+         }
+         for (int arrival = 0; arrival < 2; arrival++) {
+             joinRunways[arrival].clear();
+             for (int runway : shardRunways) {
+                 if (layout.serves(runway, arrival)) {
+                     joinRunways[arrival].push_back(runway);
+                 }
+             }
+             if (joinRunways[arrival].empty()) {
+                 for (int runway : priorityRunways) {
+                     if (layout.serves(runway, arrival)) {
+                         joinRunways[arrival].push_back(runway);
+                     }
+                 }
+             }
+         }
+         for (size_t shard = 0; shard < shardRunways.size(); shard++) {
+             runways[shardRunways[shard]].step = shard;
+         }
+         for (int runway : priorityRunways) {
+             runways[runway].step = shardRunways.size();
+         }
+         runwaySteps.assign(shardRunways.size() + 1, RunwayStepResult());
+         analytics.setRunwayCount(layout.size());
+     }
+     
+     const RunwayTopology& getTopology() const {
+         return topology;
+     }
+     
+     void configureRunways(const RunwayConfig& config) {
+         setTopology(config.topology);
+         setRunwayPolicy(config.policy);
+     }
+     
+     RunwayPolicy getRunwayPolicy() const {
+         return runwayPolicy;
+     }
+     
+     static const char* policyName(RunwayPolicy policy) {
+         return policy == RunwayPolicy::LOOKAHEAD ? "lookahead" : "greedy";
+     }
+     
+     // Read AVN history from the ledger, and number new AVNs after its last
+     // one so ids stay unique across runs. Call before the first tick.
+     void attachLedger(const AVNLedger* avnLedger) {
+         ledger = avnLedger;
+         if (ledger) {
+             context.nextAVNId = ledger->nextId();
+             paidCursor = ledger->paidSequence();
+         }
+     }
+     
+     // The AVN held here for a payment the ledger recorded, marked paid
+     void applyLedgerPayment(int avnId) {
+         AVN* avn = avnIndex.find(avnId);
+         if (!avn || avn->status == PaymentStatus::PAID) {
+             return; // Evicted, or paid from this console
+         }
+         AirlineId airline = AnalyticsEngine::airlineNamed(avn->airline);
+         if (airline != AIRLINE_COUNT) {
+             // The ledger keeps no paid amount; payments are for the full fine
+             analytics.avnPaid(airline, avn->totalAmount, avn->totalAmount);
+         }
+         avnIndex.markPaid(avnId);
+     }
+     
+     // The ledger is the record of payment. Payments made through a portal
+     // or StripePay reach only the generator, which flips them there and
+     // logs them, so apply the payments logged since the last call to the
+     // AVNs still held here. The held copies stay because an AVN exists here
+     // a tick before the generator appends it. A tick without payments costs
+     // one load of the ledger's payment count.
+     void syncLedgerPayments() {
+         if (!ledger || ledger->paidSequence() == paidCursor) {
+             return;
+         }
+         if (ledger->forEachPaidSince(paidCursor, [this](int avnId) { applyLedgerPayment(avnId); })) {
+             return;
+         }
+         
+         // Lapped by the payment log: check every held unpaid AVN instead
+         vector<int> paidInLedger;
+         avnIndex.forEachUnpaid([this, &paidInLedger](const AVN& avn) {
+             const LedgerRecord* record = ledger->find(avn.id);
+             if (record && record->status.load(memory_order_acquire) == static_cast<uint8_t>(PaymentStatus::PAID)) {
+                 paidInLedger.push_back(avn.id);
+             }
+         });
+         for (int avnId : paidInLedger) {
+             applyLedgerPayment(avnId);
+         }
+     }
+     
+     // Apply a retention policy. Opening the completion log may fail, in
+     // which case an error is printed and false returned.
+     bool setRetention(const RetentionConfig& retention) {
+         avnIndex.setLimit(retention.avnLimit);
+         for (auto& airline : airlineById) {
+             lock_guard<mutex> lock(airline->violationsMutex);
+             airline->violationLimit = retention.avnLimit;
+         }
+         completedHistory.reset(retention.completedHistory);
+         
+         if (completedLog.is_open()) {
+             completedLog.close();
+         }
+         if (retention.completedLog.empty()) {
+             return true;
+         }
+         completedLog.open(retention.completedLog, ios::out | ios::trunc);
+         if (!completedLog) {
+             cerr << "Cannot open completed-flight log " << retention.completedLog << ": " << strerror(errno) << endl;
+             return false;
+         }
+         completedLog << "id,flight,airline,type,direction,emergency,queued_at,completed_at,violations\n";
+         return true;
+     }
+     
+     // Fly a timetable instead of the fixed-interval spawn streams. Rows are
+     // read as simulated time reaches them. Call before the first tick.
+     void attachSchedule(ScheduleLoader* loader) {
+         schedule = loader;
+     }
+     
+     // Write every random outcome of this run to a trace. Call before the first tick.
+     void recordTrace(TraceWriter* writer) {
+         traceOut = writer;
+     }
+     
+     // Take flights and their random outcomes from a recorded trace instead
+     // of the event schedule and the RNG. Call before the first tick.
+     void replayTrace(TraceReader* reader) {
+         traceIn = reader;
+     }
+     
+     size_t getTraceDivergences() const {
+         return traceDivergences;
+     }
+     
+     // Route log lines through a renderer (nullptr prints them directly)
+     void setRenderer(ConsoleRenderer* consoleRenderer) {
+         renderer = consoleRenderer;
+     }
+     
+     // Tick stage and runway queue histograms for this scheduler
+     void printLatencyStats() const {
+         lock_guard<mutex> lock(cout_mutex);
+         cout << "\n======== ATC LATENCY STATISTICS ========" << endl;
+         stats.generate.print("Stage: generateFlights", 1e3, "us");
+         stats.assign.print("Stage: assignRunways", 1e3, "us");
+         stats.update.print("Stage: updateFlights", 1e3, "us");
+         stats.emit.print("Stage: emitViolations", 1e3, "us");
+         stats.move.print("Stage: moveCompleted", 1e3, "us");
+         stats.queueWait.print("Runway Queue Wait", 1.0, "s");
+         cout << "========================================" << endl;
+     }
+     
+     // Ask the AVN Generator to print its statistics. The request queues
+     // behind any pending AVN events, so those are counted.
+     void requestGeneratorStats() {
+         if (!avnRing) {
+             return;
+         }
+         IPCMessage message;
+         message.type = MessageType::STATS_DUMP;
+         pendingAVNEvents.push_back(message);
+         flushAVNEvents();
+     }
+     
+     // Rules for flights and spawns from now on; also resets the violation
+     // odds to the set's. Set before the run, as trace replay assumes the
+     // recorded run's rules.
+     void setRules(const RuleSet& rules) {
+         context.rules = rules;
+         context.profiles = SpeedProfiles(rules);
+         context.violationPercent = rules.violationPercent;
+         productionRules = (rules == ProductionRules::get(nullptr));
+     }
+     
+     const RuleSet& getRules() const {
+         return context.rules;
+     }
+     
+     // Whether flights run on the compile-time rule set
+     bool usesProductionRules() const {
+         return productionRules;
+     }
+     
+     // Emergency odds for every stream (-1 keeps the per-direction defaults)
+     // and violation odds for flights created from now on
+     void setTrafficRates(int emergencyPercent, int violationPercent) {
+         context.emergencyPercent = emergencyPercent;
+         context.violationPercent = violationPercent;
+     }
+     
+     // Create flights outside the event schedule, cycling through the four
+     // streams, until target flights are active. Used by --bench.
+     void spawnFlights(size_t target) {
+         for (size_t i = 0; activeFlights.size() < target; i++) {
+             spawnFlight(FLIGHT_STREAMS[i % 4]);
+             activeFlights.back()->lastUpdate = currentSimulationTime; // First stepped next tick
+         }
+     }
+     
+     size_t getActiveFlightCount() const {
+         return activeFlights.size();
+     }
+     
+     size_t getAircraftPoolBytes() const {
+         return aircraftPool.reservedBytes();
+     }
+     
+     // Threads used to step flights and run the runway shards within a tick.
+     // Results do not depend on the count.
+     void setTickThreads(int threadCount) {
+         tickWorkers.reset(new TickWorkerPool(max(1, threadCount)));
+     }
+     
+     // Second of the next event: a spawn (the next traced tick when
+     // replaying, the next timetable row when flying one), a flight's next
+     // step, the runway stage following up an assignment or release, or AVN
+     // events still waiting for ring space. -1 if none is pending.
+     int nextEventTime() {
+         int next = NO_EVENT_TIME;
+         if (traceIn) {
+             if (traceIn->peekTick() >= 0) {
+                 next = traceIn->peekTick();
+             }
+         } else if (schedule) {
+             if (schedule->peekTime() >= 0) {
+                 next = schedule->peekTime();
+             }
+         } else if (!eventQueue.empty()) {
+             next = eventQueue.top().time;
+         }
+         next = min(next, nextFlightStep());
+         next = min(next, runwayCheckTime);
+         if (!pendingAVNEvents.empty()) {
+             next = min(next, currentSimulationTime + 1);
+         }
+         return (next == NO_EVENT_TIME) ? -1 : next;
+     }
+     
+     // Queue a new flight joins: the least loaded (flights waiting, plus one
+     // if the runway is held) of those its direction may join, the lowest
+     // runway on ties
+     int joinRunwayFor(bool arrival) const {
+         const vector<int>& candidates = joinRunways[arrival];
+         auto load = [this](int runway) {
+             return runways[runway].queue.size() + (isRunwayFree(runway) ? 0 : 1);
+         };
+         int best = candidates.front();
+         for (int runway : candidates) {
+             if (load(runway) < load(best)) {
+                 best = runway;
+             }
+         }
+         return best;
+     }
+     
+     // Advance to endTime, jumping from each event to the next. A second in
+     // which no flight spawns, changes state or has a violation roll come up,
+     // and no runway is assigned or released, changes nothing and is skipped.
+     void runUntil(int endTime) {
+         while (currentSimulationTime < endTime) {
+             int next = nextEventTime();
+             int target = (next < 0) ? endTime : min(next, endTime);
+             if (target - 1 > currentSimulationTime) {
+                 currentSimulationTime = target - 1;
+             }
+             updateSimulation();
+         }
+     }
+     
+     // Everything about a new flight that is drawn or read from a timetable
+     struct FlightSpawn {
+         bool isEmergency;
+         AirlineId airline;
+         FlightType type;
+         FlightNumber flightNumber; // Empty to number it from the stream
+         int initialSpeed;
+     };
+     
+     // Type of a generated flight: emergencies, and every flight of the
+     // stream's emergency airline, fly as EMERGENCY
+     static FlightType streamFlightType(const FlightStream& stream, bool isEmergency, AirlineId airline) {
+         if (isEmergency || airline == stream.emergencyAirline) {
+             return FlightType::EMERGENCY;
+         }
+         return AIRLINE_PROFILES[airline].cargo ? FlightType::CARGO : FlightType::COMMERCIAL;
+     }
+     
+     // Draw an arrival's holding speed from its type's profile
+     void drawFlightRandom(const FlightStream& stream, FlightSpawn& spawn) {
+         spawn.initialSpeed = 0;
+         if (stream.arrival) {
+             spawn.initialSpeed = context.profiles.entrySpeed(spawn.type, ARRIVAL_LIMITS,
+                                                              static_cast<int>(ArrivalState::HOLDING), context.rng);
+         }
+     }
+     
+     // Create one flight on a stream and queue it for its runway
+     void spawnFlight(const FlightStream& stream) {
+         FlightSpawn spawn;
+         context.rng.enterTick(currentSimulationTime);
+         
+         // Determine if this is an emergency
+         uniform_int_distribution<> emergencyDist(1, 100);
+         spawn.isEmergency = (emergencyDist(context.rng) <= context.emergencyOdds(context.rules.emergencyPercent[&stream - FLIGHT_STREAMS]));
+         
+         // Select airline randomly
+         uniform_int_distribution<> airlineDist(0, spawnAirlines.size() - 1);
+         spawn.airline = spawnAirlines[airlineDist(context.rng)];
+         spawn.type = streamFlightType(stream, spawn.isEmergency, spawn.airline);
+         
+         drawFlightRandom(stream, spawn);
+         launchFlight(stream, spawn);
+     }
+     
+     // A timetable row flies on the stream for its direction
+     void spawnScheduledFlight(const ScheduledFlight& row) {
+         const FlightStream& stream = FLIGHT_STREAMS[static_cast<int>(row.direction)]; // Streams are in Direction order
+         FlightSpawn spawn;
+         spawn.isEmergency = (row.type == FlightType::EMERGENCY);
+         spawn.airline = row.airline;
+         spawn.type = row.type;
+         spawn.flightNumber = row.flightNumber;
+         context.rng.enterTick(currentSimulationTime);
+         drawFlightRandom(stream, spawn);
+         launchFlight(stream, spawn);
+     }
+     
+     // Aircraft and control block come from the pool
+     template <typename Rules>
+     shared_ptr<Aircraft> createFlight(const FlightStream& stream, const FlightSpawn& spawn,
+                                       const FlightNumber& flightNumber, int priority) {
+         if (stream.arrival) {
+             return allocate_shared<ArrivalFlight<Rules>>(
+                 AircraftPoolAllocator<ArrivalFlight<Rules>>(&aircraftPool),
+                 context, flightNumber, spawn.airline, spawn.type, stream.direction, priority, chrono::system_clock::now(),
+                 spawn.initialSpeed);
+         }
+         return allocate_shared<DepartureFlight<Rules>>(
+             AircraftPoolAllocator<DepartureFlight<Rules>>(&aircraftPool),
+             context, flightNumber, spawn.airline, spawn.type, stream.direction, priority, chrono::system_clock::now());
+     }
+     
+     void launchFlight(const FlightStream& stream, const FlightSpawn& spawn) {
+         bool isEmergency = spawn.isEmergency;
+         AirlineId airline = spawn.airline;
+         FlightType type = spawn.type;
+         
+         FlightNumber flightNumber = spawn.flightNumber;
+         if (flightNumber.text[0] == '\0') {
+             flightNumber = FlightNumber(AIRLINE_PROFILES[airline].name, stream.numberBase + flightsGenerated);
+         }
+         flightsGenerated++;
+         
+         // Set priority (emergency = 3, cargo = 2, commercial = 1)
+         int priority = (isEmergency) ? 3 : ((type == FlightType::CARGO) ? 2 : 1);
+         
+         shared_ptr<Aircraft> flight = productionRules
+             ? createFlight<ProductionRules>(stream, spawn, flightNumber, priority)
+             : createFlight<LoadedRules>(stream, spawn, flightNumber, priority);
+         flight->isEmergency = isEmergency;
+         flight->queuedAt = currentSimulationTime;
+         flight->lastUpdate = currentSimulationTime - 1; // Stepped for the first time this tick
+         
+         if (traceOut) {
+             flight->traceMode = TraceMode::RECORD;
+             uint8_t streamIndex = &stream - FLIGHT_STREAMS;
+             traceOut->add({static_cast<uint32_t>(currentSimulationTime), flight->id, TRACE_SPAWN,
+                            static_cast<uint8_t>(streamIndex | (isEmergency ? 4 : 0) | (airline << 3)),
+                            static_cast<uint16_t>(spawn.initialSpeed), context.seed});
+         } else if (traceIn) {
+             flight->traceMode = TraceMode::REPLAY;
+         }
+         
+         activeFlights.push_back(flight);
+         dueFlights.push_back(flight.get());
+         runways[joinRunwayFor(stream.arrival)].queue.push(flight);
+         
+         if (verbose) {
+             logLine(string("\nNew ") + stream.label + ": " + flight->getSummary());
+         }
+     }
+     
+     // Fire every spawn event (or timetable row) that is due this second
+     void generateFlights() {
+         if (traceIn) {
+             replayTick();
+             return;
+         }
+         if (schedule) {
+             ScheduledFlight row;
+             while (schedule->peekTime() >= 0 && schedule->peekTime() <= currentSimulationTime && schedule->next(row)) {
+                 spawnScheduledFlight(row);
+             }
+             return;
+         }
+         while (!eventQueue.empty() && eventQueue.top().time <= currentSimulationTime) {
+             SimEvent event = eventQueue.top();
+             eventQueue.pop();
+             
+             const FlightStream& stream = FLIGHT_STREAMS[static_cast<int>(event.type)];
+             spawnFlight(stream);
+             scheduleEvent(event.time + context.rules.streamInterval[static_cast<int>(event.type)], event.type);
+         }
+     }
+     
+     // Replay: read this second's records. Spawns are launched, flight
+     // outcomes handed to their flights for the update stage, and runway
+     // events kept to check against the runway stage.
+     void replayTick() {
+         tracedRunwayEvents.clear();
+         TraceRecord record;
+         while (traceIn->peekTick() >= 0 && traceIn->peekTick() <= currentSimulationTime && traceIn->next(record)) {
+             if (static_cast<int>(record.tick) != currentSimulationTime) {
+                 traceDivergences++; // Skipped past; only possible in a damaged trace
+                 continue;
+             }
+             switch (record.kind) {
+                 case TRACE_SPAWN: {
+                     const FlightStream& stream = FLIGHT_STREAMS[record.a & 3];
+                     FlightSpawn spawn;
+                     spawn.isEmergency = (record.a & 4) != 0;
+                     spawn.airline = static_cast<AirlineId>(record.a >> 3);
+                     spawn.initialSpeed = record.b;
+                     if (record.aircraftId != context.nextAircraftId || spawn.airline >= AIRLINE_COUNT) {
+                         traceDivergences++;
+                     }
+                     if (spawn.airline < AIRLINE_COUNT) {
+                         spawn.type = streamFlightType(stream, spawn.isEmergency, spawn.airline);
+                         launchFlight(stream, spawn);
+                     }
+                     break;
+                 }
+                 case TRACE_SPEED:
+                 case TRACE_VIOLATION: {
+                     Aircraft* flight = findActiveFlight(record.aircraftId);
+                     if (!flight) {
+                         traceDivergences++;
+                         break;
+                     }
+                     flight->traceDecisions.push_back({static_cast<TraceKind>(record.kind), static_cast<int>(record.value)});
+                     dueFlights.push_back(flight); // Its outcome is used by this tick's update
+                     break;
+                 }
+                 case TRACE_RUNWAY_ASSIGN:
+                 case TRACE_RUNWAY_RELEASE:
+                     tracedRunwayEvents.push_back(record);
+                     break;
+                 default:
+                     traceDivergences++;
+                     break;
+             }
+         }
+     }
+     
+     // A flight's outcomes from this tick's update: written to the trace when
+     // recording; when replaying, any left unused are divergences
+     void drainTrace(Aircraft& flight) {
+         if (traceOut) {
+             for (const TraceDecision& decision : flight.traceDecisions) {
+                 traceOut->add({static_cast<uint32_t>(currentSimulationTime), flight.id, decision.kind, 0, 0,
+                                static_cast<uint32_t>(decision.value)});
+             }
+         } else {
+             traceDivergences += flight.traceDecisions.size() + flight.traceMisses;
+             flight.traceMisses = 0;
+         }
+         flight.traceDecisions.clear();
+     }
+     
+     // Record this tick's runway events, or compare them with the recorded ones
+     void traceRunwayEvents() {
+         if (traceOut) {
+             for (const TraceRecord& record : runwayEvents) {
+                 traceOut->add(record);
+             }
+         } else if (runwayEvents != tracedRunwayEvents) {
+             size_t matching = 0;
+             while (matching < min(runwayEvents.size(), tracedRunwayEvents.size()) &&
+                    runwayEvents[matching] == tracedRunwayEvents[matching]) {
+                 matching++;
+             }
+             traceDivergences += max(runwayEvents.size(), tracedRunwayEvents.size()) - matching;
+         }
+     }
+     
+     bool isRunwayFree(int runway) const {
+         const RunwayState& state = runways[runway];
+         return state.available && currentSimulationTime >= state.freeTime;
+     }
+     
+     bool canUse(int runway, const Aircraft& aircraft) const {
+         return topology.serves(runway, aircraft.isArrival());
+     }
+     
+     // A priority runway of the flight's direction takes its type first.
+     // With free set, only a priority runway that is free right now counts.
+     bool prefersPriorityRunway(const Aircraft& aircraft, bool free) const {
+         for (int runway : priorityRunways) {
+             if (topology.prefers(runway, aircraft.type) && canUse(runway, aircraft) && (!free || isRunwayFree(runway))) {
+                 return true;
+             }
+         }
+         return false;
+     }
+     
+     // Give runway to aircraft if it is free right now. Stats and log lines go
+     // to the step's result and are applied once all shards are done.
+     bool tryOccupyRunway(int runway, const shared_ptr<Aircraft>& aircraft, const char* note, RunwayStepResult& result) {
+         if (!isRunwayFree(runway)) {
+             return false;
+         }
+         RunwayState& state = runways[runway];
+         state.available = false;
+         state.occupant = aircraft;
+         aircraft->assignedRunway = static_cast<Runway>(runway);
+         result.assigned.push_back(aircraft);
+         if (verbose) {
+             result.log.push_back("Assigned " + aircraft->getRunwayString() + note + " to " +
+                                  aircraft->flightNumber.str() + " (" + aircraft->airline + ")");
+         }
+         return true;
+     }
+     
+     // Shard step: an ordinary runway's queue onto that runway, touching
+     // nothing else. A head that prefers a free priority runway is left for
+     // the merge step. Priority runways are only read here, never written.
+     void assignShard(int runway, RunwayStepResult& result) {
+         RunwayQueue& queue = runways[runway].queue;
+         while (!queue.empty() && isRunwayFree(runway)) {
+             if (prefersPriorityRunway(*queue.top(), true)) {
+                 break;
+             }
+             tryOccupyRunway(runway, queue.top(), "", result);
+             queue.pop();
+         }
+     }
+     
+     // Merge step, run on one thread after the shards. Each free priority
+     // runway, in runway order, goes to the highest priority head that wants
+     // it (its type is preferred there, it heads the runway's own queue, or it
+     // is a non-cargo head whose own runway is busy), ties going to the lower
+     // runway's queue. Heads that lost a priority runway they preferred then
+     // fall back to their own runway, and idle ordinary runways take from
+     // busy ones.
+     void mergePriorityRunways(RunwayStepResult& result) {
+         CompareAircraftPriority lowerPriority;
+         
+         for (int runway : priorityRunways) {
+             if (!isRunwayFree(runway)) {
+                 continue;
+             }
+             int best = -1;
+             for (size_t owner = 0; owner < runways.size(); owner++) {
+                 const RunwayQueue& queue = runways[owner].queue;
+                 if (queue.empty() || !canUse(runway, *queue.top())) {
+                     continue;
+                 }
+                 const shared_ptr<Aircraft>& head = queue.top();
+                 bool wants = topology.prefers(runway, head->type) || static_cast<int>(owner) == runway ||
+                              (head->type != FlightType::CARGO && !isRunwayFree(owner));
+                 if (wants && (best < 0 || lowerPriority(runways[best].queue.top(), head))) {
+                     best = owner;
+                 }
+             }
+             if (best >= 0) {
+                 RunwayQueue& queue = runways[best].queue;
+                 bool fallback = !topology.prefers(runway, queue.top()->type) && best != runway;
+                 tryOccupyRunway(runway, queue.top(), fallback ? " (fallback)" : "", result);
+                 queue.pop();
+             }
+         }
+         
+         for (int runway : shardRunways) {
+             RunwayQueue& queue = runways[runway].queue;
+             if (!queue.empty() && prefersPriorityRunway(*queue.top(), false) &&
+                 tryOccupyRunway(runway, queue.top(), "", result)) {
+                 queue.pop();
+             }
+         }
+         
+         // An idle ordinary runway takes a waiting flight from a busy one
+         for (int runway : shardRunways) {
+             int owner;
+             if (isRunwayFree(runway) && runways[runway].queue.empty() && (owner = stealFrom(runway)) >= 0) {
+                 tryOccupyRunway(runway, runways[owner].queue.top(), "", result);
+                 runways[owner].queue.pop();
+             }
+         }
+     }
+     
+     // Queue a free ordinary runway with nothing of its own waiting takes
+     // from: the one with the highest priority head it can serve, among
+     // ordinary runways that are busy, or -1 for none
+     int stealFrom(int runway) const {
+         CompareAircraftPriority lowerPriority;
+         int best = -1;
+         for (int owner : shardRunways) {
+             const RunwayQueue& queue = runways[owner].queue;
+             if (owner == runway || queue.empty() || isRunwayFree(owner) || !canUse(runway, *queue.top())) {
+                 continue;
+             }
+             if (best < 0 || lowerPriority(runways[best].queue.top(), queue.top())) {
+                 best = owner;
+             }
+         }
+         return best;
+     }
+     
+     // Seconds until runway can next be assigned: the rest of its occupant's
+     // predicted time on it, plus the tick it takes to be released
+     int predictedFreeIn(int runway) const {
+         if (isRunwayFree(runway)) {
+             return 0;
+         }
+         const shared_ptr<Aircraft>& occupant = runways[runway].occupant;
+         if (!occupant) {
+             return RUNWAY_LOOKAHEAD_HORIZON;
+         }
+         return min(RUNWAY_LOOKAHEAD_HORIZON, occupant->runwayTimeRemaining(currentSimulationTime - 1) + 1);
+     }
+     
+     // Which flight a free runway should take from its own queue next: the
+     // head, unless it is not ready yet (an arrival still serving its holding
+     // time) and serving one of the next queue entries first costs less
+     // weighted delay. Each order costs the waiting flight's priority times
+     // the seconds it would be kept past its own ready time. Emergencies
+     // never yield. Flights are read as of the end of second asOf.
+     static shared_ptr<Aircraft> chooseForRunway(const RunwayQueue& queue, int asOf) {
+         shared_ptr<Aircraft> head = queue.top();
+         if (head->priority >= 3 || head->runwayLeadTime(asOf) == 0) {
+             return head;
+         }
+         shared_ptr<Aircraft> choice = head;
+         long long bestMargin = 0;
+         for (size_t slot = 1; slot < min<size_t>(3, queue.size()); slot++) {
+             const shared_ptr<Aircraft>& candidate = queue.at(slot);
+             long long headFirst = static_cast<long long>(candidate->priority) *
+                                   max(0, head->runwayTimeRemaining(asOf) - candidate->runwayLeadTime(asOf));
+             long long candidateFirst = static_cast<long long>(head->priority) *
+                                        max(0, candidate->runwayTimeRemaining(asOf) - head->runwayLeadTime(asOf));
+             if (headFirst - candidateFirst > bestMargin) {
+                 choice = candidate;
+                 bestMargin = headFirst - candidateFirst;
+             }
+         }
+         return choice;
+     }
+     
+     // Lookahead policy, run serially in place of the shards and merge step.
+     // Priority-3 emergencies are served first, a free priority runway and
+     // their own runway otherwise, exactly as the greedy policy does. Free
+     // ordinary runways then go to chooseForRunway() on their own queue, or
+     // on a busy runway's queue when theirs is empty. Each free priority
+     // runway goes to the head whose queue it saves the most priority-weighted
+     // delay: the queue's total priority times the seconds until its own
+     // runway frees (the whole horizon for the priority runway's own queue),
+     // less the seconds the runway would sit unused before the head needs it.
+     void planRunways() {
+         CompareAircraftPriority lowerPriority;
+         int asOf = currentSimulationTime - 1; // Flights as they stood at the end of last second
+         
+         // Results go to the runway's own step, as in the greedy policy
+         auto assign = [&](int runway, int owner, shared_ptr<Aircraft> aircraft) {
+             bool fallback = topology.isPriorityRunway(runway) && owner != runway &&
+                             !topology.prefers(runway, aircraft->type);
+             runways[owner].queue.remove(aircraft);
+             tryOccupyRunway(runway, aircraft, fallback ? " (fallback)" : "", runwaySteps[runways[runway].step]);
+         };
+         
+         for (int runway : priorityRunways) {
+             if (!isRunwayFree(runway)) {
+                 continue;
+             }
+             int best = -1;
+             for (size_t owner = 0; owner < runways.size(); owner++) {
+                 const RunwayQueue& queue = runways[owner].queue;
+                 if (!queue.empty() && queue.top()->priority >= 3 && canUse(runway, *queue.top()) &&
+                     (best < 0 || lowerPriority(runways[best].queue.top(), queue.top()))) {
+                     best = owner;
+                 }
+             }
+             if (best >= 0) {
+                 assign(runway, best, runways[best].queue.top());
+             }
+         }
+         for (int runway : shardRunways) {
+             if (!isRunwayFree(runway)) {
+                 continue;
+             }
+             int owner = runways[runway].queue.empty() ? stealFrom(runway) : runway;
+             if (owner >= 0) {
+                 assign(runway, owner, chooseForRunway(runways[owner].queue, asOf));
+             }
+         }
+         
+         for (int runway : priorityRunways) {
+             if (!isRunwayFree(runway)) {
+                 continue;
+             }
+             int best = -1;
+             long long bestSaving = 0;
+             for (size_t owner = 0; owner < runways.size(); owner++) {
+                 const RunwayQueue& queue = runways[owner].queue;
+                 if (queue.empty() || !canUse(runway, *queue.top())) {
+                     continue;
+                 }
+                 int delay = (static_cast<int>(owner) == runway) ? RUNWAY_LOOKAHEAD_HORIZON : predictedFreeIn(owner);
+                 long long saving = queue.getPrioritySum() * max(0, delay - queue.top()->runwayLeadTime(asOf));
+                 if (saving > bestSaving ||
+                     (best >= 0 && saving == bestSaving && lowerPriority(runways[best].queue.top(), queue.top()))) {
+                     best = owner;
+                     bestSaving = saving;
+                 }
+             }
+             if (best >= 0) {
+                 assign(runway, best, runways[best].queue.top());
+             }
+         }
+     }
+     
+     void releaseRunway(int runway, RunwayStepResult& result) {
+         RunwayState& state = runways[runway];
+         shared_ptr<Aircraft> flight = state.occupant;
+         if (!flight || !flight->hasClearedRunway()) {
+             return;
+         }
+         
+         string runwayName = flight->getRunwayString();
+         result.released.push_back({flight->id, flight->assignedRunway});
+         flight->assignedRunway = Runway::NONE;
+         state.available = true;
+         state.occupant.reset();
+         state.freeTime = currentSimulationTime;
+         if (verbose) {
+             result.log.push_back("Released " + runwayName + " from " + flight->flightNumber.str() + " (" + flight->airline + ")");
+         }
+     }
+     
+     void assignRunways() {
+         if (runwayCheckTime <= currentSimulationTime) {
+             runwayCheckTime = NO_EVENT_TIME;
+         }
+         if (runwayPolicy == RunwayPolicy::LOOKAHEAD) {
+             planRunways();
+         } else {
+             // Shards: each ordinary runway's queue onto that runway
+             tickWorkers->run(shardRunways.size(), [&](size_t shard) {
+                 assignShard(shardRunways[shard], runwaySteps[shard]);
+             });
+             
+             // Priority runways and the fallback from them, in the last step
+             mergePriorityRunways(runwaySteps.back());
+         }
+         
+         // Check for runway release (only current occupants can hold a runway)
+         for (size_t runway = 0; runway < runways.size(); runway++) {
+             releaseRunway(runway, runwaySteps[runways[runway].step]);
+         }
+         
+         // Apply in fixed step order so stats and logs do not depend on thread timing.
+         // Assigned flights are stepped this tick, and once anything is
+         // assigned or released the runway stage runs again next second.
+         bool tracing = traceOut || traceIn;
+         runwayEvents.clear();
+         for (RunwayStepResult& step : runwaySteps) {
+             if (!step.assigned.empty() || !step.released.empty()) {
+                 runwayCheckTime = currentSimulationTime + 1;
+             }
+             for (const auto& aircraft : step.assigned) {
+                 dueFlights.push_back(aircraft.get());
+                 recordQueueWait(aircraft);
+                 if (tracing) {
+                     runwayEvents.push_back({static_cast<uint32_t>(currentSimulationTime), aircraft->id,
+                                             TRACE_RUNWAY_ASSIGN, static_cast<uint8_t>(aircraft->assignedRunway), 0, 0});
+                 }
+             }
+             for (const auto& released : step.released) {
+                 analytics.runwayReleased(released.second, currentSimulationTime);
+                 if (tracing) {
+                     runwayEvents.push_back({static_cast<uint32_t>(currentSimulationTime), released.first,
+                                             TRACE_RUNWAY_RELEASE, static_cast<uint8_t>(released.second), 0, 0});
+                 }
+             }
+             for (string& line : step.log) {
+                 logLine(move(line));
+             }
+             step.clear();
+         }
+         if (tracing) {
+             traceRunwayEvents();
+         }
+         
+         // The lookahead policy weighs how long flights have waited and will
+         // wait, so it plans every second while a free runway could take one
+         if (runwayPolicy == RunwayPolicy::LOOKAHEAD && runwayMayTakeFlight()) {
+             runwayCheckTime = currentSimulationTime + 1;
+         }
+     }
+     
+     // A free runway that the head of some queue can use
+     bool runwayMayTakeFlight() const {
+         for (size_t runway = 0; runway < runways.size(); runway++) {
+             if (!isRunwayFree(runway)) {
+                 continue;
+             }
+             for (const RunwayState& owner : runways) {
+                 if (!owner.queue.empty() && canUse(runway, *owner.queue.top())) {
+                     return true;
+                 }
+             }
+         }
+         return false;
+     }
+     
+     // The active flight with this id, or null. The active list is in spawn (id) order.
+     Aircraft* findActiveFlight(int id) const {
+         auto it = lower_bound(activeFlights.begin(), activeFlights.end(), id,
+                               [](const shared_ptr<Aircraft>& flight, int id) { return flight->id < id; });
+         return (it == activeFlights.end() || (*it)->id != id) ? nullptr : it->get();
+     }
+     
+     // Second of the earliest live step calendar entry, dropping superseded ones
+     int nextFlightStep() {
+         while (!stepCalendar.empty()) {
+             const FlightStep& step = stepCalendar.top();
+             Aircraft* flight = findActiveFlight(step.second);
+             if (flight && flight->stepTime == step.first) {
+                 return step.first;
+             }
+             stepCalendar.pop();
+         }
+         return NO_EVENT_TIME;
+     }
+     
+     // Add the flights whose calendar step is now to those spawned, assigned
+     // a runway or handed a traced outcome this tick, in id order
+     void collectDueFlights() {
+         while (nextFlightStep() <= currentSimulationTime) {
+             dueFlights.push_back(findActiveFlight(stepCalendar.top().second));
+             stepCalendar.pop();
+         }
+         sort(dueFlights.begin(), dueFlights.end(), [](const Aircraft* a, const Aircraft* b) { return a->id < b->id; });
+         dueFlights.erase(unique(dueFlights.begin(), dueFlights.end()), dueFlights.end());
+     }
+     
+     // Flight update stage: contiguous chunks of the due flights in parallel.
+     // Each flight only touches its own state and RNG stream.
+     void updateFlights() {
+         collectDueFlights();
+         size_t chunks = (dueFlights.size() + FLIGHT_UPDATE_CHUNK - 1) / FLIGHT_UPDATE_CHUNK;
+         tickWorkers->run(chunks, [this](size_t chunk) {
+             size_t begin = chunk * FLIGHT_UPDATE_CHUNK;
+             size_t end = min(begin + FLIGHT_UPDATE_CHUNK, dueFlights.size());
+             for (size_t i = begin; i < end; i++) {
+                 dueFlights[i]->updateStatus(currentSimulationTime);
+             }
+         });
+     }
+     
+     // AVN emission stage, serial and in id order so AVN ids and the event
+     // stream match whatever thread count stepped the flights
+     void emitViolations() {
+         for (Aircraft* flight : dueFlights) {
+             if (flight->traceMode != TraceMode::OFF) {
+                 drainTrace(*flight);
+             }
+             
+             // Check if flight has active violation
+             if (flight->hasActiveViolation && flight->currentViolation) {
+                 flight->currentViolation->id = context.nextAVNId++;
+                 
+                 if (verbose) {
+                     logLine("\nVIOLATION DETECTED! Flight " + flight->flightNumber.str() + " (" + flight->airline +
+                             ") - Speed: " + to_string(flight->currentSpeed) + " km/h in " +
+                             flight->getStateString() + " state.");
+                 }
+                 
+                 // Add violation to airline's record
+                 airlineById[flight->airlineId]->addViolation(flight->currentViolation);
+                 
+                 // Add to the global list of AVNs
+                 avnIndex.add(flight->currentViolation);
+                 analytics.avnIssued(flight->airlineId, flight->currentViolation->totalAmount);
+                 
+                 // Notify AVN Generator with a new IPC message
+                 IPCMessage message;
+                 message.type = MessageType::AVN_CREATED;
+                 message.avnId = flight->currentViolation->id;
+                 strncpy(message.airline, flight->airline.c_str(), sizeof(message.airline) - 1);
+                 message.airline[sizeof(message.airline) - 1] = '\0';
+                 strncpy(message.flightNumber, flight->flightNumber.c_str(), sizeof(message.flightNumber) - 1);
+                 message.flightNumber[sizeof(message.flightNumber) - 1] = '\0';
+                 message.amount = flight->currentSpeed;  // Send current speed as amount
+                 message.minSpeed = flight->currentViolation->permissibleSpeedMin;
+                 message.maxSpeed = flight->currentViolation->permissibleSpeedMax;
+                 strncpy(message.details, (flight->type == FlightType::COMMERCIAL) ? "COMMERCIAL" : "CARGO", sizeof(message.details) - 1);
+                 message.details[sizeof(message.details) - 1] = '\0';
+                 message.timestampNs = flight->currentViolation->detectedAtNs;
+                 
+                 // Headless runs have no AVN Generator attached
+                 if (avnRing) {
+                     pendingAVNEvents.push_back(message);
+                 }
+                 
+                 // Reset violation flag and clear current violation
+                 flight->hasActiveViolation = false;
+                 flight->currentViolation.reset();
+             }
+         }
+     }
+     
+     // Hand this tick's AVN events to the generator as one batch. Whatever does
+     // not fit stays queued, in order, for the next tick.
+     void flushAVNEvents() {
+         if (!avnRing || pendingAVNEvents.empty()) {
+             return;
+         }
+         while (!pendingAVNEvents.empty() && avnRing->push(pendingAVNEvents.front())) {
+             pendingAVNEvents.pop_front();
+         }
+         avnRing->commit();
+     }
+     
+     // Put this tick's flights back on the step calendar, and note the
+     // releases and completions the next stages have to pick up
+     void scheduleFlightSteps() {
+         for (Aircraft* flight : dueFlights) {
+             flight->stepTime = flight->nextStepTime();
+             if (flight->stepTime != NO_EVENT_TIME) {
+                 stepCalendar.push({flight->stepTime, flight->id});
+             }
+             if (flight->isCompleted()) {
+                 completionsDue = true;
+             }
+             if (flight->assignedRunway != Runway::NONE && flight->hasClearedRunway()) {
+                 runwayCheckTime = currentSimulationTime + 1; // Released by the next runway stage
+             }
+         }
+         dueFlights.clear();
+     }
+     
+     void recordCompletion(const Aircraft& flight) {
+         CompletedFlightRecord record;
+         record.id = flight.id;
+         record.flightNumber = flight.flightNumber;
+         record.airline = flight.airlineId;
+         record.type = flight.type;
+         record.direction = flight.direction;
+         record.emergency = flight.isEmergency;
+         record.queuedAt = flight.queuedAt;
+         record.completedAt = currentSimulationTime;
+         record.violations = __builtin_popcount(flight.violatedStates);
+         completedHistory.push(record);
+         
+         if (completedLog.is_open()) {
+             completedLog << record.id << ',' << record.flightNumber << ',' << AIRLINE_PROFILES[record.airline].name
+                          << ',' << Aircraft::typeString(record.type) << ',' << Aircraft::directionString(record.direction)
+                          << ',' << (record.emergency ? 1 : 0) << ',' << record.queuedAt << ',' << record.completedAt
+                          << ',' << record.violations << '\n';
+         }
+     }
+     
+     void moveCompletedFlights() {
+         if (!completionsDue) {
+             return;
+         }
+         completionsDue = false;
+         
+         // Compact the active list in place, keeping order
+         size_t kept = 0;
+         for (size_t i = 0; i < activeFlights.size(); i++) {
+             shared_ptr<Aircraft>& flight = activeFlights[i];
+             if (flight->isCompleted()) {
+                 completedCount++;
+                 recordCompletion(*flight);
+                 
+                 if (verbose) {
+                     logLine("\nFlight completed: " + flight->flightNumber.str() + " (" + flight->airline + ")");
+                 }
+                 
+                 // Hands the slot back to the pool unless a runway still holds it
+                 flight.reset();
+             } else {
+                 if (kept != i) {
+                     activeFlights[kept] = move(flight);
+                 }
+                 kept++;
+             }
+         }
+         
+         // Update active flights list
+         activeFlights.resize(kept);
+     }
+     
+     // Copy what the status screen shows. Only small fields are taken here;
+     // the formatting is left to whoever prints it.
+     unique_ptr<StatusSnapshot> captureStatus() const {
+         unique_ptr<StatusSnapshot> snapshot(new StatusSnapshot());
+         snapshot->time = currentSimulationTime;
+         snapshot->completedCount = completedCount;
+         snapshot->runways.resize(runways.size());
+         for (size_t r = 0; r < runways.size(); r++) {
+             StatusSnapshot::RunwayView& view = snapshot->runways[r];
+             if (runways[r].occupant) {
+                 view.occupied = true;
+                 view.flightNumber = runways[r].occupant->flightNumber;
+                 view.airline = runways[r].occupant->airlineId;
+             }
+             view.queued = runways[r].queue.size();
+         }
+         for (int arrival = 0; arrival < 2; arrival++) {
+             for (int runway : joinRunways[arrival]) {
+                 snapshot->runways[runway].joinable = true;
+             }
+         }
+         
+         snapshot->flights.reserve(activeFlights.size());
+         for (const auto& flight : activeFlights) {
+             snapshot->flights.push_back({flight->flightNumber, flight->airlineId, flight->type, flight->direction,
+                                          flight->isEmergency, flight->getStateString(), flight->speedAsOf(currentSimulationTime),
+                                          flight->assignedRunway, flight->hasActiveViolation});
+         }
+         
+         snapshot->avnCount = avnIndex.getIssuedCount();
+         snapshot->unpaidAVNs.reserve(avnIndex.getUnpaidCount());
+         avnIndex.forEachUnpaid([&snapshot](const AVN& avn) {
+             snapshot->unpaidAVNs.push_back({avn.id, avn.airline, avn.flightNumber, avn.recordedSpeed, avn.totalAmount});
+         });
+         return snapshot;
+     }
+     
+     void printStatus() {
+         unique_ptr<StatusSnapshot> snapshot = captureStatus();
+         lock_guard<mutex> lock(cout_mutex);
+         snapshot->print(cout);
+     }
+     
+     // Unpaid AVNs in issue order (caller holds the console)
+     void printUnpaidAVNs() const {
+         if (avnIndex.getIssuedCount() == 0) {
+             cout << "No AVNs issued yet." << endl;
+         } else if (avnIndex.getUnpaidCount() == 0) {
+             cout << "All AVNs have been paid." << endl;
+         } else {
+             avnIndex.forEachUnpaid([](const AVN& avn) {
+                 cout << "AVN #" << avn.id << " | " << avn.airline << " flight " << avn.flightNumber 
+                      << " | Speed: " << avn.recordedSpeed << " km/h"
+                      << " | Amount: PKR " << fixed << setprecision(2) << avn.totalAmount << endl;
+             });
+         }
+     }
+     
+     void processAVNPayment(int avnId, double amount) {
+         AVN* avn = avnIndex.find(avnId);
+         if (!avn) {
+             lock_guard<mutex> lock(cout_mutex);
+             cout << "\nAVN #" << avnId << " not found." << endl;
+             return;
+         }
+         
+         if (amount >= avn->totalAmount) {
+             AirlineId airline = AnalyticsEngine::airlineNamed(avn->airline);
+             if (avn->status != PaymentStatus::PAID && airline != AIRLINE_COUNT) {
+                 analytics.avnPaid(airline, avn->totalAmount, amount);
+             }
+             avnIndex.markPaid(avnId);
+             
+             // The generator records the payment in the ledger
+             if (avnRing) {
+                 IPCMessage message;
+                 message.type = MessageType::PAYMENT_CONFIRMATION;
+                 message.avnId = avnId;
+                 message.amount = amount;
+                 pendingAVNEvents.push_back(message);
+                 flushAVNEvents();
+             }
+             
+             lock_guard<mutex> lock(cout_mutex);
+             cout << "\nPayment processed for AVN #" << avnId << " - PKR " << fixed << setprecision(2) << amount << endl;
+             cout << "AVN status updated to PAID." << endl;
+         } else {
+             lock_guard<mutex> lock(cout_mutex);
+             cout << "\nInsufficient payment for AVN #" << avnId << ". Required: PKR " << fixed << setprecision(2) << avn->totalAmount << endl;
+         }
+     }
      
-     // Modify the checkViolation method in DepartureFlight class (around line 853)
-
-void checkViolation() override {
-    // Get current state as a string
-    string currentStateStr = getStateString();
-    
-    // Skip violation check if we already had a violation in this state
-    if (violatedStates.find(currentStateStr) != violatedStates.end()) {
-        return;
-    }
-    
-    bool violation = false;
-    int minSpeed = 0, maxSpeed = 0;
-    
-    switch (state) {
-        case DepartureState::AT_GATE:
-            if (currentSpeed > GATE_MAX_SPEED) {
-                violation = true;
-                minSpeed = 0;
-                maxSpeed = GATE_MAX_SPEED;
-            }
-            break;
-            
-        case DepartureState::TAXI:
-            if (currentSpeed > TAXI_MAX_SPEED) {
-                violation = true;
-                minSpeed = TAXI_MIN_SPEED;
-                maxSpeed = TAXI_MAX_SPEED;
-            }
-            break;
-            
-        case DepartureState::TAKEOFF_ROLL:
-            if (currentSpeed > TAKEOFF_MAX_SPEED) {
-                violation = true;
-                minSpeed = 0;
-                maxSpeed = TAKEOFF_MAX_SPEED;
-            }
-            break;
-            
-        case DepartureState::CLIMB:
-            if (currentSpeed > CLIMB_MAX_SPEED) {
-                violation = true;
-                minSpeed = CLIMB_MIN_SPEED;
-                maxSpeed = CLIMB_MAX_SPEED;
-            }
-            break;
-            
-        case DepartureState::CRUISE:
-            if (currentSpeed < CRUISE_MIN_SPEED || currentSpeed > CRUISE_MAX_SPEED) {
-                violation = true;
-                minSpeed = CRUISE_MIN_SPEED;
-                maxSpeed = CRUISE_MAX_SPEED;
-            }
-            break;
-    }
-    
-    // If there's a violation
-    if (violation) {
-        hasActiveViolation = true;
-        
-        // Create new AVN
-        static int avnIdCounter = 1000;
-        currentViolation = make_shared<AVN>(
-            avnIdCounter++, airline, flightNumber, type,
-            currentSpeed, minSpeed, maxSpeed
-        );
-        
-        // Add this state to the set of states that have had violations
-        violatedStates.insert(currentStateStr);
-        
-        lock_guard<mutex> lock(cout_mutex);
-        cout << "\nVIOLATION DETECTED! Flight " << flightNumber 
-             << " (" << airline << ") - Speed: " << currentSpeed 
-             << " km/h in " << getStateString() << " state.\n";
-    }
-}
+     void displayAVNDetails(int avnId) {
+         AVN* avn = avnIndex.find(avnId);
+         if (avn) {
+             avn->printDetails();
+             return;
+         }
+         
+         // Earlier runs, or evicted from memory
+         const LedgerRecord* record = ledger ? ledger->find(avnId) : nullptr;
+         if (record) {
+             record->toAVN().printDetails();
+             return;
+         }
+         
+         lock_guard<mutex> lock(cout_mutex);
+         cout << "\nAVN #" << avnId << " not found." << endl;
+     }
      
-     bool isCompleted() const override {
-         return state == DepartureState::CRUISE;
+     void displayAirlineViolations(const string& airlineName) {
+         syncLedgerPayments();
+         auto airlineIt = airlines.find(airlineName);
+         if (airlineIt != airlines.end()) {
+             airlineIt->second->printViolations();
+         } else {
+             lock_guard<mutex> lock(cout_mutex);
+             cout << "\nAirline '" << airlineName << "' not found." << endl;
+         }
+     }
+     
+     const AVNIndex& getAVNIndex() const {
+         return avnIndex;
+     }
+     
+     // Running aggregates; read from the thread running the ticks
+     const AnalyticsEngine& getAnalytics() const {
+         return analytics;
+     }
+     
+     const map<string, shared_ptr<Airline>>& getAirlines() const {
+         return airlines;
+     }
+     
+     SimulationMetrics getMetrics() const {
+         SimulationMetrics metrics;
+         metrics.simulatedTime = currentSimulationTime;
+         metrics.flightsGenerated = flightsGenerated;
+         metrics.flightsCompleted = completedCount;
+         metrics.flightsActive = activeFlights.size();
+         for (const RunwayState& runway : runways) {
+             metrics.flightsQueued += runway.queue.size();
+         }
+         metrics.avnsIssued = avnIndex.getIssuedCount();
+         metrics.ticksProcessed = ticksProcessed;
+         for (size_t runway = 0; runway < runways.size(); runway++) {
+             metrics.runwayBusyTime.push_back(analytics.busyTime(static_cast<Runway>(runway), currentSimulationTime));
+         }
+         metrics.totalQueueWait = totalQueueWait;
+         metrics.maxQueueWait = maxQueueWait;
+         metrics.runwayAssignments = runwayAssignments;
+         return metrics;
+     }
+     
+     // Final metrics for batch runs
+     void printSummary() const {
+         SimulationMetrics metrics = getMetrics();
+         lock_guard<mutex> lock(cout_mutex);
+         
+         cout << "\n======== SIMULATION SUMMARY ========" << endl;
+         cout << "Simulated Time: " << metrics.simulatedTime << " seconds" << endl;
+         cout << "Ticks Processed: " << metrics.ticksProcessed << " (seconds with no event skipped)" << endl;
+         cout << "Flights Generated: " << metrics.flightsGenerated << endl;
+         cout << "Flights Completed: " << metrics.flightsCompleted << endl;
+         cout << "Flights Still Active: " << metrics.flightsActive << endl;
+         cout << "AVNs Issued: " << metrics.avnsIssued << endl;
+         cout << "AVNs Held: " << avnIndex.size() << " (" << avnIndex.getEvictedCount() << " evicted)" << endl;
+         
+         cout << "\n--- RECENT COMPLETIONS ---" << endl;
+         size_t skip = completedHistory.size() - min(completedHistory.size(), RECENT_COMPLETIONS_SHOWN);
+         size_t index = 0;
+         completedHistory.forEach([&](const CompletedFlightRecord& record) {
+             if (index++ < skip) {
+                 return;
+             }
+             cout << record.flightNumber << " | " << AIRLINE_PROFILES[record.airline].name << " | "
+                  << Aircraft::typeString(record.type) << " | " << Aircraft::directionString(record.direction)
+                  << " | Completed at " << record.completedAt << "s";
+             if (record.violations > 0) {
+                 cout << " | " << record.violations << " violation(s)";
+             }
+             cout << endl;
+         });
+         if (completedHistory.size() == 0) {
+             cout << "None yet." << endl;
+         }
+         
+         cout << "\n--- RUNWAY UTILISATION ---" << endl;
+         cout << "Topology: " << topology.str() << endl;
+         for (size_t r = 0; r < metrics.runwayBusyTime.size(); r++) {
+             cout << "Runway " << runwayLetter(r) << ": " << fixed << setprecision(1)
+                  << metrics.runwayUtilisation(metrics.runwayBusyTime[r]) << "%" << endl;
+         }
+         
+         cout << "\n--- QUEUE WAIT ---" << endl;
+         cout << "Runway Policy: " << policyName(runwayPolicy) << endl;
+         cout << "Runway Assignments: " << metrics.runwayAssignments << endl;
+         cout << "Average Wait: " << fixed << setprecision(2) << metrics.averageQueueWait() << " seconds" << endl;
+         cout << "Maximum Wait: " << metrics.maxQueueWait << " seconds" << endl;
+         cout << "Still Queued: " << metrics.flightsQueued << endl;
+         analytics.print(cout, currentSimulationTime);
+         cout << "=====================================" << endl;
      }
  };
  
- // Flight Scheduler
- class FlightScheduler {
- private:
-     vector<shared_ptr<Aircraft>> allFlights;
-     vector<shared_ptr<Aircraft>> activeFlights;
-     vector<shared_ptr<Aircraft>> completedFlights;
-     map<string, shared_ptr<Airline>> airlines;
-     vector<shared_ptr<AVN>> allAVNs;
+ const FlightScheduler::FlightStream FlightScheduler::FLIGHT_STREAMS[4] = {
+     // Spawn gaps and emergency odds come from the run's RuleSet, in this order
+     {"North Arrival", Direction::NORTH, true, PAKISTAN_AIRFORCE, 1000},
+     {"South Arrival", Direction::SOUTH, true, AGHAKHAN_AIR_AMBULANCE, 1000},
+     {"East Departure", Direction::EAST, false, PAKISTAN_AIRFORCE, 2000},
+     {"West Departure", Direction::WEST, false, AIRLINE_COUNT, 2000},
+ };
  
-     int currentSimulationTime;
-     int lastNorthArrival;
-     int lastSouthArrival;
-     int lastEastDeparture;
-     int lastWestDeparture;
-     
-     // Mutexes for runway access control
-     mutex runwayAMutex;
-     mutex runwayBMutex;
-     mutex runwayCMutex;
-     
-     // Runway availability flags
-     bool runwayAAvailable;
-     bool runwayBAvailable;
-     bool runwayCAvailable;
-     
-     // Priority queue comparator
-     struct CompareAircraftPriority {
-         bool operator()(const shared_ptr<Aircraft>& a, const shared_ptr<Aircraft>& b) {
-             // First by priority (higher number = higher priority)
-             if (a->priority != b->priority) {
-                 return a->priority < b->priority;
-             }
-             // Then by scheduled time
-             return a->scheduledTime > b->scheduledTime;
+ // AVN Generator Process
+ class AVNGenerator {
+ private:
+     static constexpr int MAX_EVENTS = 32;
+     static constexpr size_t CLIENT_BACKLOG_LIMIT = 4 << 20; // Queued bytes before a stalled client is dropped
+     
+     // A portal connected over the portal socket
+     struct PortalClient {
+         FrameReader requests;
+         FrameWriter frames;       // Replies and notices since the last flush
+         FrameOutbox outbox;
+         vector<string> airlines;  // Subscribed to; empty for every airline
+         
+         explicit PortalClient(int fd) : requests(fd), outbox(fd, EPOLLIN) {}
+         
+         bool wants(const string& airline) const {
+             return airlines.empty() || find(airlines.begin(), airlines.end(), airline) != airlines.end();
          }
      };
      
-     // Priority queues for runways
-     priority_queue<shared_ptr<Aircraft>, vector<shared_ptr<Aircraft>>, CompareAircraftPriority> runwayAQueue;
-     priority_queue<shared_ptr<Aircraft>, vector<shared_ptr<Aircraft>>, CompareAircraftPriority> runwayBQueue;
-     priority_queue<shared_ptr<Aircraft>, vector<shared_ptr<Aircraft>>, CompareAircraftPriority> runwayCQueue;
+     AVNLedger& ledger;  // The AVN store; only this process writes it
+     int nextAVNId;
+     RuleSet rules;      // Fines for new AVNs
+     AVNEventRing& eventRing;
+     int writePipe;                     // Frames to the Airline Portal
+     FrameReader portalRequests;        // Queries from the Airline Portal
+     FrameReader paymentConfirmations;  // Confirmations from StripePay
+     bool portalOpen;
+     bool stripeOpen;
+     FrameWriter outbox;                // Flushed after every wake-up
+     int epollFd;
+     int listenFd;                      // Portal socket, -1 when not serving
+     unordered_map<int, unique_ptr<PortalClient>> clients;
+     FrameWriter paymentRequests;       // Clients' payments, forwarded to StripePay
+     FrameOutbox stripeOutbox;
+     LatencyHistogram avnIngest;        // Violation detected in the ATC to its AVN created here
+     LatencyHistogram paymentConfirm;   // Portal payment request to its confirmation here
+     
+     // Read what a pipe holds and handle every complete frame; false on EOF
+     bool readFrames(FrameReader& reader) {
+         if (!reader.fill()) {
+             return false;
+         }
+         FrameHeader header;
+         FrameCursor cursor(nullptr, 0);
+         while (reader.next(header, cursor)) {
+             processFrame(header, cursor, outbox, nullptr);
+         }
+         return true;
+     }
+     
+     void flushOutbox() {
+         if (!outbox.empty()) {
+             outbox.flush(writePipe);
+         }
+         
+         // Clients and StripePay only take what they can without blocking
+         vector<int> stalled;
+         for (auto& entry : clients) {
+             PortalClient& client = *entry.second;
+             if (!client.frames.empty()) {
+                 client.outbox.queue(client.frames);
+             }
+             if (client.outbox.size() > 0 &&
+                 (!client.outbox.flush(epollFd) || client.outbox.size() > CLIENT_BACKLOG_LIMIT)) {
+                 stalled.push_back(entry.first);
+             }
+         }
+         for (int fd : stalled) {
+             dropClient(fd);
+         }
+         if (!paymentRequests.empty()) {
+             stripeOutbox.queue(paymentRequests);
+         }
+         if (stripeOutbox.size() > 0) {
+             stripeOutbox.flush(epollFd);
+         }
+     }
      
-     // Runway occupancy
-     shared_ptr<Aircraft> runwayAOccupant;
-     shared_ptr<Aircraft> runwayBOccupant;
-     shared_ptr<Aircraft> runwayCOccupant;
+     void acceptClients() {
+         int fd;
+         while ((fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+             int noDelay = 1;
+             setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay)); // Fails harmlessly on Unix sockets
+             epoll_event event = {};
+             event.events = EPOLLIN;
+             event.data.fd = fd;
+             epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+             clients[fd].reset(new PortalClient(fd));
+         }
+     }
      
-     int runwayAFreeTime;
-     int runwayBFreeTime;
-     int runwayCFreeTime;
+     // Handle a client's frames; it is dropped once it hangs up
+     void readClient(int fd) {
+         auto entry = clients.find(fd);
+         if (entry == clients.end()) {
+             return;
+         }
+         PortalClient& client = *entry->second;
+         errno = 0;
+         if (!client.requests.fill()) {
+             if (errno != EAGAIN && errno != EINTR) {
+                 dropClient(fd);
+             }
+             return;
+         }
+         FrameHeader header;
+         FrameCursor cursor(nullptr, 0);
+         while (client.requests.next(header, cursor)) {
+             processFrame(header, cursor, client.frames, &client);
+         }
+     }
      
-     int avnWritePipe; // Pipe to communicate with AVN Generator
+     void dropClient(int fd) {
+         epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+         close(fd);
+         clients.erase(fd);
+     }
      
- public:
-     FlightScheduler(int avnPipe) : currentSimulationTime(0), 
-     lastNorthArrival(0), lastSouthArrival(0),
-     lastEastDeparture(0), lastWestDeparture(0),
-     runwayAFreeTime(0), runwayBFreeTime(0), runwayCFreeTime(0),
-     avnWritePipe(avnPipe),
-     runwayAAvailable(true), runwayBAvailable(true), runwayCAvailable(true) {
-     // Initialize airlines
-     airlines["PIA"] = make_shared<Airline>("PIA", 6, 4);
-     airlines["AirBlue"] = make_shared<Airline>("AirBlue", 4, 4);
-     airlines["FedEx"] = make_shared<Airline>("FedEx", 3, 2);
-     airlines["Pakistan Airforce"] = make_shared<Airline>("Pakistan Airforce", 2, 1);
-     airlines["Blue Dart"] = make_shared<Airline>("Blue Dart", 2, 2);
-     airlines["AghaKhan Air Ambulance"] = make_shared<Airline>("AghaKhan Air Ambulance", 2, 1);
+     // Put a notice for airline on the portal pipe and on every client subscribed to it
+     template <typename Write>
+     void notify(const string& airline, Write write) {
+         write(outbox);
+         for (auto& entry : clients) {
+             if (entry.second->wants(airline)) {
+                 write(entry.second->frames);
+             }
+         }
      }
      
-     void updateSimulation() {
-         currentSimulationTime++;
+     void createAVN(const IPCMessage& message) {
+         // Create a new AVN based on the message
+         FlightType flightType = (strncmp(message.details, "COMMERCIAL", sizeof(message.details)) == 0) ? 
+                                FlightType::COMMERCIAL : FlightType::CARGO;
          
-         // Generate new flights
-         generateFlights();
+         // Create a new AVN with proper speed information
+         auto newAVN = make_shared<AVN>(
+             nextAVNId++,
+             string(message.airline),
+             string(message.flightNumber),
+             flightType,
+             static_cast<int>(message.amount),  // Recorded speed
+             message.minSpeed,  // Permissible min speed
+             message.maxSpeed,  // Permissible max speed
+             rules
+         );
          
-         // Assign runways
-         assignRunways();
+         newAVN->detectedAtNs = message.timestampNs;
+         if (message.timestampNs) {
+             avnIngest.record(monotonicNs() - message.timestampNs);
+         }
          
-         // Update active flights
-         updateFlights();
+         // Store the AVN
+         if (!ledger.append(*newAVN)) {
+             lock_guard<mutex> lock(cout_mutex);
+             cerr << "[AVN Generator] Ledger full; AVN #" << newAVN->id << " not recorded" << endl;
+         }
          
-         // Move completed flights
-         moveCompletedFlights();
+         // Notify the Airline Portal; one frame carries the whole batch
+         notify(newAVN->airline, [&newAVN](FrameWriter& out) {
+             out.beginRecord(MessageType::AVN_CREATED);
+             AVNRecord::write(out, *newAVN);
+             out.endRecord();
+         });
+         
+         lock_guard<mutex> lock(cout_mutex);
+         cout << "[AVN Generator] Created AVN #" << newAVN->id << " for " 
+              << newAVN->airline << " flight " << newAVN->flightNumber 
+              << " - PKR " << fixed << setprecision(2) << newAVN->totalAmount << endl;
      }
      
-     int getCurrentTime() const {
-         return currentSimulationTime;
+     void confirmPayment(int avnId, double amount, uint64_t requestedAtNs) {
+         // Find the AVN and update its status
+         if (!ledger.markPaid(avnId)) {
+             return;
+         }
+         if (requestedAtNs) {
+             paymentConfirm.record(monotonicNs() - requestedAtNs);
+         }
+         
+         notify(ledger.find(avnId)->airline, [=](FrameWriter& out) {
+             out.beginRecord(MessageType::PAYMENT_CONFIRMATION);
+             out.putInt(avnId);
+             out.putDouble(amount);
+             out.putUint64(requestedAtNs);
+             out.endRecord();
+         });
+         
+         lock_guard<mutex> lock(cout_mutex);
+         cout << "[AVN Generator] Payment confirmed for AVN #" << avnId 
+              << " - PKR " << fixed << setprecision(2) << amount << endl;
      }
      
-     void generateFlights() {
-         // North arrivals (every 3 minutes)
-         if (currentSimulationTime - lastNorthArrival >= ARRIVAL_NORTH_INTERVAL || currentSimulationTime == 1) {
-             lastNorthArrival = currentSimulationTime;
-             
-             // Determine if this is an emergency
-             uniform_int_distribution<> emergencyDist(1, 100);
-             bool isEmergency = (emergencyDist(gen) <= NORTH_EMERGENCY_PROBABILITY);
-             
-             // Select airline randomly
-             vector<string> airlineNames;
-             for (const auto& pair : airlines) {
-                 if (pair.second->activeFlights > 0) {
-                     airlineNames.push_back(pair.first);
-                 }
-             }
-             
-             uniform_int_distribution<> airlineDist(0, airlineNames.size() - 1);
-             string airline = airlineNames[airlineDist(gen)];
-             
-             // Determine flight type
-             FlightType type = FlightType::COMMERCIAL;
-             if (airline == "FedEx" || airline == "Blue Dart") {
-                 type = FlightType::CARGO;
-             }
-             if (isEmergency || airline == "Pakistan Airforce") {
-                 type = FlightType::EMERGENCY;
-             }
-             
-             // Create flight number
-             stringstream ssFlightNum;
-             ssFlightNum << airline.substr(0, 2) << "-" << (1000 + allFlights.size());
-             string flightNumber = ssFlightNum.str();
-             
-             // Set priority (emergency = 3, cargo = 2, commercial = 1)
-             int priority = (isEmergency) ? 3 : ((type == FlightType::CARGO) ? 2 : 1);
-             
-             // Create arrival flight
-             auto flight = make_shared<ArrivalFlight>(
-                 flightNumber, airline, type, Direction::NORTH, priority,
-                 chrono::system_clock::now()
-             );
-             flight->isEmergency = isEmergency;
-             
-             allFlights.push_back(flight);
-             activeFlights.push_back(flight);
-             
-             // Add to runway A queue (north arrivals)
-             runwayAQueue.push(flight);
-             
-             lock_guard<mutex> lock(cout_mutex);
-             cout << "\nNew North Arrival: " << flight->getSummary() << endl;
+     void answerAVNQuery(int avnId, uint32_t requestId, FrameWriter& out) {
+         const LedgerRecord* avn = ledger.find(avnId);
+         if (!avn) {
+             out.emptyFrame(MessageType::QUERY_AVN, requestId);
+             return;
+         }
+         out.beginRecord(MessageType::QUERY_AVN, requestId);
+         AVNRecord::write(out, avn->toAVN());
+         out.endRecord();
+         out.endFrame();
+     }
+     
+     void answerAirlineQuery(const string& airline, uint32_t requestId, FrameWriter& out) {
+         // Stream every AVN for the airline, over as many frames as it takes
+         int count = ledger.forEachByAirline(airline, [&out, requestId](const LedgerRecord& avn) {
+             out.beginRecord(MessageType::QUERY_AIRLINE, requestId);
+             AVNRecord::write(out, avn.toAVN());
+             out.endRecord();
+         });
+         if (count == 0) {
+             out.emptyFrame(MessageType::QUERY_AIRLINE, requestId);
+         } else {
+             out.endFrame();
          }
          
-         // South arrivals (every 2 minutes)
-         if (currentSimulationTime - lastSouthArrival >= ARRIVAL_SOUTH_INTERVAL || currentSimulationTime == 2) {
-             lastSouthArrival = currentSimulationTime;
-             
-             // Determine if this is an emergency
-             uniform_int_distribution<> emergencyDist(1, 100);
-             bool isEmergency = (emergencyDist(gen) <= SOUTH_EMERGENCY_PROBABILITY);
-             
-             // Select airline randomly
-             vector<string> airlineNames;
-             for (const auto& pair : airlines) {
-                 if (pair.second->activeFlights > 0) {
-                     airlineNames.push_back(pair.first);
-                 }
-             }
-             
-             uniform_int_distribution<> airlineDist(0, airlineNames.size() - 1);
-             string airline = airlineNames[airlineDist(gen)];
-             
-             // Determine flight type
-             FlightType type = FlightType::COMMERCIAL;
-             if (airline == "FedEx" || airline == "Blue Dart") {
-                 type = FlightType::CARGO;
-             }
-             if (isEmergency || airline == "AghaKhan Air Ambulance") {
-                 type = FlightType::EMERGENCY;
+         lock_guard<mutex> lock(cout_mutex);
+         cout << "[AVN Generator] Queried " << count << " AVNs for " << airline << endl;
+     }
+     
+ public:
+     // Numbering carries on from the last AVN in the ledger. stripeWrite
+     // carries payments that portal clients send here on to StripePay.
+     AVNGenerator(AVNEventRing& ring, AVNLedger& ledger, int write, int portalRead, int stripeRead,
+                  int stripeWrite = -1) 
+         : ledger(ledger), nextAVNId(ledger.nextId()), rules(DEFAULT_RULES), eventRing(ring), writePipe(write),
+           portalRequests(portalRead), paymentConfirmations(stripeRead),
+           portalOpen(portalRead >= 0), stripeOpen(stripeRead >= 0),
+           epollFd(epoll_create1(EPOLL_CLOEXEC)), listenFd(-1), stripeOutbox(stripeWrite) {
+         if (stripeWrite >= 0) {
+             fcntl(stripeWrite, F_SETFL, fcntl(stripeWrite, F_GETFL) | O_NONBLOCK);
+         }
+     }
+     
+     ~AVNGenerator() {
+         for (auto& entry : clients) {
+             close(entry.first);
+         }
+         close(epollFd);
+     }
+     
+     AVNGenerator(const AVNGenerator&) = delete;
+     AVNGenerator& operator=(const AVNGenerator&) = delete;
+     
+     // Fines for AVNs created from now on
+     void setRules(const RuleSet& ruleSet) {
+         rules = ruleSet;
+     }
+     
+     // Accept portal clients on a listening socket (see openPortalListener)
+     void serve(int listener) {
+         listenFd = listener;
+     }
+     
+     void run() {
+         auto watch = [this](int fd) {
+             epoll_event event = {};
+             event.events = EPOLLIN;
+             event.data.fd = fd;
+             epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+         };
+         watch(eventRing.getDoorbell());
+         for (int fd : {portalOpen ? portalRequests.getFd() : -1, stripeOpen ? paymentConfirmations.getFd() : -1, listenFd}) {
+             if (fd >= 0) {
+                 watch(fd);
              }
-             
-             // Create flight number
-             stringstream ssFlightNum;
-             ssFlightNum << airline.substr(0, 2) << "-" << (1000 + allFlights.size());
-             string flightNumber = ssFlightNum.str();
-             
-             // Set priority (emergency = 3, cargo = 2, commercial = 1)
-             int priority = (isEmergency) ? 3 : ((type == FlightType::CARGO) ? 2 : 1);
-                         
-             // Create arrival flight
-             auto flight = make_shared<ArrivalFlight>(
-                 flightNumber, airline, type, Direction::SOUTH, priority,
-                 chrono::system_clock::now()
-             );
-             flight->isEmergency = isEmergency;
-             
-             allFlights.push_back(flight);
-             activeFlights.push_back(flight);
-             
-             // Add to runway A queue (south arrivals)
-             runwayAQueue.push(flight);
-             
-             lock_guard<mutex> lock(cout_mutex);
-             cout << "\nNew South Arrival: " << flight->getSummary() << endl;
          }
          
-         // East departures (every 2.5 minutes)
-         if (currentSimulationTime - lastEastDeparture >= DEPARTURE_EAST_INTERVAL || currentSimulationTime == 3) {
-             lastEastDeparture = currentSimulationTime;
-             
-             // Determine if this is an emergency
-             uniform_int_distribution<> emergencyDist(1, 100);
-             bool isEmergency = (emergencyDist(gen) <= EAST_EMERGENCY_PROBABILITY);
-             
-             // Select airline randomly
-             vector<string> airlineNames;
-             for (const auto& pair : airlines) {
-                 if (pair.second->activeFlights > 0) {
-                     airlineNames.push_back(pair.first);
-                 }
-             }
+         epoll_event events[MAX_EVENTS];
+         while (!eventRing.finished()) {
+             // Process each published ring batch in place
+             eventRing.drain([this](const IPCMessage& message) {
+                 processMessage(message);
+             });
+             flushOutbox();
              
-             uniform_int_distribution<> airlineDist(0, airlineNames.size() - 1);
-             string airline = airlineNames[airlineDist(gen)];
-             
-             // Determine flight type
-             FlightType type = FlightType::COMMERCIAL;
-             if (airline == "FedEx" || airline == "Blue Dart") {
-                 type = FlightType::CARGO;
+             // Sleep on the ring doorbell, the inbound pipes and the clients together
+             if (!eventRing.prepareToSleep()) {
+                 continue;
              }
-             if (isEmergency || airline == "Pakistan Airforce") {
-                 type = FlightType::EMERGENCY;
+             int ready = epoll_wait(epollFd, events, MAX_EVENTS, -1);
+             bool rang = false;
+             for (int i = 0; i < ready; i++) {
+                 rang = rang || events[i].data.fd == eventRing.getDoorbell();
              }
+             eventRing.endSleep(rang);
              
-             // Create flight number
-             stringstream ssFlightNum;
-             ssFlightNum << airline.substr(0, 2) << "-" << (2000 + allFlights.size());
-             string flightNumber = ssFlightNum.str();
-             
-             // Set priority (emergency = 3, cargo = 2, commercial = 1)
-             int priority = (isEmergency) ? 3 : ((type == FlightType::CARGO) ? 2 : 1);
-             
-             // Create departure flight
-             auto flight = make_shared<DepartureFlight>(
-                 flightNumber, airline, type, Direction::EAST, priority,
-                 chrono::system_clock::now()
-             );
-             flight->isEmergency = isEmergency;
-             
-             allFlights.push_back(flight);
-             activeFlights.push_back(flight);
-             
-             // Add to runway B queue (east departures)
-             runwayBQueue.push(flight);
-             
-             lock_guard<mutex> lock(cout_mutex);
-             cout << "\nNew East Departure: " << flight->getSummary() << endl;
-         }
-         
-         // West departures (every 4 minutes)
-         if (currentSimulationTime - lastWestDeparture >= DEPARTURE_WEST_INTERVAL || currentSimulationTime == 4) {
-             lastWestDeparture = currentSimulationTime;
-             
-             // Determine if this is an emergency
-             uniform_int_distribution<> emergencyDist(1, 100);
-             bool isEmergency = (emergencyDist(gen) <= WEST_EMERGENCY_PROBABILITY);
-             
-             // Select airline randomly
-             vector<string> airlineNames;
-             for (const auto& pair : airlines) {
-                 if (pair.second->activeFlights > 0) {
-                     airlineNames.push_back(pair.first);
+             for (int i = 0; i < ready; i++) {
+                 int fd = events[i].data.fd;
+                 if (fd == eventRing.getDoorbell()) {
+                     continue;
+                 } else if (portalOpen && fd == portalRequests.getFd()) {
+                     portalOpen = readFrames(portalRequests);
+                     if (!portalOpen) {
+                         epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+                     }
+                 } else if (stripeOpen && fd == paymentConfirmations.getFd()) {
+                     stripeOpen = readFrames(paymentConfirmations);
+                     if (!stripeOpen) {
+                         epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+                     }
+                 } else if (fd == listenFd) {
+                     acceptClients();
+                 } else if (fd == stripeOutbox.getFd()) {
+                     stripeOutbox.flush(epollFd);
+                 } else if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                     readClient(fd);
                  }
+                 // A client that is writable again is sent its backlog by flushOutbox()
              }
-             
-             uniform_int_distribution<> airlineDist(0, airlineNames.size() - 1);
-             string airline = airlineNames[airlineDist(gen)];
-             
-             // Determine flight type
-             FlightType type = FlightType::COMMERCIAL;
-             if (airline == "FedEx" || airline == "Blue Dart") {
-                 type = FlightType::CARGO;
+             flushOutbox();
+         }
+     }
+ 
+     void printStats() {
+         lock_guard<mutex> lock(cout_mutex);
+         cout << "\n======== AVN GENERATOR LATENCY STATISTICS ========" << endl;
+         avnIngest.print("AVN Detect to Create", 1e3, "us");
+         paymentConfirm.print("Payment to Confirm", 1e6, "ms");
+         cout << "Ledger: " << ledger.size() << " AVNs (" << ledger.countUnpaid() << " unpaid) of "
+              << ledger.capacity() << endl;
+         cout << "==================================================" << endl;
+     }
+     
+     // Messages from the ATC ring
+     void processMessage(const IPCMessage& message) {
+         switch (message.type) {
+             case MessageType::AVN_CREATED:
+                 createAVN(message);
+                 break;
+                 
+             case MessageType::PAYMENT_CONFIRMATION:
+                 confirmPayment(message.avnId, message.amount, message.timestampNs);
+                 break;
+                 
+             case MessageType::QUERY_AVN:
+                 answerAVNQuery(message.avnId, 0, outbox);
+                 break;
+                 
+             case MessageType::QUERY_AIRLINE:
+                 answerAirlineQuery(string(message.airline), 0, outbox);
+                 break;
+                 
+             case MessageType::STATS_DUMP:
+                 printStats();
+                 break;
+                 
+             default:
+                 break;
+         }
+     }
+     
+     // Frames from the Airline Portal, StripePay and portal clients; answers
+     // go to reply. client is the socket client that sent them, if any.
+     void processFrame(const FrameHeader& header, FrameCursor& cursor, FrameWriter& reply, PortalClient* client) {
+         if (static_cast<MessageType>(header.type) == MessageType::STATS_DUMP) {
+             printStats();
+             return;
+         }
+         if (static_cast<MessageType>(header.type) == MessageType::SUBSCRIBE && client) {
+             // Each subscription replaces the last; an empty one means every airline
+             client->airlines.clear();
+         }
+         for (uint32_t i = 0; i < header.count; i++) {
+             switch (static_cast<MessageType>(header.type)) {
+                 case MessageType::PAYMENT_CONFIRMATION: {
+                     int avnId = cursor.getInt();
+                     double amount = cursor.getDouble();
+                     uint64_t requestedAtNs = cursor.getUint64();
+                     if (cursor.ok()) {
+                         confirmPayment(avnId, amount, requestedAtNs);
+                     }
+                     break;
+                 }
+                     
+                 case MessageType::QUERY_AVN: {
+                     int avnId = cursor.getInt();
+                     if (cursor.ok()) {
+                         answerAVNQuery(avnId, header.requestId, reply);
+                     }
+                     break;
+                 }
+                     
+                 case MessageType::QUERY_AIRLINE: {
+                     string airline = cursor.getString();
+                     if (cursor.ok()) {
+                         answerAirlineQuery(airline, header.requestId, reply);
+                     }
+                     break;
+                 }
+                     
+                 case MessageType::PAYMENT_REQUEST: {
+                     // Passed to StripePay, whose confirmation comes back here
+                     int avnId = cursor.getInt();
+                     double amount = cursor.getDouble();
+                     uint64_t requestedAtNs = cursor.getUint64();
+                     if (cursor.ok() && stripeOutbox.getFd() >= 0) {
+                         paymentRequests.beginRecord(MessageType::PAYMENT_REQUEST, header.requestId);
+                         paymentRequests.putInt(avnId);
+                         paymentRequests.putDouble(amount);
+                         paymentRequests.putUint64(requestedAtNs);
+                         paymentRequests.endRecord();
+                     }
+                     break;
+                 }
+                     
+                 case MessageType::SUBSCRIBE: {
+                     string airline = cursor.getString();
+                     if (cursor.ok() && client) {
+                         client->airlines.push_back(airline);
+                     }
+                     break;
+                 }
+                     
+                 default:
+                     return;
              }
-             if (isEmergency) {
-                 type = FlightType::EMERGENCY;
+             if (!cursor.ok()) {
+                 return;
              }
-             
-             // Create flight number
-             stringstream ssFlightNum;
-             ssFlightNum << airline.substr(0, 2) << "-" << (2000 + allFlights.size());
-             string flightNumber = ssFlightNum.str();
-             
-             // Set priority (emergency = 3, cargo = 2, commercial = 1)
-             int priority = (isEmergency) ? 3 : ((type == FlightType::CARGO) ? 2 : 1);
-             
-             // Create departure flight
-             auto flight = make_shared<DepartureFlight>(
-                 flightNumber, airline, type, Direction::WEST, priority,
-                 chrono::system_clock::now()
-             );
-             flight->isEmergency = isEmergency;
-             
-             allFlights.push_back(flight);
-             activeFlights.push_back(flight);
-             
-             // Add to runway B queue (west departures)
-             runwayBQueue.push(flight);
-             
-             lock_guard<mutex> lock(cout_mutex);
-             cout << "\nNew West Departure: " << flight->getSummary() << endl;
          }
      }
+ };
+ 
+ // Airline Portal Process. One reactor serves every session: epoll waits on
+ // the sessions' input, replies from the AVN Generator, an eventfd used to
+ // stop it, and the outgoing pipes while they are backed up. Every query
+ // carries a request id; its reply is handed to the session that asked, and
+ // anything else the generator sends is shown to every session.
+ class AirlinePortal {
+ private:
+     static constexpr int RESPONSE_TIMEOUT_MS = 1000;
+     static constexpr int MAX_EVENTS = 16;
+     static constexpr size_t INPUT_CHUNK = 4096;
      
-     void assignRunways() {
-         // Temporary queues to hold unassigned flights
-         priority_queue<shared_ptr<Aircraft>, vector<shared_ptr<Aircraft>>, CompareAircraftPriority> tempAQueue;
-         priority_queue<shared_ptr<Aircraft>, vector<shared_ptr<Aircraft>>, CompareAircraftPriority> tempBQueue;
-         priority_queue<shared_ptr<Aircraft>, vector<shared_ptr<Aircraft>>, CompareAircraftPriority> tempCQueue;
-     
-         // Process runway A queue (North/South arrivals)
-         while (!runwayAQueue.empty()) {
-             shared_ptr<Aircraft> aircraft = runwayAQueue.top();
-             runwayAQueue.pop();
-     
-             // Skip if already assigned a runway
-             if (aircraft->assignedRunway != Runway::NONE) {
-                 tempAQueue.push(aircraft);
-                 continue;
-             }
+     // Where a session is in the menu
+     enum class SessionState { MENU, AIRLINE_NAME, PAY_ID, PAY_AMOUNT, DETAILS_ID, WAITING };
      
-             bool assigned = false;
+     // One user of the portal: line-oriented input and an output to answer on
+     struct Session {
+         int inputFd;
+         int outputFd;
+         bool pollable;      // False for regular files, which epoll cannot watch
+         SessionState state;
+         string input;       // Read but not yet handled
+         string output;      // Written out after each reactor pass
+         int avnId;          // AVN being paid
+         bool inputEnded;
+         bool exiting;
+     };
      
-             // Try RWY-C for emergency or cargo flights
-             if (aircraft->type == FlightType::EMERGENCY || aircraft->type == FlightType::CARGO) {
-                 lock_guard<mutex> lock(runwayCMutex);
-                 if (runwayCAvailable && currentSimulationTime >= runwayCFreeTime) {
-                     runwayCAvailable = false;
-                     runwayCOccupant = aircraft;
-                     aircraft->assignedRunway = Runway::RWY_C;
-                     assigned = true;
-                     lock_guard<mutex> coutLock(cout_mutex);
-                     cout << "Assigned RWY-C to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
-                 }
-             }
+     // What a request id was sent for
+     enum class RequestKind { AIRLINE_AVNS, AVN_DETAILS, PAY_LOOKUP };
      
-             // Try RWY-A for North/South arrivals
-             if (!assigned && (aircraft->direction == Direction::NORTH || aircraft->direction == Direction::SOUTH)) {
-                 lock_guard<mutex> lock(runwayAMutex);
-                 if (runwayAAvailable && currentSimulationTime >= runwayAFreeTime) {
-                     runwayAAvailable = false;
-                     runwayAOccupant = aircraft;
-                     aircraft->assignedRunway = Runway::RWY_A;
-                     assigned = true;
-                     lock_guard<mutex> coutLock(cout_mutex);
-                     cout << "Assigned RWY-A to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
-                 }
-             }
+     struct PendingRequest {
+         Session* session;
+         RequestKind kind;
+         size_t records;
+         chrono::steady_clock::time_point deadline;
+     };
      
-             // Try RWY-C as fallback for non-cargo flights
-             if (!assigned && aircraft->type != FlightType::CARGO) {
-                 lock_guard<mutex> lock(runwayCMutex);
-                 if (runwayCAvailable && currentSimulationTime >= runwayCFreeTime) {
-                     runwayCAvailable = false;
-                     runwayCOccupant = aircraft;
-                     aircraft->assignedRunway = Runway::RWY_C;
-                     assigned = true;
-                     lock_guard<mutex> coutLock(cout_mutex);
-                     cout << "Assigned RWY-C (fallback) to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
-                 }
-             }
+     FrameReader responses;   // Frames from the AVN Generator
+     bool responsesOpen;
+     FrameOutbox generatorOut;
+     FrameOutbox stripePayOut;
+     FrameOutbox* paymentsOut; // StripePay, or the generator when it forwards payments
+     int epollFd;
+     int wakeFd;              // eventfd; stop() writes it
+     bool running;
+     uint32_t nextRequestId;
+     const AVNLedger* ledger; // When mapped, AVN lookups read it instead of querying the generator
+     vector<unique_ptr<Session>> sessions;
+     unordered_map<uint32_t, PendingRequest> pendingRequests;
+     LatencyHistogram avnDelivery;      // Violation detected in the ATC to AVN_CREATED arriving here
+     LatencyHistogram paymentRoundTrip; // Payment request sent to its confirmation arriving here
      
-             // If not assigned, re-queue
-             if (!assigned) {
-                 tempAQueue.push(aircraft);
-             }
-         }
+     void watch(int fd, uint32_t events, int op) {
+         epoll_event event = {};
+         event.events = events;
+         event.data.fd = fd;
+         epoll_ctl(epollFd, op, fd, &event);
+     }
+     
+     // Queue frames on a pipe and send what it will take now
+     void send(FrameOutbox& box, FrameWriter& frames) {
+         box.queue(frames);
+         box.flush(epollFd);
+     }
      
-         // Process runway B queue (East/West departures)
-         while (!runwayBQueue.empty()) {
-             shared_ptr<Aircraft> aircraft = runwayBQueue.top();
-             runwayBQueue.pop();
+     // Send a query to the generator; the session waits until the reply
+     // with this request id has arrived or the timeout passes
+     void sendRequest(Session& session, RequestKind kind, uint32_t requestId, FrameWriter& request) {
+         pendingRequests[requestId] = {&session, kind, 0,
+                                       chrono::steady_clock::now() + chrono::milliseconds(RESPONSE_TIMEOUT_MS)};
+         session.state = SessionState::WAITING;
+         send(generatorOut, request);
+     }
      
-             // Skip if already assigned a runway
-             if (aircraft->assignedRunway != Runway::NONE) {
-                 tempBQueue.push(aircraft);
-                 continue;
-             }
+     void queryAVN(Session& session, RequestKind kind, int avnId) {
+         uint32_t requestId = nextRequestId++;
+         FrameWriter request;
+         request.beginRecord(MessageType::QUERY_AVN, requestId);
+         request.putInt(avnId);
+         request.endRecord();
+         sendRequest(session, kind, requestId, request);
+     }
+     
+     static void printAVNRecord(ostream& out, const AVNRecord& avn) {
+         out << "\n===== AVN #" << avn.id << " =====\n";
+         out << "Airline: " << avn.airline << "\n";
+         out << "Flight: " << avn.flightNumber << "\n";
+         out << "Amount: PKR " << fixed << setprecision(2) << avn.totalAmount << "\n";
+         out << "Status: " << ((avn.status == PaymentStatus::PAID) ? "PAID" : "UNPAID") << "\n";
+         out << "========================\n";
+     }
      
-             bool assigned = false;
+     static void printAirlineRecord(ostream& out, const AVNRecord& avn) {
+         out << "AVN #" << avn.id << " | " << avn.flightNumber 
+             << " | PKR " << fixed << setprecision(2) << avn.totalAmount 
+             << " | " << ((avn.status == PaymentStatus::PAID) ? "PAID" : "UNPAID") << "\n";
+     }
      
-             // Try RWY-C for emergency or cargo flights
-             if (aircraft->type == FlightType::EMERGENCY || aircraft->type == FlightType::CARGO) {
-                 lock_guard<mutex> lock(runwayCMutex);
-                 if (runwayCAvailable && currentSimulationTime >= runwayCFreeTime) {
-                     runwayCAvailable = false;
-                     runwayCOccupant = aircraft;
-                     aircraft->assignedRunway = Runway::RWY_C;
-                     assigned = true;
-                     lock_guard<mutex> coutLock(cout_mutex);
-                     cout << "Assigned RWY-C to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
+     // Print every record of a frame; returns the number of records
+     size_t printFrame(ostream& out, const FrameHeader& header, FrameCursor& cursor) {
+         size_t records = 0;
+         for (; records < header.count && cursor.ok(); records++) {
+             switch (static_cast<MessageType>(header.type)) {
+                 case MessageType::AVN_CREATED: {
+                     AVNRecord avn = AVNRecord::read(cursor);
+                     if (avn.detectedAtNs) {
+                         avnDelivery.record(monotonicNs() - avn.detectedAtNs);
+                     }
+                     out << "\n[Airline Portal] New AVN #" << avn.id << " created for " 
+                         << avn.airline << " flight " << avn.flightNumber 
+                         << " - PKR " << fixed << setprecision(2) << avn.totalAmount << "\n";
+                     break;
+                 }
+                     
+                 case MessageType::PAYMENT_CONFIRMATION: {
+                     int avnId = cursor.getInt();
+                     double amount = cursor.getDouble();
+                     uint64_t requestedAtNs = cursor.getUint64();
+                     if (requestedAtNs) {
+                         paymentRoundTrip.record(monotonicNs() - requestedAtNs);
+                     }
+                     out << "\n[Airline Portal] Payment confirmed for AVN #" << avnId 
+                         << " - PKR " << fixed << setprecision(2) << amount << "\n";
+                     break;
                  }
+                     
+                 case MessageType::QUERY_AVN:
+                     printAVNRecord(out, AVNRecord::read(cursor));
+                     break;
+                     
+                 case MessageType::QUERY_AIRLINE:
+                     printAirlineRecord(out, AVNRecord::read(cursor));
+                     break;
+                     
+                 default:
+                     return records;
              }
+         }
+         return records;
+     }
      
-             // Try RWY-B for East/West departures
-             if (!assigned && (aircraft->direction == Direction::EAST || aircraft->direction == Direction::WEST)) {
-                 lock_guard<mutex> lock(runwayBMutex);
-                 if (runwayBAvailable && currentSimulationTime >= runwayBFreeTime) {
-                     runwayBAvailable = false;
-                     runwayBOccupant = aircraft;
-                     aircraft->assignedRunway = Runway::RWY_B;
-                     assigned = true;
-                     lock_guard<mutex> coutLock(cout_mutex);
-                     cout << "Assigned RWY-B to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
+     // Route the generator's frames: replies to the session that asked,
+     // notifications to everyone
+     void readResponses() {
+         errno = 0;
+         if (!responses.fill()) {
+             if (errno == EAGAIN || errno == EINTR) {
+                 return;
+             }
+             epoll_ctl(epollFd, EPOLL_CTL_DEL, responses.getFd(), nullptr);
+             responsesOpen = false;
+             // Nothing more will arrive for the requests in flight
+             while (!pendingRequests.empty()) {
+                 completeRequest(pendingRequests.begin());
+             }
+             return;
+         }
+         
+         FrameHeader header;
+         FrameCursor cursor(nullptr, 0);
+         while (responses.next(header, cursor)) {
+             auto request = header.requestId ? pendingRequests.find(header.requestId) : pendingRequests.end();
+             if (request != pendingRequests.end()) {
+                 stringstream out;
+                 request->second.records += printFrame(out, header, cursor);
+                 request->second.session->output += out.str();
+                 if (!(header.flags & FRAME_MORE)) {
+                     completeRequest(request);
+                 }
+             } else if (header.requestId == 0) {
+                 stringstream out;
+                 printFrame(out, header, cursor);
+                 for (auto& session : sessions) {
+                     session->output += out.str();
                  }
              }
+             // A reply to a request that already timed out is dropped
+         }
+     }
      
-             // Try RWY-C as fallback for non-cargo flights
-             if (!assigned && aircraft->type != FlightType::CARGO) {
-                 lock_guard<mutex> lock(runwayCMutex);
-                 if (runwayCAvailable && currentSimulationTime >= runwayCFreeTime) {
-                     runwayCAvailable = false;
-                     runwayCOccupant = aircraft;
-                     aircraft->assignedRunway = Runway::RWY_C;
-                     assigned = true;
-                     lock_guard<mutex> coutLock(cout_mutex);
-                     cout << "Assigned RWY-C (fallback) to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
+     // The last frame for a request arrived (or it timed out): finish the
+     // step that sent it and move the session on
+     void completeRequest(unordered_map<uint32_t, PendingRequest>::iterator request) {
+         PendingRequest done = request->second;
+         pendingRequests.erase(request);
+         Session& session = *done.session;
+         
+         switch (done.kind) {
+             case RequestKind::AIRLINE_AVNS:
+                 finishAirlineAVNs(session, done.records);
+                 break;
+                 
+             case RequestKind::AVN_DETAILS:
+                 if (done.records == 0) {
+                     session.output += "AVN #" + to_string(session.avnId) + " not found.\n";
                  }
-             }
+                 showMenu(session);
+                 break;
+                 
+             case RequestKind::PAY_LOOKUP:
+                 askPaymentAmount(session, done.records > 0);
+                 break;
+         }
+         handleInput(session);
+     }
      
-             // If not assigned, re-queue
-             if (!assigned) {
-                 tempBQueue.push(aircraft);
+     // Complete requests whose reply did not arrive in time with what did
+     void expireRequests() {
+         auto now = chrono::steady_clock::now();
+         vector<uint32_t> expired;
+         for (const auto& entry : pendingRequests) {
+             if (entry.second.deadline <= now) {
+                 expired.push_back(entry.first);
              }
          }
-     
-         // Process runway C queue (emergency/cargo overflow)
-         while (!runwayCQueue.empty()) {
-             shared_ptr<Aircraft> aircraft = runwayCQueue.top();
-             runwayCQueue.pop();
-     
-             // Skip if already assigned a runway
-             if (aircraft->assignedRunway != Runway::NONE) {
-                 tempCQueue.push(aircraft);
-                 continue;
+         for (uint32_t requestId : expired) {
+             auto request = pendingRequests.find(requestId);
+             if (request != pendingRequests.end()) {
+                 completeRequest(request);
              }
+         }
+     }
      
-             bool assigned = false;
+     // Milliseconds until the next request deadline, -1 for none
+     int nextTimeoutMs() const {
+         int timeout = -1;
+         auto now = chrono::steady_clock::now();
+         for (const auto& entry : pendingRequests) {
+             int remaining = max<long>(0, chrono::duration_cast<chrono::milliseconds>(
+                 entry.second.deadline - now).count() + 1);
+             timeout = (timeout < 0) ? remaining : min(timeout, remaining);
+         }
+         return timeout;
+     }
      
-             // Try RWY-C for all flights in this queue
-             lock_guard<mutex> lock(runwayCMutex);
-             if (runwayCAvailable && currentSimulationTime >= runwayCFreeTime) {
-                 runwayCAvailable = false;
-                 runwayCOccupant = aircraft;
-                 aircraft->assignedRunway = Runway::RWY_C;
-                 assigned = true;
-                 lock_guard<mutex> coutLock(cout_mutex);
-                 cout << "Assigned RWY-C to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
-             }
+     void showMenu(Session& session) {
+         session.state = SessionState::MENU;
+         session.output += "\n===== AIRLINE PORTAL =====\n"
+                           "1. View Airline AVNs\n"
+                           "2. Pay AVN\n"
+                           "3. View AVN Details\n"
+                           "4. Latency Statistics\n"
+                           "5. Exit\n"
+                           "Enter your choice: ";
+     }
      
-             // If not assigned, re-queue
-             if (!assigned) {
-                 tempCQueue.push(aircraft);
+     // One read of a session's input; input that is not a pipe or terminal
+     // is read until it ends
+     void readInput(Session& session) {
+         char chunk[INPUT_CHUNK];
+         ssize_t bytesRead = read(session.inputFd, chunk, sizeof(chunk));
+         if (bytesRead < 0 && errno == EINTR) {
+             return;
+         }
+         if (bytesRead <= 0) {
+             session.inputEnded = true;
+             if (session.pollable) {
+                 epoll_ctl(epollFd, EPOLL_CTL_DEL, session.inputFd, nullptr);
              }
+         } else {
+             session.input.append(chunk, bytesRead);
          }
+         handleInput(session);
+     }
      
-         // Restore unassigned flights to queues
-         runwayAQueue = tempAQueue;
-         runwayBQueue = tempBQueue;
-         runwayCQueue = tempCQueue;
+     // Act on complete lines until the session has to wait for a reply
+     void handleInput(Session& session) {
+         while (session.state != SessionState::WAITING && !session.exiting) {
+             size_t newline = session.input.find('\n');
+             if (newline == string::npos && !(session.inputEnded && !session.input.empty())) {
+                 return;
+             }
+             string line = session.input.substr(0, newline);
+             session.input.erase(0, newline == string::npos ? string::npos : newline + 1);
+             size_t first = line.find_first_not_of(" \t\r");
+             size_t last = line.find_last_not_of(" \t\r");
+             handleLine(session, first == string::npos ? string() : line.substr(first, last - first + 1));
+         }
+     }
      
-         // Check for runway release
-         for (auto& flight : activeFlights) {
-             if (flight->assignedRunway != Runway::NONE) {
-                 bool releaseRunway = false;
+     static bool parseInt(const string& text, int& value) {
+         return !text.empty() && from_chars(text.data(), text.data() + text.size(), value).ptr == text.data() + text.size();
+     }
      
-                 // Check arrival flights
-                 if (auto arrival = dynamic_pointer_cast<ArrivalFlight>(flight)) {
-                     if (arrival->getState() == ArrivalState::TAXI || 
-                         arrival->getState() == ArrivalState::AT_GATE) {
-                         releaseRunway = true;
-                     }
+     void handleLine(Session& session, const string& line) {
+         switch (session.state) {
+             case SessionState::MENU: {
+                 if (line.empty()) {
+                     return;
                  }
-     
-                 // Check departure flights
-                 if (auto departure = dynamic_pointer_cast<DepartureFlight>(flight)) {
-                     if (departure->getState() == DepartureState::CLIMB || 
-                         departure->getState() == DepartureState::CRUISE) {
-                         releaseRunway = true;
-                     }
+                 int choice = 0;
+                 parseInt(line, choice);
+                 switch (choice) {
+                     case 1:
+                         session.output += "Enter airline name: ";
+                         session.state = SessionState::AIRLINE_NAME;
+                         break;
+                         
+                     case 2:
+                         session.output += "Enter AVN ID to pay: ";
+                         session.state = SessionState::PAY_ID;
+                         break;
+                         
+                     case 3:
+                         session.output += "Enter AVN ID: ";
+                         session.state = SessionState::DETAILS_ID;
+                         break;
+                         
+                     case 4:
+                         showStats(session);
+                         showMenu(session);
+                         break;
+                         
+                     case 5:
+                         session.output += "Exiting Airline Portal.\n";
+                         session.exiting = true;
+                         break;
+                         
+                     default:
+                         session.output += "Invalid choice. Please try again.\n";
+                         showMenu(session);
+                         break;
                  }
-     
-                 if (releaseRunway) {
-                     Runway runway = flight->assignedRunway;
-                     flight->assignedRunway = Runway::NONE;
-     
-                     if (runway == Runway::RWY_A) {
-                         lock_guard<mutex> lock(runwayAMutex);
-                         runwayAAvailable = true;
-                         runwayAOccupant = nullptr;
-                         runwayAFreeTime = currentSimulationTime;
-                         lock_guard<mutex> coutLock(cout_mutex);
-                         cout << "Released RWY-A from " << flight->flightNumber << " (" << flight->airline << ")" << endl;
-                     } else if (runway == Runway::RWY_B) {
-                         lock_guard<mutex> lock(runwayBMutex);
-                         runwayBAvailable = true;
-                         runwayBOccupant = nullptr;
-                         runwayBFreeTime = currentSimulationTime;
-                         lock_guard<mutex> coutLock(cout_mutex);
-                         cout << "Released RWY-B from " << flight->flightNumber << " (" << flight->airline << ")" << endl;
-                     } else if (runway == Runway::RWY_C) {
-                         lock_guard<mutex> lock(runwayCMutex);
-                         runwayCAvailable = true;
-                         runwayCOccupant = nullptr;
-                         runwayCFreeTime = currentSimulationTime;
-                         lock_guard<mutex> coutLock(cout_mutex);
-                         cout << "Released RWY-C from " << flight->flightNumber << " (" << flight->airline << ")" << endl;
+                 break;
+             }
+                 
+             case SessionState::AIRLINE_NAME:
+                 viewAirlineAVNs(session, line);
+                 break;
+                 
+             case SessionState::PAY_ID:
+             case SessionState::DETAILS_ID: {
+                 bool paying = session.state == SessionState::PAY_ID;
+                 if (!parseInt(line, session.avnId)) {
+                     session.output += "Invalid AVN ID.\n";
+                     showMenu(session);
+                 } else if (!ledger) {
+                     queryAVN(session, paying ? RequestKind::PAY_LOOKUP : RequestKind::AVN_DETAILS, session.avnId);
+                 } else {
+                     const LedgerRecord* record = ledger->find(session.avnId);
+                     if (record) {
+                         stringstream out;
+                         printAVNRecord(out, record->toRecord());
+                         session.output += out.str();
+                     }
+                     if (paying) {
+                         askPaymentAmount(session, record != nullptr);
+                     } else {
+                         if (!record) {
+                             session.output += "AVN #" + to_string(session.avnId) + " not found.\n";
+                         }
+                         showMenu(session);
                      }
                  }
+                 break;
              }
+                 
+             case SessionState::PAY_AMOUNT:
+                 payAVN(session, line);
+                 break;
+                 
+             case SessionState::WAITING:
+                 break;
          }
      }
      
-     void updateFlights() {
-         for (auto& flight : activeFlights) {
-             flight->updateStatus(currentSimulationTime);
-             
-             // Check if flight has active violation
-             if (flight->hasActiveViolation && flight->currentViolation) {
-                 // Add violation to airline's record
-                 auto airlineIt = airlines.find(flight->airline);
-                 if (airlineIt != airlines.end()) {
-                     airlineIt->second->addViolation(flight->currentViolation);
-                     
-                     // Add to the global list of AVNs
-                     allAVNs.push_back(flight->currentViolation);
-                     
-                     // Notify AVN Generator with a new IPC message
-                     IPCMessage message;
-                     message.type = MessageType::AVN_CREATED;
-                     message.avnId = flight->currentViolation->id;
-                     strncpy(message.airline, flight->airline.c_str(), sizeof(message.airline) - 1);
-                     message.airline[sizeof(message.airline) - 1] = '\0';
-                     strncpy(message.flightNumber, flight->flightNumber.c_str(), sizeof(message.flightNumber) - 1);
-                     message.flightNumber[sizeof(message.flightNumber) - 1] = '\0';
-                     message.amount = flight->currentSpeed;  // Send current speed as amount
-                     message.minSpeed = flight->currentViolation->permissibleSpeedMin;
-                     message.maxSpeed = flight->currentViolation->permissibleSpeedMax;
-                     strncpy(message.details, (flight->type == FlightType::COMMERCIAL) ? "COMMERCIAL" : "CARGO", sizeof(message.details) - 1);
-                     message.details[sizeof(message.details) - 1] = '\0';
-                     
-                     write(avnWritePipe, &message, sizeof(message));
-                     
-                     // Reset violation flag and clear current violation
-                     flight->hasActiveViolation = false;
-                     flight->currentViolation.reset();
-                 }
-             }
+     void viewAirlineAVNs(Session& session, const string& airline) {
+         session.output += "\n===== AVNs for " + airline + " =====\n";
+         if (ledger) {
+             stringstream out;
+             size_t records = ledger->forEachByAirline(airline, [&out](const LedgerRecord& avn) {
+                 printAirlineRecord(out, avn.toRecord());
+             });
+             session.output += out.str();
+             finishAirlineAVNs(session, records);
+             return;
          }
+         
+         // Request AVNs for the airline; the answer may span several frames
+         uint32_t requestId = nextRequestId++;
+         FrameWriter request;
+         request.beginRecord(MessageType::QUERY_AIRLINE, requestId);
+         request.putString(airline);
+         request.endRecord();
+         sendRequest(session, RequestKind::AIRLINE_AVNS, requestId, request);
      }
      
-     void moveCompletedFlights() {
-         vector<shared_ptr<Aircraft>> stillActive;
-         
-         for (auto& flight : activeFlights) {
-             if (flight->isCompleted()) {
-                 completedFlights.push_back(flight);
-                 
-                 lock_guard<mutex> lock(cout_mutex);
-                 cout << "\nFlight completed: " << flight->flightNumber 
-                      << " (" << flight->airline << ")" << endl;
-             } else {
-                 stillActive.push_back(flight);
-             }
+     void finishAirlineAVNs(Session& session, size_t records) {
+         if (records == 0) {
+             session.output += "No AVNs found for this airline.\n";
          }
-         
-         // Update active flights list
-         activeFlights = stillActive;
+         session.output += "========================\n";
+         showMenu(session);
      }
      
-     void printStatus() {
-         lock_guard<mutex> lock(cout_mutex);
-         
-         cout << "\n======== AIRCONTROLX STATUS ========" << endl;
-         cout << "Simulation Time: " << currentSimulationTime << " seconds" << endl;
-         cout << "Active Flights: " << activeFlights.size() << endl;
-         cout << "Completed Flights: " << completedFlights.size() << endl;
+     void askPaymentAmount(Session& session, bool found) {
+         if (!found) {
+             session.output += "AVN #" + to_string(session.avnId) + " not found.\n";
+             showMenu(session);
+             return;
+         }
+         session.output += "Enter payment amount (PKR): ";
+         session.state = SessionState::PAY_AMOUNT;
+     }
+     
+     void payAVN(Session& session, const string& line) {
+         char* end = nullptr;
+         double amount = strtod(line.c_str(), &end);
+         if (line.empty() || *end != '\0') {
+             session.output += "Invalid amount.\n";
+             showMenu(session);
+             return;
+         }
          
-         // Runway status
-         cout << "\n--- RUNWAY STATUS ---" << endl;
-         cout << "Runway A: " << (runwayAOccupant ? runwayAOccupant->flightNumber + " (" + runwayAOccupant->airline + ")" : "Free") << endl;
-         cout << "Runway B: " << (runwayBOccupant ? runwayBOccupant->flightNumber + " (" + runwayBOccupant->airline + ")" : "Free") << endl;
-         cout << "Runway C: " << (runwayCOccupant ? runwayCOccupant->flightNumber + " (" + runwayCOccupant->airline + ")" : "Free") << endl;
+         // Send payment request to StripePay (directly or through the
+         // generator); the confirmation comes back as a notification
+         FrameWriter paymentRequest;
+         paymentRequest.beginRecord(MessageType::PAYMENT_REQUEST, nextRequestId++);
+         paymentRequest.putInt(session.avnId);
+         paymentRequest.putDouble(amount);
+         paymentRequest.putUint64(monotonicNs());
+         paymentRequest.endRecord();
+         send(*paymentsOut, paymentRequest);
          
-         // Queue status
-         cout << "\n--- QUEUE STATUS ---" << endl;
-         cout << "Runway A Queue: " << runwayAQueue.size() << " flights waiting" << endl;
-         cout << "Runway B Queue: " << runwayBQueue.size() << " flights waiting" << endl;
+         stringstream out;
+         out << "Payment request sent for AVN #" << session.avnId << " - PKR " << fixed << setprecision(2) << amount << "\n";
+         session.output += out.str();
+         showMenu(session);
+     }
+     
+     // Print this portal's statistics and have the generator and StripePay print theirs
+     void showStats(Session& session) {
+         stringstream out;
+         out << "\n======== AIRLINE PORTAL LATENCY STATISTICS ========" << endl;
+         avnDelivery.print("AVN End-to-End", 1e3, "us", out);
+         paymentRoundTrip.print("Payment Round Trip", 1e6, "ms", out);
+         out << "===================================================" << endl;
+         session.output += out.str();
          
-         // Active flights
-         cout << "\n--- ACTIVE FLIGHTS ---" << endl;
-         for (const auto& flight : activeFlights) {
-             cout << flight->getSummary() << endl;
-         }
-         
-         // Active violations
-        //  cout << "\n--- ACTIVE VIOLATIONS ---" << endl;
-        //  bool hasViolations = false;
-        //  for (const auto& flight : activeFlights) {
-        //      if (flight->hasActiveViolation) {
-        //          cout << "Flight " << flight->flightNumber << " (" << flight->airline << ") - Speed: " 
-        //               << flight->currentSpeed << " km/h" << endl;
-        //          hasViolations = true;
-        //      }
-        //  }
-         
-        //  if (!hasViolations) {
-        //      cout << "No active violations." << endl;
-        //  }
-        
-        cout << "\n--- ACTIVE AVNs ---" << endl;
-        if (allAVNs.empty()) {
-            cout << "No AVNs issued yet." << endl;
-        } else {
-            bool hasUnpaidAVNs = false;
-            for (const auto& avn : allAVNs) {
-                if (avn->status == PaymentStatus::UNPAID) {
-                    cout << "AVN #" << avn->id << " | " << avn->airline << " flight " << avn->flightNumber 
-                        << " | Speed: " << avn->recordedSpeed << " km/h"
-                        << " | Amount: PKR " << fixed << setprecision(2) << avn->totalAmount << endl;
-                    hasUnpaidAVNs = true;
-                }
-            }
-            
-            if (!hasUnpaidAVNs) {
-                cout << "All AVNs have been paid." << endl;
-            }
-        }
-         cout << "=====================================" << endl;
+         FrameWriter request;
+         request.emptyFrame(MessageType::STATS_DUMP, 0);
+         send(generatorOut, request);
+         if (paymentsOut == &stripePayOut) {
+             request.emptyFrame(MessageType::STATS_DUMP, 0);
+             send(stripePayOut, request);
+         }
      }
      
-     void processAVNPayment(int avnId, double amount) {
-         for (auto& avn : allAVNs) {
-             if (avn->id == avnId) {
-                 if (amount >= avn->totalAmount) {
-                     avn->status = PaymentStatus::PAID;
-                     
-                     lock_guard<mutex> lock(cout_mutex);
-                     cout << "\nPayment processed for AVN #" << avnId << " - PKR " << fixed << setprecision(2) << amount << endl;
-                     cout << "AVN status updated to PAID." << endl;
-                 } else {
-                     lock_guard<mutex> lock(cout_mutex);
-                     cout << "\nInsufficient payment for AVN #" << avnId << ". Required: PKR " << fixed << setprecision(2) << avn->totalAmount << endl;
+     void flushSessions() {
+         for (auto& session : sessions) {
+             const char* data = session->output.data();
+             size_t remaining = session->output.size();
+             while (remaining > 0) {
+                 ssize_t written = write(session->outputFd, data, remaining);
+                 if (written <= 0) {
+                     if (written < 0 && errno == EINTR) {
+                         continue;
+                     }
+                     break; // Output gone; drop it
                  }
-                 return;
+                 data += written;
+                 remaining -= written;
              }
+             session->output.clear();
          }
-         
-         lock_guard<mutex> lock(cout_mutex);
-         cout << "\nAVN #" << avnId << " not found." << endl;
      }
      
-     void displayAVNDetails(int avnId) {
-         for (const auto& avn : allAVNs) {
-             if (avn->id == avnId) {
-                 avn->printDetails();
-                 return;
+     // Drop sessions that exited, or whose input ended with nothing in flight
+     void reapSessions() {
+         for (size_t i = 0; i < sessions.size();) {
+             Session& session = *sessions[i];
+             bool idle = session.state != SessionState::WAITING && session.input.empty();
+             if (session.exiting || (session.inputEnded && idle)) {
+                 for (auto it = pendingRequests.begin(); it != pendingRequests.end();) {
+                     it = (it->second.session == &session) ? pendingRequests.erase(it) : next(it);
+                 }
+                 if (session.pollable && !session.inputEnded) {
+                     epoll_ctl(epollFd, EPOLL_CTL_DEL, session.inputFd, nullptr);
+                 }
+                 sessions.erase(sessions.begin() + i);
+             } else {
+                 i++;
              }
          }
-         
-         lock_guard<mutex> lock(cout_mutex);
-         cout << "\nAVN #" << avnId << " not found." << endl;
      }
      
-     void displayAirlineViolations(const string& airlineName) {
-         auto airlineIt = airlines.find(airlineName);
-         if (airlineIt != airlines.end()) {
-             airlineIt->second->printViolations();
-         } else {
-             lock_guard<mutex> lock(cout_mutex);
-             cout << "\nAirline '" << airlineName << "' not found." << endl;
+ public:
+     // Without a StripePay pipe, payment requests go to the generator, which
+     // forwards them (a portal connected over --portal)
+     AirlinePortal(int read, int write, int stripePay, const AVNLedger* avnLedger = nullptr) 
+         : responses(read), responsesOpen(read >= 0), generatorOut(write, write == read ? static_cast<uint32_t>(EPOLLIN) : 0u),
+           stripePayOut(stripePay),
+           paymentsOut(stripePay >= 0 ? &stripePayOut : &generatorOut), epollFd(epoll_create1(EPOLL_CLOEXEC)),
+           wakeFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)), running(false), nextRequestId(1), ledger(avnLedger) {
+         // Pipe writes must never stall the reactor
+         for (int fd : {write, stripePay}) {
+             if (fd >= 0) {
+                 fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+             }
+         }
+         watch(wakeFd, EPOLLIN, EPOLL_CTL_ADD);
+         if (responsesOpen) {
+             watch(read, EPOLLIN, EPOLL_CTL_ADD);
          }
      }
      
-     const vector<shared_ptr<AVN>>& getAllAVNs() const {
-         return allAVNs;
+     ~AirlinePortal() {
+         close(epollFd);
+         close(wakeFd);
      }
      
-     const map<string, shared_ptr<Airline>>& getAirlines() const {
-         return airlines;
+     AirlinePortal(const AirlinePortal&) = delete;
+     AirlinePortal& operator=(const AirlinePortal&) = delete;
+     
+     // Serve another user on its own input and output. Input is read as
+     // lines, so a pipe, socket or terminal all work.
+     void addSession(int inputFd, int outputFd) {
+         unique_ptr<Session> session(new Session{inputFd, outputFd, true, SessionState::MENU, "", "", 0, false, false});
+         epoll_event event = {};
+         event.events = EPOLLIN;
+         event.data.fd = inputFd;
+         if (epoll_ctl(epollFd, EPOLL_CTL_ADD, inputFd, &event) != 0) {
+             session->pollable = false; // Regular file: always readable
+         }
+         showMenu(*session);
+         sessions.push_back(move(session));
      }
- };
- 
- // AVN Generator Process
- class AVNGenerator {
- private:
-     vector<shared_ptr<AVN>> avns;
-     int nextAVNId;
-     int readPipe;
-     int writePipe;
      
- public:
-     AVNGenerator(int read, int write) 
-         : nextAVNId(1000), readPipe(read), writePipe(write) {}
+     // Ask the generator for new-AVN notices about these airlines only
+     void subscribe(const vector<string>& airlines) {
+         FrameWriter request;
+         if (airlines.empty()) {
+             request.emptyFrame(MessageType::SUBSCRIBE, 0);
+         }
+         for (const string& airline : airlines) {
+             request.beginRecord(MessageType::SUBSCRIBE);
+             request.putString(airline);
+             request.endRecord();
+         }
+         send(generatorOut, request);
+     }
+     
+     // Make run() return; safe from any thread or a signal handler
+     void stop() {
+         uint64_t one = 1;
+         ssize_t ignored = write(wakeFd, &one, sizeof(one));
+         (void)ignored;
+     }
      
+     // Serve sessions until they have all exited or stop() is called. With
+     // no session added, the terminal is the only one.
      void run() {
-         while (true) {
-             // Read messages from pipe
-             IPCMessage message;
-             ssize_t bytesRead = read(readPipe, &message, sizeof(message));
-             
-             if (bytesRead <= 0) {
-                 // Error or pipe closed
-                 break;
+         // A closed pipe must not kill the portal
+         signal(SIGPIPE, SIG_IGN);
+         if (sessions.empty()) {
+             addSession(STDIN_FILENO, STDOUT_FILENO);
+         }
+         
+         running = true;
+         flushSessions();
+         epoll_event events[MAX_EVENTS];
+         while (running && !sessions.empty()) {
+             // Input that epoll cannot watch is read without waiting
+             int timeout = nextTimeoutMs();
+             for (auto& session : sessions) {
+                 if (!session->pollable && !session->inputEnded && session->state != SessionState::WAITING) {
+                     timeout = 0;
+                 }
              }
              
-             processMessage(message);
-         }
-     }
-     
-     void processMessage(const IPCMessage& message) {
-         switch (message.type) {
-             case MessageType::AVN_CREATED: {
-                 // Create a new AVN based on the message
-                 FlightType flightType = (strncmp(message.details, "COMMERCIAL", sizeof(message.details)) == 0) ? 
-                                        FlightType::COMMERCIAL : FlightType::CARGO;
-                 
-                 // Create a new AVN with proper speed information
-                 auto newAVN = make_shared<AVN>(
-                     nextAVNId++,
-                     string(message.airline),
-                     string(message.flightNumber),
-                     flightType,
-                     static_cast<int>(message.amount),  // Recorded speed
-                     message.minSpeed,  // Permissible min speed
-                     message.maxSpeed   // Permissible max speed
-                 );
-                 
-                 // Store the AVN
-                 avns.push_back(newAVN);
-                 
-                 // Send notification to Airline Portal
-                 IPCMessage response;
-                 response.type = MessageType::AVN_CREATED;
-                 response.avnId = newAVN->id;
-                 strncpy(response.airline, newAVN->airline.c_str(), sizeof(response.airline) - 1);
-                 response.airline[sizeof(response.airline) - 1] = '\0';
-                 strncpy(response.flightNumber, newAVN->flightNumber.c_str(), sizeof(response.flightNumber) - 1);
-                 response.flightNumber[sizeof(response.flightNumber) - 1] = '\0';
-                 response.amount = newAVN->totalAmount;
-                 strncpy(response.details, (newAVN->status == PaymentStatus::PAID) ? "PAID" : "UNPAID", sizeof(response.details) - 1);
-                 response.details[sizeof(response.details) - 1] = '\0';
-                 
-                 write(writePipe, &response, sizeof(response));
-                 
-                 lock_guard<mutex> lock(cout_mutex);
-                 cout << "[AVN Generator] Created AVN #" << newAVN->id << " for " 
-                      << newAVN->airline << " flight " << newAVN->flightNumber 
-                      << " - PKR " << fixed << setprecision(2) << newAVN->totalAmount << endl;
+             int ready = epoll_wait(epollFd, events, MAX_EVENTS, timeout);
+             if (ready < 0 && errno != EINTR) {
                  break;
              }
-                 
-             case MessageType::PAYMENT_CONFIRMATION: {
-                 // Find the AVN and update its status
-                 for (auto& avn : avns) {
-                     if (avn->id == message.avnId) {
-                         avn->status = PaymentStatus::PAID;
-                         
-                         // Send confirmation to Airline Portal
-                         IPCMessage response;
-                         response.type = MessageType::PAYMENT_CONFIRMATION;
-                         response.avnId = avn->id;
-                         strncpy(response.airline, avn->airline.c_str(), sizeof(response.airline) - 1);
-                         response.airline[sizeof(response.airline) - 1] = '\0';
-                         response.amount = message.amount;
-                         
-                         write(writePipe, &response, sizeof(response));
-                         
-                         lock_guard<mutex> lock(cout_mutex);
-                         cout << "[AVN Generator] Payment confirmed for AVN #" << avn->id 
-                              << " - PKR " << fixed << setprecision(2) << message.amount << endl;
-                         break;
+             for (int i = 0; i < ready; i++) {
+                 int fd = events[i].data.fd;
+                 if (fd == wakeFd) {
+                     running = false;
+                 } else if (fd == responses.getFd() || fd == generatorOut.getFd()) {
+                     // One socket both ways when connected over --portal
+                     if (responsesOpen && fd == responses.getFd() && (events[i].events & ~EPOLLOUT)) {
+                         readResponses();
+                     }
+                     if (fd == generatorOut.getFd() && (events[i].events & EPOLLOUT)) {
+                         generatorOut.flush(epollFd);
+                     }
+                 } else if (fd == stripePayOut.getFd()) {
+                     stripePayOut.flush(epollFd);
+                 } else {
+                     for (auto& session : sessions) {
+                         if (session->pollable && session->inputFd == fd) {
+                             readInput(*session);
+                             break;
+                         }
                      }
                  }
-                 break;
              }
-                 
-             case MessageType::QUERY_AVN: {
-                 // Find the AVN and send its details
-                 for (const auto& avn : avns) {
-                     if (avn->id == message.avnId) {
-                         IPCMessage response;
-                         response.type = MessageType::QUERY_AVN;
-                         response.avnId = avn->id;
-                         strncpy(response.airline, avn->airline.c_str(), sizeof(response.airline) - 1);
-                         response.airline[sizeof(response.airline) - 1] = '\0';
-                         strncpy(response.flightNumber, avn->flightNumber.c_str(), sizeof(response.flightNumber) - 1);
-                         response.flightNumber[sizeof(response.flightNumber) - 1] = '\0';
-                         response.amount = avn->totalAmount;
-                         strncpy(response.details, (avn->status == PaymentStatus::PAID) ? "PAID" : "UNPAID", sizeof(response.details) - 1);
-                         response.details[sizeof(response.details) - 1] = '\0';
-                         
-                         write(writePipe, &response, sizeof(response));
-                         break;
-                     }
+             for (size_t i = 0; i < sessions.size(); i++) {
+                 Session& session = *sessions[i];
+                 if (!session.pollable && !session.inputEnded && session.state != SessionState::WAITING) {
+                     readInput(session);
                  }
-                 break;
              }
-                 
-             case MessageType::QUERY_AIRLINE: {
-                 // Find all AVNs for the airline
-                 stringstream ss;
-                 int count = 0;
-                 
-                 for (const auto& avn : avns) {
-                     if (avn->airline == string(message.airline)) {
-                         ss << "AVN #" << avn->id << " | " << avn->flightNumber 
-                            << " | PKR " << fixed << setprecision(2) << avn->totalAmount 
-                            << " | " << ((avn->status == PaymentStatus::PAID) ? "PAID" : "UNPAID") << "\n";
-                         count++;
+             
+             expireRequests();
+             flushSessions();
+             reapSessions();
+         }
+     }
+ };
+ 
+ // StripePay Process
+ class StripePay {
+ private:
+     // A payment accepted from the portal, confirmed once its gateway round trip is due
+     struct PendingPayment {
+         int avnId;
+         double amount;
+         chrono::steady_clock::time_point dueAt;
+         uint64_t requestedAtNs; // Portal's send time, echoed in the confirmation
+         uint64_t acceptedAtNs;
+     };
+     
+     // Written only by its own worker thread; the reader merges them on STATS_DUMP
+     struct WorkerStats {
+         LatencyHistogram gatewayTime; // Accepted to confirmation written
+         atomic<uint64_t> batches{0};
+     };
+     
+     FrameReader requests;  // PAYMENT_REQUEST frames from the portal
+     FrameReader forwardedRequests; // ... and those the AVN Generator forwards from portal clients
+     int writePipe;
+     
+     // Every payment has the same latency, so acceptance order is due order
+     deque<PendingPayment> inFlight;
+     bool closing;
+     mutex queueMutex;
+     condition_variable workReady;  // Payment accepted or shutting down
+     condition_variable spaceFree;  // In-flight queue has room
+     mutex writeMutex;              // One confirmation batch on the pipe at a time
+     vector<unique_ptr<WorkerStats>> workerStats;
+     LatencyHistogram admissionWait; // Reader blocked on a full in-flight queue
+     LatencyHistogram forwardedAdmissionWait; // The same, for the forwarded-request reader
+     
+     void readRequests(FrameReader& reader, LatencyHistogram& waits) {
+         // Read whatever the pipe holds and accept every payment record in it
+         while (reader.fill()) {
+             FrameHeader header;
+             FrameCursor cursor(nullptr, 0);
+             while (reader.next(header, cursor)) {
+                 if (static_cast<MessageType>(header.type) == MessageType::STATS_DUMP) {
+                     printStats();
+                     continue;
+                 }
+                 if (static_cast<MessageType>(header.type) != MessageType::PAYMENT_REQUEST) {
+                     continue;
+                 }
+                 for (uint32_t i = 0; i < header.count; i++) {
+                     int avnId = cursor.getInt();
+                     double amount = cursor.getDouble();
+                     uint64_t requestedAtNs = cursor.getUint64();
+                     if (!cursor.ok()) {
+                         break;
                      }
+                     acceptPayment(avnId, amount, requestedAtNs, waits);
                  }
-                 
-                 IPCMessage response;
-                 response.type = MessageType::QUERY_AIRLINE;
-                 strncpy(response.airline, message.airline, sizeof(response.airline) - 1);
-                 response.airline[sizeof(response.airline) - 1] = '\0';
-                 string detailsStr = ss.str();
-                 strncpy(response.details, detailsStr.c_str(), sizeof(response.details) - 1);
-                 response.details[sizeof(response.details) - 1] = '\0';
-                 
-                 write(writePipe, &response, sizeof(response));
-                 
-                 lock_guard<mutex> lock(cout_mutex);
-                 cout << "[AVN Generator] Queried " << count << " AVNs for " << message.airline << endl;
-                 break;
              }
-                 
-             default:
-                 break;
          }
      }
- };
- 
- // Airline Portal Process
- class AirlinePortal {
- private:
-     int readPipe;
-     int writePipe;
-     int stripePayPipe;
-     map<string, vector<shared_ptr<AVN>>> airlineAVNs;
      
- public:
-     AirlinePortal(int read, int write, int stripePay) 
-         : readPipe(read), writePipe(write), stripePayPipe(stripePay) {}
+     void acceptPayment(int avnId, double amount, uint64_t requestedAtNs, LatencyHistogram& waits) {
+         {
+             lock_guard<mutex> lock(cout_mutex);
+             cout << "[StripePay] Processing payment for AVN #" << avnId 
+                  << " - PKR " << fixed << setprecision(2) << amount << endl;
+         }
+         
+         // Block the reader (and so the portal) while the gateway is saturated
+         uint64_t arrivedAtNs = monotonicNs();
+         unique_lock<mutex> lock(queueMutex);
+         spaceFree.wait(lock, [this] { return inFlight.size() < STRIPE_MAX_IN_FLIGHT; });
+         uint64_t acceptedAtNs = monotonicNs();
+         inFlight.push_back({avnId, amount, chrono::steady_clock::now() + chrono::milliseconds(STRIPE_PROCESSING_MS),
+                             requestedAtNs, acceptedAtNs});
+         workReady.notify_one();
+         lock.unlock();
+         waits.record(acceptedAtNs - arrivedAtNs);
+     }
      
-     void run() {
+     void workerLoop(WorkerStats& stats) {
+         vector<PendingPayment> batch;
+         unique_lock<mutex> lock(queueMutex);
+         
          while (true) {
-             displayMenu();
+             if (inFlight.empty()) {
+                 if (closing) {
+                     break;
+                 }
+                 workReady.wait(lock);
+                 continue;
+             }
              
-             int choice;
-             cin >> choice;
+             auto now = chrono::steady_clock::now();
+             if (inFlight.front().dueAt > now) {
+                 workReady.wait_until(lock, inFlight.front().dueAt);
+                 continue;
+             }
              
-             switch (choice) {
-                 case 1:
-                     viewAirlineAVNs();
-                     break;
-                     
-                 case 2:
-                     payAVN();
-                     break;
-                     
-                 case 3:
-                     viewAVNDetails();
-                     break;
-                     
-                 case 4:
-                     cout << "Exiting Airline Portal." << endl;
-                     return;
-                     
-                 default:
-                     cout << "Invalid choice. Please try again." << endl;
-                     break;
+             // Take every payment that is due, up to one batch
+             batch.clear();
+             while (!inFlight.empty() && inFlight.front().dueAt <= now && batch.size() < STRIPE_CONFIRM_BATCH) {
+                 batch.push_back(inFlight.front());
+                 inFlight.pop_front();
              }
+             spaceFree.notify_all();
              
-             // Process any incoming messages
-             processIncomingMessages();
+             lock.unlock();
+             confirmPayments(batch);
+             uint64_t confirmedAtNs = monotonicNs();
+             for (const auto& payment : batch) {
+                 stats.gatewayTime.record(confirmedAtNs - payment.acceptedAtNs);
+             }
+             stats.batches.store(stats.batches.load(memory_order_relaxed) + 1, memory_order_relaxed);
+             lock.lock();
          }
      }
      
-     void displayMenu() {
+     void confirmPayments(const vector<PendingPayment>& batch) {
+         // The whole batch shares PAYMENT_CONFIRMATION frames
+         FrameWriter confirmations;
+         for (const auto& payment : batch) {
+             confirmations.beginRecord(MessageType::PAYMENT_CONFIRMATION);
+             confirmations.putInt(payment.avnId);
+             confirmations.putDouble(payment.amount);
+             confirmations.putUint64(payment.requestedAtNs);
+             confirmations.endRecord();
+         }
+         {
+             lock_guard<mutex> lock(writeMutex);
+             confirmations.flush(writePipe);
+         }
+         
          lock_guard<mutex> lock(cout_mutex);
-         cout << "\n===== AIRLINE PORTAL =====\n";
-         cout << "1. View Airline AVNs\n";
-         cout << "2. Pay AVN\n";
-         cout << "3. View AVN Details\n";
-         cout << "4. Exit\n";
-         cout << "Enter your choice: ";
+         for (const auto& payment : batch) {
+             cout << "[StripePay] Payment confirmed for AVN #" << payment.avnId 
+                  << " - PKR " << fixed << setprecision(2) << payment.amount << endl;
+         }
      }
      
-     void viewAirlineAVNs() {
-         string airline;
-         lock_guard<mutex> lock(cout_mutex);
-         cout << "Enter airline name: ";
-         cin >> airline;
-         
-         // Request AVNs for the airline
-         IPCMessage request;
-         request.type = MessageType::QUERY_AIRLINE;
-         strncpy(request.airline, airline.c_str(), sizeof(request.airline) - 1);
-         request.airline[sizeof(request.airline) - 1] = '\0';
-         
-         write(writePipe, &request, sizeof(request));
-         
-         // Wait for response
-         sleep(1);
-         processIncomingMessages();
+ public:
+     StripePay(int read, int write, int forwarded = -1)
+         : requests(read), forwardedRequests(forwarded), writePipe(write), closing(false) {
+         for (int i = 0; i < STRIPE_WORKER_COUNT; i++) {
+             workerStats.emplace_back(new WorkerStats());
+         }
      }
      
-     void payAVN() {
-         int avnId;
-         lock_guard<mutex> lock(cout_mutex);
-         cout << "Enter AVN ID to pay: ";
-         cin >> avnId;
-         
-         // Query AVN details first
-         IPCMessage request;
-         request.type = MessageType::QUERY_AVN;
-         request.avnId = avnId;
-         
-         write(writePipe, &request, sizeof(request));
-         
-         // Wait for response
-         sleep(1);
-         processIncomingMessages();
-         
-         // Now request payment
-         double amount;
-         lock_guard<mutex> lock2(cout_mutex);
-         cout << "Enter payment amount (PKR): ";
-         cin >> amount;
-         
-         // Send payment request to StripePay
-         IPCMessage paymentRequest;
-         paymentRequest.type = MessageType::PAYMENT_REQUEST;
-         paymentRequest.avnId = avnId;
-         paymentRequest.amount = amount;
+     // Per-worker counts, then all workers' gateway times merged
+     void printStats() {
+         LatencyHistogram gatewayTime;
+         for (const auto& stats : workerStats) {
+             gatewayTime.merge(stats->gatewayTime);
+         }
          
-         write(stripePayPipe, &paymentRequest, sizeof(paymentRequest));
+         LatencyHistogram allAdmissionWait;
+         allAdmissionWait.merge(admissionWait);
+         allAdmissionWait.merge(forwardedAdmissionWait);
          
-         lock_guard<mutex> lock3(cout_mutex);
-         cout << "Payment request sent for AVN #" << avnId << " - PKR " << fixed << setprecision(2) << amount << endl;
-     }
-     
-     void viewAVNDetails() {
-         int avnId;
          lock_guard<mutex> lock(cout_mutex);
-         cout << "Enter AVN ID: ";
-         cin >> avnId;
-         
-         // Request AVN details
-         IPCMessage request;
-         request.type = MessageType::QUERY_AVN;
-         request.avnId = avnId;
-         
-         write(writePipe, &request, sizeof(request));
-         
-         // Wait for response
-         sleep(1);
-         processIncomingMessages();
+         cout << "\n======== STRIPEPAY LATENCY STATISTICS ========" << endl;
+         allAdmissionWait.print("Admission Wait", 1e3, "us");
+         gatewayTime.print("Gateway Time", 1e6, "ms");
+         for (size_t i = 0; i < workerStats.size(); i++) {
+             cout << "Worker " << i << ": " << workerStats[i]->gatewayTime.count() << " payments in "
+                  << workerStats[i]->batches.load(memory_order_relaxed) << " batches" << endl;
+         }
+         cout << "==============================================" << endl;
      }
      
-     void processIncomingMessages() {
-         // Check if there are messages to read
-         fd_set readSet;
-         FD_ZERO(&readSet);
-         FD_SET(readPipe, &readSet);
+     void run() {
+         vector<thread> workers;
+         for (int i = 0; i < STRIPE_WORKER_COUNT; i++) {
+             workers.emplace_back(&StripePay::workerLoop, this, ref(*workerStats[i]));
+         }
          
-         struct timeval timeout;
-         timeout.tv_sec = 0;
-         timeout.tv_usec = 100000; // 100ms timeout
+         thread forwardedReader;
+         if (forwardedRequests.getFd() >= 0) {
+             forwardedReader = thread(&StripePay::readRequests, this, ref(forwardedRequests), ref(forwardedAdmissionWait));
+         }
+         readRequests(requests, admissionWait);
+         if (forwardedReader.joinable()) {
+             forwardedReader.join();
+         }
          
-         while (select(readPipe + 1, &readSet, NULL, NULL, &timeout) > 0) {
-             IPCMessage message;
-             ssize_t bytesRead = read(readPipe, &message, sizeof(message));
-             
-             if (bytesRead <= 0) {
-                 break;
-             }
-             
-             lock_guard<mutex> lock(cout_mutex);
-             switch (message.type) {
-                 case MessageType::AVN_CREATED:
-                     cout << "\n[Airline Portal] New AVN #" << message.avnId << " created for " 
-                          << message.airline << " flight " << message.flightNumber 
-                          << " - PKR " << fixed << setprecision(2) << message.amount << endl;
-                     break;
-                     
-                 case MessageType::PAYMENT_CONFIRMATION:
-                     cout << "\n[Airline Portal] Payment confirmed for AVN #" << message.avnId 
-                          << " - PKR " << fixed << setprecision(2) << message.amount << endl;
-                     break;
-                     
-                 case MessageType::QUERY_AVN:
-                     cout << "\n===== AVN #" << message.avnId << " =====\n";
-                     cout << "Airline: " << message.airline << endl;
-                     cout << "Flight: " << message.flightNumber << endl;
-                     cout << "Amount: PKR " << fixed << setprecision(2) << message.amount << endl;
-                     cout << "Status: " << message.details << endl;
-                     cout << "========================" << endl;
-                     break;
-                     
-                 case MessageType::QUERY_AIRLINE:
-                     cout << "\n===== AVNs for " << message.airline << " =====\n";
-                     if (message.details[0] == '\0') {
-                         cout << "No AVNs found for this airline." << endl;
-                     } else {
-                         cout << message.details;
-                     }
-                     cout << "========================" << endl;
-                     break;
-                     
-                 default:
-                     break;
-             }
-             
-             // Check if there are more messages
-             FD_ZERO(&readSet);
-             FD_SET(readPipe, &readSet);
-             timeout.tv_sec = 0;
-             timeout.tv_usec = 100000;
+         // Portal and generator gone: let the workers confirm what is still in flight
+         {
+             lock_guard<mutex> lock(queueMutex);
+             closing = true;
+         }
+         workReady.notify_all();
+         for (auto& worker : workers) {
+             worker.join();
          }
      }
  };
  
- // StripePay Process
- class StripePay {
+ // Monte-Carlo scenario runner: fans seeded headless runs out over a pool of
+ // worker threads and aggregates their metrics. Each run owns its scheduler,
+ // RNG and ID counters, so no state is shared between workers.
+ class ScenarioRunner {
  private:
-     int readPipe;
-     int writePipe;
+     int scenarioCount;
+     int threadCount;
+     int duration;
+     unsigned baseSeed;
+     RunwayConfig runways;
+     RuleSet rules;
+     vector<SimulationMetrics> results;
+     double wallTimeMs;
+     
+     void runScenario(int index) {
+         FlightScheduler scheduler(nullptr, baseSeed + index);
+         scheduler.setVerbose(false);
+         scheduler.configureRunways(runways);
+         scheduler.setRules(rules);
+         scheduler.runUntil(duration);
+         results[index] = scheduler.getMetrics();
+     }
      
  public:
-     StripePay(int read, int write) : readPipe(read), writePipe(write) {}
+     ScenarioRunner(int scenarios, int threads, int duration, unsigned seed, const RunwayConfig& runways = RunwayConfig(),
+                    const RuleSet& rules = DEFAULT_RULES)
+         : scenarioCount(scenarios), threadCount(max(1, min(threads, scenarios))),
+           duration(duration), baseSeed(seed), runways(runways), rules(rules), results(scenarios), wallTimeMs(0.0) {}
      
      void run() {
-         while (true) {
-             // Read payment requests
-             IPCMessage message;
-             ssize_t bytesRead = read(readPipe, &message, sizeof(message));
-             
-             if (bytesRead <= 0) {
-                 // Error or pipe closed
-                 break;
-             }
-             
-             if (message.type == MessageType::PAYMENT_REQUEST) {
-                 processPayment(message);
+         // Workers pull the next scenario index until all are taken
+         atomic<int> nextScenario(0);
+         auto worker = [this, &nextScenario]() {
+             int index;
+             while ((index = nextScenario++) < scenarioCount) {
+                 runScenario(index);
              }
+         };
+         
+         auto start = chrono::steady_clock::now();
+         vector<thread> pool;
+         for (int i = 0; i < threadCount; i++) {
+             pool.emplace_back(worker);
          }
+         for (auto& t : pool) {
+             t.join();
+         }
+         wallTimeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
      }
      
-     void processPayment(const IPCMessage& request) {
-         lock_guard<mutex> lock(cout_mutex);
-         cout << "[StripePay] Processing payment for AVN #" << request.avnId 
-              << " - PKR " << fixed << setprecision(2) << request.amount << endl;
+     void printReport() const {
+         // Aggregate min/mean/max of one metric across all runs
+         auto printStat = [this](const string& label, auto metric) {
+             double total = 0.0;
+             double low = numeric_limits<double>::max();
+             double high = numeric_limits<double>::lowest();
+             for (const auto& result : results) {
+                 double value = metric(result);
+                 total += value;
+                 low = min(low, value);
+                 high = max(high, value);
+             }
+             cout << left << setw(22) << label << right << fixed << setprecision(2)
+                  << " mean " << setw(8) << total / results.size()
+                  << "  min " << setw(8) << low
+                  << "  max " << setw(8) << high << endl;
+         };
          
-         // Simulate payment processing
-         sleep(2);
+         lock_guard<mutex> lock(cout_mutex);
+         cout << "\n======== MONTE-CARLO SUMMARY ========" << endl;
+         cout << "Scenarios: " << scenarioCount << " x " << duration << " seconds (seeds "
+              << baseSeed << "-" << baseSeed + scenarioCount - 1 << ")" << endl;
+         cout << "Worker Threads: " << threadCount << endl;
+         cout << "Runway Policy: " << FlightScheduler::policyName(runways.policy)
+              << "  Topology: " << runways.topology.str() << endl;
          
-         // Send confirmation
-         IPCMessage confirmation;
-         confirmation.type = MessageType::PAYMENT_CONFIRMATION;
-         confirmation.avnId = request.avnId;
-         confirmation.amount = request.amount;
+         for (size_t r = 0; r < runways.topology.size(); r++) {
+             printStat("Runway " + runwayLetter(r) + " Util (%)",
+                       [r](const SimulationMetrics& m) { return m.runwayUtilisation(m.runwayBusyTime[r]); });
+         }
+         printStat("Avg Queue Wait (s)", [](const SimulationMetrics& m) { return m.averageQueueWait(); });
+         printStat("Max Queue Wait (s)", [](const SimulationMetrics& m) { return static_cast<double>(m.maxQueueWait); });
+         printStat("AVNs Issued", [](const SimulationMetrics& m) { return static_cast<double>(m.avnsIssued); });
+         printStat("Flights Completed", [](const SimulationMetrics& m) { return static_cast<double>(m.flightsCompleted); });
          
-         write(writePipe, &confirmation, sizeof(confirmation));
+         cout << "Wall Time: " << fixed << setprecision(3) << wallTimeMs << " ms" << endl;
+         cout << "=====================================" << endl;
+     }
+ };
+ 
+ // Trace options for a headless run
+ struct TraceConfig {
+     string recordPath; // Write the run's trace here
+     string replayPath; // Re-run this trace instead of rolling the RNG
+ };
+ 
+ // Open the --schedule timetable, if one was given
+ bool openSchedule(ScheduleLoader& loader, const string& path) {
+     return path.empty() || loader.open(path);
+ }
+ 
+ // Portal socket address: "tcp:[HOST:]PORT" (HOST defaults to 127.0.0.1),
+ // otherwise the path of a Unix domain socket
+ struct PortalAddress {
+     sockaddr_storage storage;
+     socklen_t length;
+     
+     int family() const {
+         return storage.ss_family;
+     }
+     
+     const sockaddr* get() const {
+         return reinterpret_cast<const sockaddr*>(&storage);
+     }
+     
+     bool parse(const string& address) {
+         memset(&storage, 0, sizeof(storage));
+         if (address.compare(0, 4, "tcp:") != 0) {
+             sockaddr_un& unixAddress = reinterpret_cast<sockaddr_un&>(storage);
+             if (address.empty() || address.size() >= sizeof(unixAddress.sun_path)) {
+                 cerr << "Portal socket path must be 1 to " << sizeof(unixAddress.sun_path) - 1 << " bytes: " << address << endl;
+                 return false;
+             }
+             unixAddress.sun_family = AF_UNIX;
+             memcpy(unixAddress.sun_path, address.c_str(), address.size());
+             length = sizeof(unixAddress);
+             return true;
+         }
          
-         lock_guard<mutex> lock2(cout_mutex);
-         cout << "[StripePay] Payment confirmed for AVN #" << request.avnId 
-              << " - PKR " << fixed << setprecision(2) << request.amount << endl;
+         string hostPort = address.substr(4);
+         size_t colon = hostPort.rfind(':');
+         string host = (colon == string::npos) ? "127.0.0.1" : hostPort.substr(0, colon);
+         string port = (colon == string::npos) ? hostPort : hostPort.substr(colon + 1);
+         sockaddr_in& inetAddress = reinterpret_cast<sockaddr_in&>(storage);
+         int portNumber = 0;
+         auto parsed = from_chars(port.data(), port.data() + port.size(), portNumber);
+         if (parsed.ptr != port.data() + port.size() || port.empty() || portNumber <= 0 || portNumber > 65535 ||
+             inet_pton(AF_INET, host.c_str(), &inetAddress.sin_addr) != 1) {
+             cerr << "Portal address must be tcp:[IPv4:]PORT or a socket path: " << address << endl;
+             return false;
+         }
+         inetAddress.sin_family = AF_INET;
+         inetAddress.sin_port = htons(portNumber);
+         length = sizeof(inetAddress);
+         return true;
+     }
+ };
+ 
+ // Listening socket the AVN Generator serves portal clients on; -1 on error
+ int openPortalListener(const string& address) {
+     PortalAddress portal;
+     if (!portal.parse(address)) {
+         return -1;
+     }
+     int fd = socket(portal.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+     if (portal.family() == AF_UNIX) {
+         // A socket left behind by an earlier run would make bind() fail
+         struct stat existing;
+         if (stat(address.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+             unlink(address.c_str());
+         }
+     } else {
+         int reuse = 1;
+         setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+     }
+     if (fd < 0 || bind(fd, portal.get(), portal.length) != 0 || listen(fd, SOMAXCONN) != 0) {
+         cerr << "Cannot listen on " << address << ": " << strerror(errno) << endl;
+         if (fd >= 0) {
+             close(fd);
+         }
+         return -1;
+     }
+     return fd;
+ }
+ 
+ // Remove the socket file of a Unix-domain listener once the run is over
+ void closePortalListener(int fd, const string& address) {
+     PortalAddress portal;
+     if (fd >= 0 && portal.parse(address) && portal.family() == AF_UNIX) {
+         unlink(address.c_str());
+     }
+ }
+ 
+ // Airline Portal for a running simulation, connected to its --portal-listen
+ // socket. airlines limits the new-AVN notices shown; empty shows all.
+ int runPortalClient(const string& address, const vector<string>& airlines) {
+     PortalAddress portal;
+     if (!portal.parse(address)) {
+         return 1;
+     }
+     int fd = socket(portal.family(), SOCK_STREAM | SOCK_CLOEXEC, 0);
+     if (fd < 0 || connect(fd, portal.get(), portal.length) != 0) {
+         cerr << "Cannot connect to " << address << ": " << strerror(errno) << endl;
+         if (fd >= 0) {
+             close(fd);
+         }
+         return 1;
+     }
+     if (portal.family() == AF_INET) {
+         int noDelay = 1;
+         setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+     }
+     
+     // One socket carries queries, payments and notices both ways
+     AirlinePortal airlinePortal(fd, fd, -1);
+     if (!airlines.empty()) {
+         airlinePortal.subscribe(airlines);
+     }
+     airlinePortal.run();
+     close(fd);
+     return 0;
+ }
+ 
+ // Headless batch run: no menu, no child processes and no per-tick status output.
+ // speed is simulated seconds per wall-clock second; 0 runs as fast as possible.
+ // A replayed trace brings its own seed and duration.
+ int runHeadless(int duration, double speed, unsigned seed, int tickThreads, const RetentionConfig& retention,
+                 const TraceConfig& trace, const string& schedulePath, const RunwayConfig& runways, const RuleSet& rules,
+                 OverrunPolicy overrunPolicy) {
+     // Traces do not carry timetable flight numbers, so the two do not mix
+     if (!schedulePath.empty() && !(trace.recordPath.empty() && trace.replayPath.empty())) {
+         cerr << "--schedule cannot be combined with --record-trace or --replay" << endl;
+         return 1;
+     }
+     ScheduleLoader schedule;
+     if (!openSchedule(schedule, schedulePath)) {
+         return 1;
+     }
+     
+     TraceWriter traceWriter;
+     TraceReader traceReader;
+     if (!trace.replayPath.empty()) {
+         if (!traceReader.open(trace.replayPath)) {
+             return 1;
+         }
+         seed = traceReader.getHeader().seed;
+         duration = traceReader.getHeader().duration;
+     } else if (!trace.recordPath.empty() && !traceWriter.create(trace.recordPath, seed, duration)) {
+         return 1;
+     }
+     
+     FlightScheduler scheduler(nullptr, seed);
+     scheduler.setVerbose(false);
+     scheduler.setTickThreads(tickThreads);
+     scheduler.configureRunways(runways);
+     scheduler.setRules(rules);
+     if (!scheduler.setRetention(retention)) {
+         return 1;
+     }
+     if (!trace.replayPath.empty()) {
+         scheduler.replayTrace(&traceReader);
+     } else if (!trace.recordPath.empty()) {
+         scheduler.recordTrace(&traceWriter);
+     }
+     if (!schedulePath.empty()) {
+         scheduler.attachSchedule(&schedule);
+     }
+     
+     auto start = chrono::steady_clock::now();
+     unique_ptr<TickClock> tickClock;
+     if (speed > 0) {
+         // Paced runs step every second on the clock's deadlines, so wall time tracks simulated time
+         tickClock.reset(new TickClock(speed, overrunPolicy));
+         for (int tick = 0; tick < duration; tick++) {
+             tickClock->waitNextTick();
+             scheduler.updateSimulation();
+         }
+     } else {
+         scheduler.runUntil(duration);
+     }
+     auto elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start);
+     
+     scheduler.printSummary();
+     int status = 0;
+     if (!schedulePath.empty()) {
+         cout << "Schedule Rows: " << schedule.getRowsRead() << " read, " << schedule.getRowsRejected() << " skipped" << endl;
+     }
+     if (!trace.replayPath.empty()) {
+         cout << "Trace Divergences: " << scheduler.getTraceDivergences() << endl;
+     } else if (!trace.recordPath.empty()) {
+         if (!traceWriter.finish()) {
+             status = 1;
+         }
+         cout << "Trace Records: " << traceWriter.getRecordCount() << endl;
+     }
+     cout << "Wall Time: " << fixed << setprecision(3) << elapsed.count() << " ms" << endl;
+     if (tickClock) {
+         tickClock->printStats();
+     }
+     return status;
+ }
+ 
+ // Stress run on the structure-of-arrays fleet store: fleetSize aircraft are
+ // created up front (half arrivals, half departures) and stepped for duration
+ // seconds. Speeds, limits, violation odds and the per-stream emergency odds
+ // come from rules; one in three non-emergency flights is cargo, like the
+ // airline mix. Setup draws from stream 0 of the seed, as spawns do.
+ // Runways follow the topology with greedy assignment; the fleet store has
+ // no lookahead policy.
+ int runStress(int fleetSize, int duration, unsigned seed, const RunwayConfig& runways, const RuleSet& rules) {
+     if (runways.policy != RunwayPolicy::GREEDY) {
+         cerr << "--stress supports only the greedy runway policy" << endl;
+         return 1;
      }
+     PhiloxStream rng(seed, 0);
+     uniform_int_distribution<> percentDist(1, 100);
+     
+     FleetStore fleet(rules, seed, runways.topology);
+     fleet.reserve(fleetSize / 2 + 1, fleetSize / 2 + 1);
+     for (int i = 0; i < fleetSize; i++) {
+         bool arrival = (i % 2 == 0);
+         // Entries alternate North, East, South, West
+         static const int streamOrder[4] = {0, 2, 1, 3};
+         bool isEmergency = percentDist(rng) <= rules.emergencyPercent[streamOrder[i % 4]];
+         FlightType type = isEmergency ? FlightType::EMERGENCY
+                         : (percentDist(rng) <= 33 ? FlightType::CARGO : FlightType::COMMERCIAL);
+         if (arrival) {
+             int holdingSpeed = fleet.getProfiles().entrySpeed(type, ARRIVAL_LIMITS,
+                                                               static_cast<int>(ArrivalState::HOLDING), rng);
+             fleet.addArrival(type, isEmergency, holdingSpeed);
+         } else {
+             fleet.addDeparture(type, isEmergency);
+         }
+     }
+     
+     auto start = chrono::steady_clock::now();
+     for (int tick = 0; tick < duration; tick++) {
+         fleet.step();
+     }
+     double elapsedNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+     
+     lock_guard<mutex> lock(cout_mutex);
+     cout << "\n======== FLEET STRESS SUMMARY ========" << endl;
+     cout << "Fleet Size: " << fleetSize << " aircraft" << endl;
+     cout << "Simulated Time: " << fleet.getCurrentTime() << " seconds" << endl;
+     cout << "Topology: " << runways.topology.str() << endl;
+     cout << "Runway Assignments: " << fleet.getTotalAssignments() << endl;
+     cout << "Flights Completed: " << fleet.getTotalCompleted() << endl;
+     cout << "Flights Still Active: " << fleet.activeCount() << endl;
+     cout << "Speed Violations: " << fleet.getTotalViolations() << endl;
+     cout << "Time per Tick: " << fixed << setprecision(1) << elapsedNs / max(1, duration) << " ns" << endl;
+     cout << "Time per Aircraft-Tick: " << fixed << setprecision(2)
+          << elapsedNs / max(1, duration) / max(1, fleetSize) << " ns" << endl;
+     cout << "Wall Time: " << fixed << setprecision(3) << elapsedNs / 1e6 << " ms" << endl;
+     cout << "=====================================" << endl;
+     return 0;
+ }
+ 
+ // Settings for a --bench run
+ struct BenchConfig {
+     int fleetSize;
+     int duration;
+     unsigned seed;
+     int tickThreads;
+     int emergencyPercent; // -1 keeps the per-direction odds
+     int violationPercent;
+     RunwayConfig runways;
+     RuleSet rules;
  };
  
+ // Count records arriving on an event ring until it is closed, sleeping on
+ // the doorbell like the AVN Generator does. The handler does no work, so
+ // this measures the transport alone.
+ uint64_t consumeEventRing(AVNEventRing& ring) {
+     uint64_t received = 0;
+     while (true) {
+         received += ring.drain([](const IPCMessage&) {});
+         if (ring.finished()) {
+             return received;
+         }
+         if (ring.prepareToSleep()) {
+             pollfd doorbell = {ring.getDoorbell(), POLLIN, 0};
+             int ready = poll(&doorbell, 1, -1);
+             ring.endSleep(ready > 0 && (doorbell.revents & POLLIN));
+         }
+     }
+ }
+ 
+ // Benchmark of the FlightScheduler hot paths, without menus or child
+ // processes. The fleet is topped up to fleetSize before every tick (not
+ // timed), each tick is profiled by stage, and AVN events go through a real
+ // event ring to a consumer thread. A second pass measures the ring alone.
+ int runBench(const BenchConfig& config) {
+     AVNEventRing ring;
+     if (!ring.valid()) {
+         cerr << "AVN event ring setup failed!" << endl;
+         return 1;
+     }
+     
+     FlightScheduler scheduler(&ring, config.seed);
+     scheduler.setVerbose(false);
+     scheduler.setTickThreads(config.tickThreads);
+     scheduler.setRules(config.rules);
+     scheduler.setTrafficRates(config.emergencyPercent, config.violationPercent);
+     scheduler.configureRunways(config.runways);
+     
+     uint64_t delivered = 0;
+     thread consumer([&ring, &delivered]() { delivered = consumeEventRing(ring); });
+     
+     TickPhaseTimes phases;
+     uint64_t tickAllocations = 0;
+     long long activeSum = 0;
+     auto start = chrono::steady_clock::now();
+     for (int tick = 0; tick < config.duration; tick++) {
+         scheduler.spawnFlights(config.fleetSize);
+         activeSum += scheduler.getActiveFlightCount();
+         
+         allocationCount.store(0, memory_order_relaxed);
+         countAllocations.store(true, memory_order_relaxed);
+         scheduler.updateSimulation(&phases);
+         countAllocations.store(false, memory_order_relaxed);
+         tickAllocations += allocationCount.load(memory_order_relaxed);
+     }
+     ring.close();
+     consumer.join();
+     double runSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+     
+     // Event ring alone: one producer pushing batches as fast as it can
+     AVNEventRing rawRing;
+     if (!rawRing.valid()) {
+         cerr << "AVN event ring setup failed!" << endl;
+         return 1;
+     }
+     uint64_t rawDelivered = 0;
+     IPCMessage message = {};
+     message.type = MessageType::AVN_CREATED;
+     auto rawStart = chrono::steady_clock::now();
+     thread rawConsumer([&rawRing, &rawDelivered]() { rawDelivered = consumeEventRing(rawRing); });
+     for (int sent = 0; sent < BENCH_RING_MESSAGES; ) {
+         for (int i = 0; i < BENCH_RING_BATCH && sent < BENCH_RING_MESSAGES; i++) {
+             message.avnId = sent;
+             while (!rawRing.push(message)) {
+                 rawRing.commit();
+                 this_thread::yield();
+             }
+             sent++;
+         }
+         rawRing.commit();
+     }
+     rawRing.close();
+     rawConsumer.join();
+     double rawSeconds = chrono::duration<double>(chrono::steady_clock::now() - rawStart).count();
+     
+     int ticks = max(1, config.duration);
+     double totalNs = phases.generateNs + phases.assignNs + phases.updateNs + phases.emitNs + phases.moveNs;
+     auto printPhase = [ticks](const string& label, double ns) {
+         cout << left << setw(24) << label << right << fixed << setprecision(1)
+              << setw(12) << ns / ticks << " ns/tick" << endl;
+     };
+     
+     {
+         lock_guard<mutex> lock(cout_mutex);
+         cout << "\n======== SCHEDULER BENCHMARK ========" << endl;
+         cout << "Target Fleet: " << config.fleetSize << " aircraft (mean active "
+              << fixed << setprecision(1) << static_cast<double>(activeSum) / ticks << ")" << endl;
+         cout << "Ticks: " << config.duration << "  Tick Threads: " << max(1, config.tickThreads)
+              << "  Runway Policy: " << FlightScheduler::policyName(config.runways.policy)
+              << "  Topology: " << config.runways.topology.str() << endl;
+         cout << "Emergency Odds: ";
+         if (config.emergencyPercent >= 0) {
+             cout << config.emergencyPercent << "%";
+         } else {
+             cout << "per direction";
+         }
+         cout << "  Violation Odds: " << config.violationPercent << "%"
+              << "  Rules: " << (scheduler.usesProductionRules() ? "fixed" : "loaded") << endl;
+         printPhase("generateFlights", phases.generateNs);
+         printPhase("assignRunways", phases.assignNs);
+         printPhase("updateFlights", phases.updateNs);
+         printPhase("emitViolations", phases.emitNs);
+         printPhase("moveCompletedFlights", phases.moveNs);
+         printPhase("Tick Total", totalNs);
+         cout << "Flights Completed: " << scheduler.getMetrics().flightsCompleted << endl;
+         if (ALLOCATIONS_COUNTED) {
+             cout << "Allocations per Tick: " << fixed << setprecision(1)
+                  << static_cast<double>(tickAllocations) / ticks << endl;
+         } else {
+             cout << "Allocations per Tick: not counted (build with -DACX_COUNT_ALLOCATIONS)" << endl;
+         }
+         cout << "Aircraft Pool: " << scheduler.getAircraftPoolBytes() / 1024 << " KB reserved" << endl;
+         cout << "AVN Events: " << delivered << " (" << fixed << setprecision(0)
+              << delivered / max(runSeconds, 1e-9) << " msgs/sec during the run)" << endl;
+         cout << "Event Ring Throughput: " << fixed << setprecision(0)
+              << rawDelivered / max(rawSeconds, 1e-9) << " msgs/sec (" << rawDelivered << " records)" << endl;
+         cout << "Wall Time: " << fixed << setprecision(3) << runSeconds * 1e3 << " ms" << endl;
+         cout << "=====================================" << endl;
+     }
+     scheduler.printLatencyStats();
+     return 0;
+ }
+ 
+ void printUsage(const char* program) {
+     cout << "Usage: " << program << " [--headless] [--duration SECONDS] [--speed FACTOR] [--seed N] [--tick-threads N] [--quiet]" << endl;
+     cout << "       " << program << "   [--overrun catch-up|skip]" << endl;
+     cout << "       " << program << "   [--runways SPEC] [--runway-policy greedy|lookahead] [--rules PATH]" << endl;
+     cout << "       " << program << "   [--avn-retention N] [--completed-history N] [--completed-log PATH] [--ledger PATH] [--schedule PATH]" << endl;
+     cout << "       " << program << "   [--portal-listen ADDRESS]" << endl;
+     cout << "       " << program << " --headless [--record-trace PATH] | --replay PATH [--speed FACTOR] [--tick-threads N]" << endl;
+     cout << "       " << program << " --portal ADDRESS [--airline NAME]..." << endl;
+     cout << "       " << program << " --scenarios N [--threads N] [--duration SECONDS] [--seed N]" << endl;
+     cout << "       " << program << " --stress N [--duration SECONDS] [--seed N] [--runways SPEC] [--rules PATH]" << endl;
+     cout << "       " << program << " --bench N [--duration TICKS] [--emergency PCT] [--violations PCT] [--tick-threads N] [--seed N]" << endl;
+     cout << "  --headless          Run the simulation without menus and print final metrics" << endl;
+     cout << "  --duration SECONDS  Simulated seconds to run (default " << SIMULATION_TIME << ")" << endl;
+     cout << "  --speed FACTOR      Simulated seconds per wall second, 0 = unthrottled (default 0;" << endl;
+     cout << "                      the interactive run paces 0 as 1)" << endl;
+     cout << "  --overrun POLICY    Paced runs: catch-up (default) runs ticks missed after a slow one back" << endl;
+     cout << "                      to back, skip drops them" << endl;
+     cout << "  --seed N            Seed the random number generator for reproducible runs" << endl;
+     cout << "  --scenarios N       Run N seeded headless scenarios in parallel and aggregate them" << endl;
+     cout << "  --threads N         Worker threads for --scenarios (default: hardware threads)" << endl;
+     cout << "  --stress N          Step N aircraft through the structure-of-arrays fleet store" << endl;
+     cout << "  --quiet             Interactive simulation prints events only, no status screen" << endl;
+     cout << "  --tick-threads N    Threads that step flights and runway shards within a tick (default 1)" << endl;
+     cout << "  --bench N           Profile scheduler ticks with the fleet held at N aircraft" << endl;
+     cout << "  --runway-policy NAME  greedy (default) or lookahead, which weighs predicted runway free times;" << endl;
+     cout << "                      also applies to --scenarios and --bench" << endl;
+     cout << "  --runways SPEC      Runway layout, one group per runway: a = arrivals, d = departures," << endl;
+     cout << "                      c/e = cargo/emergency first (default " << DEFAULT_RUNWAY_TOPOLOGY << ")" << endl;
+     cout << "  --rules PATH        Rule set file of key = value lines (spawn intervals, emergency and" << endl;
+     cout << "                      violation odds, fines, speed limits) over the built-in rules" << endl;
+     cout << "  --emergency PCT     Emergency odds for every stream in --bench (default: per direction)" << endl;
+     cout << "  --violations PCT    Speed violation odds in --bench (default " << VIOLATION_PROBABILITY << ")" << endl;
+     cout << "  --avn-retention N   AVNs kept in memory per store, paid ones evicted first, 0 = all (default " << AVN_RETENTION << ")" << endl;
+     cout << "  --completed-history N  Completed-flight summaries kept in memory (default " << COMPLETED_HISTORY << ")" << endl;
+     cout << "  --completed-log PATH   Append every completed flight to PATH as CSV" << endl;
+     cout << "  --ledger PATH       Keep AVNs in a persistent ledger file, reopened on the next run" << endl;
+     cout << "  --schedule PATH     Fly the timetable in PATH (CSV: time,direction,airline,type[,flight])" << endl;
+     cout << "  --record-trace PATH Write every random outcome of a headless run to a trace file" << endl;
+     cout << "  --replay PATH       Re-run a recorded trace headless, without the RNG" << endl;
+     cout << "  --portal-listen ADDRESS  Serve Airline Portal clients on a Unix socket path or tcp:[HOST:]PORT" << endl;
+     cout << "  --portal ADDRESS    Run an Airline Portal connected to a simulation's --portal-listen address" << endl;
+     cout << "  --airline NAME      With --portal, show new-AVN notices for NAME only (repeatable)" << endl;
+ }
+ 
  // Main function
  // Fix the main function to properly manage simulation vs airline portal modes
 
-int main() {
+int main(int argc, char* argv[]) {
+    // Parse command line options
+    bool headless = false;
+    int duration = -1; // -1: the rule set's simulation_time
+    double speed = 0.0;
+    unsigned seed = random_device{}();
+    int scenarios = 0;
+    int stressFleet = 0;
+    int threads = max(1u, thread::hardware_concurrency());
+    int tickThreads = 1;
+    bool quiet = false;
+    int benchFleet = 0;
+    int emergencyPercent = -1;
+    int violationPercent = -1; // -1: the rule set's violation_percent
+    RetentionConfig retention;
+    string ledgerPath;
+    TraceConfig trace;
+    string schedulePath;
+    string portalListen;
+    string portalConnect;
+    vector<string> portalAirlines;
+    RunwayConfig runways;
+    RuleSet rules = DEFAULT_RULES;
+    OverrunPolicy overrunPolicy = OverrunPolicy::CATCH_UP;
+    
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--duration" && i + 1 < argc) {
+            duration = atoi(argv[++i]);
+        } else if (arg == "--speed" && i + 1 < argc) {
+            speed = atof(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--scenarios" && i + 1 < argc) {
+            scenarios = atoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (arg == "--stress" && i + 1 < argc) {
+            stressFleet = atoi(argv[++i]);
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else if (arg == "--tick-threads" && i + 1 < argc) {
+            tickThreads = atoi(argv[++i]);
+        } else if (arg == "--bench" && i + 1 < argc) {
+            benchFleet = atoi(argv[++i]);
+        } else if (arg == "--emergency" && i + 1 < argc) {
+            emergencyPercent = atoi(argv[++i]);
+        } else if (arg == "--violations" && i + 1 < argc) {
+            violationPercent = atoi(argv[++i]);
+        } else if (arg == "--avn-retention" && i + 1 < argc) {
+            retention.avnLimit = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--completed-history" && i + 1 < argc) {
+            retention.completedHistory = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--completed-log" && i + 1 < argc) {
+            retention.completedLog = argv[++i];
+        } else if (arg == "--ledger" && i + 1 < argc) {
+            ledgerPath = argv[++i];
+        } else if (arg == "--schedule" && i + 1 < argc) {
+            schedulePath = argv[++i];
+        } else if (arg == "--record-trace" && i + 1 < argc) {
+            trace.recordPath = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            trace.replayPath = argv[++i];
+            headless = true;
+        } else if (arg == "--portal-listen" && i + 1 < argc) {
+            portalListen = argv[++i];
+        } else if (arg == "--portal" && i + 1 < argc) {
+            portalConnect = argv[++i];
+        } else if (arg == "--airline" && i + 1 < argc) {
+            portalAirlines.push_back(argv[++i]);
+        } else if (arg == "--runway-policy" && i + 1 < argc) {
+            string name = argv[++i];
+            if (name != "greedy" && name != "lookahead") {
+                cerr << "Unknown runway policy " << name << " (expected greedy or lookahead)" << endl;
+                return 1;
+            }
+            runways.policy = (name == "lookahead") ? RunwayPolicy::LOOKAHEAD : RunwayPolicy::GREEDY;
+        } else if (arg == "--runways" && i + 1 < argc) {
+            if (!runways.topology.parse(argv[++i])) {
+                return 1;
+            }
+        } else if (arg == "--overrun" && i + 1 < argc) {
+            string name = argv[++i];
+            if (name != "catch-up" && name != "skip") {
+                cerr << "Unknown overrun policy " << name << " (expected catch-up or skip)" << endl;
+                return 1;
+            }
+            overrunPolicy = (name == "skip") ? OverrunPolicy::SKIP : OverrunPolicy::CATCH_UP;
+        } else if (arg == "--rules" && i + 1 < argc) {
+            if (!loadRuleSet(argv[++i], rules)) {
+                return 1;
+            }
+        } else {
+            printUsage(argv[0]);
+            return (arg == "--help" || arg == "-h") ? 0 : 1;
+        }
+    }
+    
+    if (duration < 0) {
+        duration = rules.simulationTime;
+    }
+    if (violationPercent < 0) {
+        violationPercent = rules.violationPercent;
+    }
+    
+    if (!portalConnect.empty()) {
+        return runPortalClient(portalConnect, portalAirlines);
+    }
+    
+    if (stressFleet > 0) {
+        return runStress(stressFleet, duration, seed, runways, rules);
+    }
+    
+    if (benchFleet > 0) {
+        return runBench({benchFleet, duration, seed, tickThreads, emergencyPercent, violationPercent, runways, rules});
+    }
+    
+    if (scenarios > 0) {
+        ScenarioRunner runner(scenarios, threads, duration, seed, runways, rules);
+        runner.run();
+        runner.printReport();
+        return 0;
+    }
+    
+    if (headless) {
+        return runHeadless(duration, speed, seed, tickThreads, retention, trace, schedulePath, runways, rules, overrunPolicy);
+    }
+    
+    // Timetable for the ATC, opened before the forks so a bad file stops the run
+    ScheduleLoader schedule;
+    if (!openSchedule(schedule, schedulePath)) {
+        return 1;
+    }
+    
+    // Portal clients' socket, also opened before the forks
+    int portalListener = -1;
+    if (!portalListen.empty() && (portalListener = openPortalListener(portalListen)) < 0) {
+        return 1;
+    }
+    
+    // ATC -> AVN Generator event ring, shared across fork()
+    AVNEventRing avnRing;
+    if (!avnRing.valid()) {
+        cerr << "AVN event ring setup failed!" << endl;
+        return 1;
+    }
+    
+    // AVN ledger, written by the AVN Generator and read by the rest
+    AVNLedger ledger;
+    if (!(ledgerPath.empty() ? ledger.openAnonymous() : ledger.open(ledgerPath))) {
+        cerr << "AVN ledger setup failed!" << endl;
+        return 1;
+    }
+    
     // Create pipes for IPC
-    int atcToAvn[2]; // ATC -> AVN Generator
     int avnToAirline[2]; // AVN Generator -> Airline Portal
     int airlineToAvn[2]; // Airline Portal -> AVN Generator
     int airlineToStripe[2]; // Airline Portal -> StripePay
     int stripeToAvn[2]; // StripePay -> AVN Generator
+    int avnToStripe[2]; // AVN Generator -> StripePay, payments from portal clients
 
-    if (pipe(atcToAvn) == -1 || pipe(avnToAirline) == -1 || pipe(airlineToAvn) == -1 ||
-        pipe(airlineToStripe) == -1 || pipe(stripeToAvn) == -1) {
+    if (pipe(avnToAirline) == -1 || pipe(airlineToAvn) == -1 ||
+        pipe(airlineToStripe) == -1 || pipe(stripeToAvn) == -1 || pipe(avnToStripe) == -1) {
         cerr << "Pipe creation failed!" << endl;
         return 1;
     }
@@ -1968,15 +8240,21 @@ int main() {
     pid_t avnPid = fork();
     if (avnPid == 0) {
         // Child process: AVN Generator
-        close(atcToAvn[1]);
         close(avnToAirline[0]);
         close(airlineToAvn[1]);
         close(airlineToStripe[0]);
         close(airlineToStripe[1]);
-        close(stripeToAvn[0]);
         close(stripeToAvn[1]);
+        close(avnToStripe[0]);
 
-        AVNGenerator avnGenerator(atcToAvn[0], avnToAirline[1]);
+        // The Airline Portal may not be attached; a closed pipe must not kill the generator
+        signal(SIGPIPE, SIG_IGN);
+        
+        AVNGenerator avnGenerator(avnRing, ledger, avnToAirline[1], airlineToAvn[0], stripeToAvn[0], avnToStripe[1]);
+        avnGenerator.setRules(rules);
+        if (portalListener >= 0) {
+            avnGenerator.serve(portalListener);
+        }
         avnGenerator.run();
         exit(0);
     } else if (avnPid < 0) {
@@ -1988,16 +8266,19 @@ int main() {
     pid_t stripePid = fork();
     if (stripePid == 0) {
         // Child process: StripePay
-        close(atcToAvn[0]);
-        close(atcToAvn[1]);
         close(avnToAirline[0]);
         close(avnToAirline[1]);
         close(airlineToAvn[0]);
         close(airlineToAvn[1]);
         close(airlineToStripe[1]);
         close(stripeToAvn[0]);
+        close(avnToStripe[1]);
+        if (portalListener >= 0) {
+            close(portalListener);
+        }
 
-        StripePay stripePay(airlineToStripe[0], stripeToAvn[1]);
+        ledger.makeReadOnly();
+        StripePay stripePay(airlineToStripe[0], stripeToAvn[1], avnToStripe[0]);
         stripePay.run();
         exit(0);
     } else if (stripePid < 0) {
@@ -2013,16 +8294,32 @@ int main() {
     close(airlineToStripe[0]);
     close(stripeToAvn[0]);
     close(stripeToAvn[1]);
+    close(avnToStripe[0]);
+    close(avnToStripe[1]);
+    if (portalListener >= 0) {
+        close(portalListener);
+    }
     
     // We'll fork a separate process for Airline Portal if needed
     pid_t airlinePid = -1;
 
     // Create FlightScheduler
-    FlightScheduler scheduler(atcToAvn[1]);
+    ledger.makeReadOnly();
+    FlightScheduler scheduler(&avnRing, seed);
+    scheduler.attachLedger(&ledger);
+    if (!schedulePath.empty()) {
+        scheduler.attachSchedule(&schedule);
+    }
+    scheduler.setTickThreads(tickThreads);
+    scheduler.configureRunways(runways);
+    scheduler.setRules(rules);
+    if (!scheduler.setRetention(retention)) {
+        cerr << "Continuing without the completed-flight log." << endl;
+    }
     
     // Current simulation time
     int simulationTime = 0;
-    const int MAX_SIMULATION_TIME = SIMULATION_TIME;
+    const int MAX_SIMULATION_TIME = rules.simulationTime;
     
     bool continueProgram = true;
     
@@ -2035,7 +8332,8 @@ int main() {
         cout << "║ 1. Run Air Traffic Simulation        ║" << endl;
         cout << "║ 2. View & Pay AVNs                   ║" << endl;
         cout << "║ 3. View Airline Violations           ║" << endl;
-        cout << "║ 4. Exit                              ║" << endl;
+        cout << "║ 4. Latency Statistics                ║" << endl;
+        cout << "║ 5. Exit                              ║" << endl;
         cout << "╚══════════════════════════════════════╝" << endl;
         cout << "Select an option: ";
         
@@ -2050,54 +8348,53 @@ int main() {
                 cout << "Press 'q' at any time to return to the main menu." << endl;
                 sleep(1);
                 
-                // Non-blocking input setup
-                struct termios oldSettings, newSettings;
-                tcgetattr(STDIN_FILENO, &oldSettings);
-                newSettings = oldSettings;
-                newSettings.c_lflag &= ~(ICANON | ECHO);
-                tcsetattr(STDIN_FILENO, TCSANOW, &newSettings);
+                // Keys are read on their own thread; ticks follow the clock's deadlines
+                KeyboardReader keyboard;
+                TickClock tickClock(speed > 0 ? speed : 1.0, overrunPolicy);
                 
-                fd_set readfds;
-                struct timeval tv;
-                bool simulationRunning = true;
+                // The renderer thread owns the console until the loop ends
+                ConsoleRenderer renderer(RENDER_FPS, quiet);
+                scheduler.setRenderer(&renderer);
                 
                 // Run the simulation loop
-                while (simulationRunning && simulationTime < MAX_SIMULATION_TIME) {
+                while (!keyboard.quitRequested() && simulationTime < MAX_SIMULATION_TIME) {
+                    tickClock.waitNextTick();
+                    if (keyboard.quitRequested()) {
+                        break;
+                    }
+                    
                     // Update simulation
                     scheduler.updateSimulation();
+                    ++simulationTime;
                     
-                    // Display status
+                    // Display status: hand over a snapshot when the next frame wants one
                     //system("clear");
-                    scheduler.printStatus();
-                    cout << "\nSimulation Time: " << ++simulationTime << "/" << MAX_SIMULATION_TIME << " seconds" << endl;
-                    cout << "Press 'q' to return to the main menu." << endl;
-                    
-                    // Check for user input (non-blocking)
-                    FD_ZERO(&readfds);
-                    FD_SET(STDIN_FILENO, &readfds);
-                    tv.tv_sec = 0;
-                    tv.tv_usec = 0;
-                    
-                    if (select(STDIN_FILENO + 1, &readfds, NULL, NULL, &tv)) {
-                        char c = getchar();
-                        if (c == 'q' || c == 'Q') {
-                            simulationRunning = false;
-                        }
+                    if (renderer.wantsSnapshot()) {
+                        unique_ptr<StatusSnapshot> snapshot = scheduler.captureStatus();
+                        snapshot->footer = "\nSimulation Time: " + to_string(simulationTime) + "/" +
+                                           to_string(MAX_SIMULATION_TIME) + " seconds" +
+                                           "  Tick Overruns: " + to_string(tickClock.getOverruns()) + "\n" +
+                                           "Press 'q' to return to the main menu.";
+                        renderer.postSnapshot(move(snapshot));
                     }
-                    
-                    // Simulate 1 second passing
-                    sleep(1);
                 }
                 
+                renderer.stop();
+                scheduler.setRenderer(nullptr);
+                
                 // Restore terminal settings
-                tcsetattr(STDIN_FILENO, TCSANOW, &oldSettings);
+                keyboard.stop();
+                {
+                    lock_guard<mutex> lock(cout_mutex);
+                    tickClock.printStats();
+                }
                 
                 if (simulationTime >= MAX_SIMULATION_TIME) {
                     cout << "\nSimulation completed!" << endl;
-                    cout << "Press Enter to return to the main menu...";
-                    cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-                    cin.get();
                 }
+                cout << "Press Enter to return to the main menu...";
+                cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                cin.get();
                 break;
             }
             
@@ -2108,6 +8405,7 @@ int main() {
                 bool avnMenuActive = true;
                 
                 while (avnMenuActive) {
+                    scheduler.syncLedgerPayments();
                     system("clear");
                     cout << "╔══════════════════════════════════════╗" << endl;
                     cout << "║          AVN MANAGEMENT              ║" << endl;
@@ -2127,24 +8425,7 @@ int main() {
                         case 1: {
                             system("clear");
                             cout << "\n--- ACTIVE AVNs ---" << endl;
-                            const auto& allAVNs = scheduler.getAllAVNs();
-                            if (allAVNs.empty()) {
-                                cout << "No AVNs issued yet." << endl;
-                            } else {
-                                bool hasUnpaidAVNs = false;
-                                for (const auto& avn : allAVNs) {
-                                    if (avn->status == PaymentStatus::UNPAID) {
-                                        cout << "AVN #" << avn->id << " | " << avn->airline << " flight " << avn->flightNumber 
-                                            << " | Speed: " << avn->recordedSpeed << " km/h"
-                                            << " | Amount: PKR " << fixed << setprecision(2) << avn->totalAmount << endl;
-                                        hasUnpaidAVNs = true;
-                                    }
-                                }
-                                
-                                if (!hasUnpaidAVNs) {
-                                    cout << "All AVNs have been paid." << endl;
-                                }
-                            }
+                            scheduler.printUnpaidAVNs();
                             cout << "\nPress Enter to continue...";
                             cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
                             cin.get();
@@ -2185,45 +8466,34 @@ int main() {
                             cin >> avnId;
                             
                             // First, check if the AVN exists and get its required amount
-                            const auto& allAVNs = scheduler.getAllAVNs();
-                            bool avnFound = false;
-                            
-                            for (const auto& avn : allAVNs) {
-                                if (avn->id == avnId) {
-                                    avnFound = true;
-                                    
-                                    // Check if already paid
-                                    if (avn->status == PaymentStatus::PAID) {
-                                        system("clear");
-                                        cout << "AVN #" << avnId << " has already been paid.\n";
-                                        break;
-                                    }
-                                    
-                                    // Display the AVN information before payment
-                                    system("clear");
-                                    cout << "=== AVN Payment ===\n";
-                                    cout << "AVN #" << avn->id << " | " << avn->airline << " flight " << avn->flightNumber << "\n";
-                                    cout << "Required amount: PKR " << fixed << setprecision(2) << avn->totalAmount << "\n\n";
-                                    
-                                    // Ask for confirmation
-                                    char confirm;
-                                    cout << "Do you want to pay this amount? (y/n): ";
-                                    cin >> confirm;
-                                    
-                                    if (confirm == 'y' || confirm == 'Y') {
-                                        // Process the payment with exact required amount
-                                        scheduler.processAVNPayment(avnId, avn->totalAmount);
-                                        cout << "\nPayment successful!\n";
-                                    } else {
-                                        cout << "\nPayment cancelled.\n";
-                                    }
-                                    break;
-                                }
-                            }
+                            const AVN* avn = scheduler.getAVNIndex().find(avnId);
                             
-                            if (!avnFound) {
+                            if (!avn) {
                                 system("clear");
                                 cout << "AVN #" << avnId << " not found.\n";
+                            } else if (avn->status == PaymentStatus::PAID) {
+                                // Check if already paid
+                                system("clear");
+                                cout << "AVN #" << avnId << " has already been paid.\n";
+                            } else {
+                                // Display the AVN information before payment
+                                system("clear");
+                                cout << "=== AVN Payment ===\n";
+                                cout << "AVN #" << avn->id << " | " << avn->airline << " flight " << avn->flightNumber << "\n";
+                                cout << "Required amount: PKR " << fixed << setprecision(2) << avn->totalAmount << "\n\n";
+                                
+                                // Ask for confirmation
+                                char confirm;
+                                cout << "Do you want to pay this amount? (y/n): ";
+                                cin >> confirm;
+                                
+                                if (confirm == 'y' || confirm == 'Y') {
+                                    // Process the payment with exact required amount
+                                    scheduler.processAVNPayment(avnId, avn->totalAmount);
+                                    cout << "\nPayment successful!\n";
+                                } else {
+                                    cout << "\nPayment cancelled.\n";
+                                }
                             }
                             
                             cout << "\nPress Enter to continue...";
@@ -2314,7 +8584,23 @@ int main() {
                 break;
             }
             
-            case 4:
+            case 4: {
+                // Each process prints its own histograms
+                system("clear");
+                scheduler.printLatencyStats();
+                scheduler.requestGeneratorStats();
+                FrameWriter statsRequest;
+                statsRequest.emptyFrame(MessageType::STATS_DUMP, 0);
+                statsRequest.flush(airlineToStripe[1]);
+                usleep(200000); // Give the children time to print before the prompt
+                
+                cout << "\nPress Enter to continue...";
+                cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                cin.get();
+                break;
+            }
+            
+            case 5:
                 continueProgram = false;
                 cout << "\nExiting AirControlX System. Goodbye!" << endl;
                 break;
@@ -2327,6 +8613,7 @@ int main() {
     }
     
     // Clean up and wait for child processes
+    avnRing.close();
     if (avnPid > 0) {
         kill(avnPid, SIGTERM);
         waitpid(avnPid, nullptr, 0);
@@ -2341,6 +8628,7 @@ int main() {
         kill(airlinePid, SIGTERM);
         waitpid(airlinePid, nullptr, 0);
     }
+    closePortalListener(portalListener, portalListen);
     
     return 0;
 }
\ No newline at end of file
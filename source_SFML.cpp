@@ -13,6 +13,7 @@
  #include <sstream>
  #include <memory>
  #include <algorithm>
+ #include <cmath>
  #include <ctime>
  #include <unistd.h> 
  #include <fcntl.h>
@@ -249,7 +250,9 @@
      chrono::system_clock::time_point scheduledTime;
      chrono::system_clock::time_point actualTime;
      Runway assignedRunway;
+     int queuedAt; //simulation time the flight joined a runway queue
      bool isEmergency;
+     int renderSlot; //graphics view slot while active, assigned by the scheduler; -1 otherwise
 
 std::set<string> violatedStates;
 bool maintainViolationSpeed = false;
@@ -261,7 +264,7 @@ int violationSpeed = 0;
          : id(nextId++), flightNumber(flightNumber), airline(airline), type(type),
            direction(direction), priority(priority), currentSpeed(0),
            hasActiveViolation(false), scheduledTime(scheduledTime),
-           assignedRunway(Runway::NONE), isEmergency(false) {}
+           assignedRunway(Runway::NONE), queuedAt(0), isEmergency(false), renderSlot(-1) {}
      
      virtual ~Aircraft() {}
      
@@ -269,6 +272,8 @@ int violationSpeed = 0;
      virtual void checkViolation() = 0;
      virtual string getStateString() const = 0;
      virtual bool isCompleted() const = 0;
+     virtual bool isArrival() const = 0;
+     virtual int getStateIndex() const = 0; //ArrivalState or DepartureState as an int
      
      string getRunwayString() const {
          switch (assignedRunway) {
@@ -542,17 +547,20 @@ void checkViolation() override {
         
 
         violatedStates.insert(currentStateStr);
-        
-        lock_guard<mutex> lock(cout_mutex);
-        cout << "\nVIOLATION DETECTED! Flight " << flightNumber 
-             << " (" << airline << ") - Speed: " << currentSpeed 
-             << " km/h in " << getStateString() << " state.\n";
     }
 }
      
      bool isCompleted() const override {
          return state == ArrivalState::AT_GATE;
      }
+     
+     bool isArrival() const override {
+         return true;
+     }
+     
+     int getStateIndex() const override {
+         return static_cast<int>(state);
+     }
  };
  
  class DepartureFlight : public Aircraft {
@@ -793,17 +801,97 @@ void checkViolation() override {
         );
         
         violatedStates.insert(currentStateStr);
-        
-        lock_guard<mutex> lock(cout_mutex);
-        cout << "\nVIOLATION DETECTED! Flight " << flightNumber 
-             << " (" << airline << ") - Speed: " << currentSpeed 
-             << " km/h in " << getStateString() << " state.\n";
     }
 }
      
      bool isCompleted() const override {
          return state == DepartureState::CRUISE;
      }
+     
+     bool isArrival() const override {
+         return false;
+     }
+     
+     int getStateIndex() const override {
+         return static_cast<int>(state);
+     }
+ };
+ 
+ // Lock-free triple buffer: the writer fills its back buffer and swaps it into
+ // the middle slot, the reader swaps the middle slot for its front buffer when
+ // a newer one is waiting. Neither side ever blocks or sees a buffer the other
+ // is using, and the three buffers are reused, so publishing stops allocating
+ // once their vectors have grown.
+ template <typename T>
+ class TripleBuffer {
+ private:
+     static constexpr uint8_t INDEX_MASK = 3;
+     static constexpr uint8_t FRESH = 4; // The middle slot holds an unread publish
+     
+     T buffers[3];
+     atomic<uint8_t> middle;
+     uint8_t back;  // Writer only
+     uint8_t front; // Reader only
+     
+ public:
+     TripleBuffer() : middle(1), back(0), front(2) {}
+     
+     TripleBuffer(const TripleBuffer&) = delete;
+     TripleBuffer& operator=(const TripleBuffer&) = delete;
+     
+     // Writer: the buffer to fill before publish()
+     T& writeBuffer() {
+         return buffers[back];
+     }
+     
+     void publish() {
+         back = middle.exchange(back | FRESH, memory_order_acq_rel) & INDEX_MASK;
+     }
+     
+     // Reader: the newest published buffer, valid until the next call
+     const T& latest() {
+         if (middle.load(memory_order_acquire) & FRESH) {
+             front = middle.exchange(front, memory_order_acq_rel) & INDEX_MASK;
+         }
+         return buffers[front];
+     }
+ };
+ 
+ // One aircraft as the graphics view draws it, copied out of the live flight
+ struct AircraftView {
+     int id;
+     int slot; //stable for as long as the aircraft is active, reused after it completes
+     Runway runway;
+     Direction direction;
+     FlightType type;
+     bool arrival;
+     bool emergency;
+     int state; // ArrivalState or DepartureState as an int
+     char flightNumber[16];
+ };
+ 
+ struct RunwayView {
+     bool occupied;
+     size_t queued;
+     char flightNumber[16];
+     char airline[32];
+ };
+ 
+ // Immutable once published: what one frame needs for one simulated second,
+ // so the UI thread never reads the scheduler while it ticks
+ struct RenderSnapshot {
+     static constexpr size_t SUMMARIES = 3; // Flights with their full summary line
+     
+     int tick = 0;
+     vector<AircraftView> aircraft;
+     vector<string> summaries;
+     RunwayView runways[3] = {};
+     size_t renderSlots = 0; //every AircraftView::slot is below this
+     size_t completedFlights = 0;
+     size_t avnsIssued = 0;
+     size_t avnsUnpaid = 0;
+     size_t activeViolations = 0;
+     string firstViolation; // Panel text for the first flight with an active violation
  };
  
  class FlightScheduler {
@@ -813,6 +901,10 @@ void checkViolation() override {
      vector<shared_ptr<Aircraft>> completedFlights;
      map<string, shared_ptr<Airline>> airlines;
      vector<shared_ptr<AVN>> allAVNs;
+     size_t unpaidAVNs; //allAVNs still UNPAID
+     
+     vector<int> freeRenderSlots; //slots of completed flights, handed to new ones first
+     int renderSlotCount;
  
      int currentSimulationTime;
      int lastNorthArrival;
@@ -847,18 +939,48 @@ void checkViolation() override {
      shared_ptr<Aircraft> runwayBOccupant;
      shared_ptr<Aircraft> runwayCOccupant;
      
+     TripleBuffer<RenderSnapshot> renderSnapshots; // Simulation thread -> graphics view
+     
      int runwayAFreeTime;
      int runwayBFreeTime;
      int runwayCFreeTime;
      
-     int avnWritePipe; //pipe to communicate with avn generator
+     int avnWritePipe; //pipe to communicate with avn generator, -1 when headless
+     bool verbose; //print per-event log lines to the console
+     
+     int runwayABusyTime;
+     int runwayBBusyTime;
+     int runwayCBusyTime;
+     long long totalQueueWait;
+     int maxQueueWait;
+     int runwayAssignments;
+     
+     //new flights go live with a render slot, so the graphics view indexes its vertex arrays directly
+     void activateFlight(const shared_ptr<Aircraft>& flight) {
+         if (!freeRenderSlots.empty()) {
+             flight->renderSlot = freeRenderSlots.back();
+             freeRenderSlots.pop_back();
+         } else {
+             flight->renderSlot = renderSlotCount++;
+         }
+         activeFlights.push_back(flight);
+     }
+     
+     void recordQueueWait(const shared_ptr<Aircraft>& aircraft) {
+         int wait = currentSimulationTime - aircraft->queuedAt;
+         totalQueueWait += wait;
+         maxQueueWait = max(maxQueueWait, wait);
+         runwayAssignments++;
+     }
      
  public:
-     FlightScheduler(int avnPipe) : currentSimulationTime(0), 
+     FlightScheduler(int avnPipe) : unpaidAVNs(0), renderSlotCount(0), currentSimulationTime(0), 
      lastNorthArrival(0), lastSouthArrival(0),
      lastEastDeparture(0), lastWestDeparture(0),
      runwayAFreeTime(0), runwayBFreeTime(0), runwayCFreeTime(0),
-     avnWritePipe(avnPipe),
+     avnWritePipe(avnPipe), verbose(true),
+     runwayABusyTime(0), runwayBBusyTime(0), runwayCBusyTime(0),
+     totalQueueWait(0), maxQueueWait(0), runwayAssignments(0),
      runwayAAvailable(true), runwayBAvailable(true), runwayCAvailable(true) {
      // Initialize airlines
      airlines["PIA"] = make_shared<Airline>("PIA", 6, 4);
@@ -876,6 +998,10 @@ void checkViolation() override {
          
          assignRunways();
          
+         if (runwayAOccupant) runwayABusyTime++;
+         if (runwayBOccupant) runwayBBusyTime++;
+         if (runwayCOccupant) runwayCBusyTime++;
+         
          updateFlights();
          
          moveCompletedFlights();
@@ -885,6 +1011,70 @@ void checkViolation() override {
          return currentSimulationTime;
      }
      
+     // Copy what the graphics view draws into the snapshot buffer and hand it
+     // over. Call from the thread that runs updateSimulation().
+     void publishRenderSnapshot(int tick) {
+         RenderSnapshot& snapshot = renderSnapshots.writeBuffer();
+         snapshot.tick = tick;
+         snapshot.aircraft.resize(activeFlights.size());
+         snapshot.summaries.resize(min(activeFlights.size(), RenderSnapshot::SUMMARIES));
+         snapshot.activeViolations = 0;
+         snapshot.firstViolation.clear();
+         for (size_t i = 0; i < activeFlights.size(); i++) {
+             const Aircraft& flight = *activeFlights[i];
+             AircraftView& view = snapshot.aircraft[i];
+             view.id = flight.id;
+             view.slot = flight.renderSlot;
+             view.runway = flight.assignedRunway;
+             view.direction = flight.direction;
+             view.type = flight.type;
+             view.arrival = flight.isArrival();
+             view.emergency = flight.isEmergency;
+             view.state = flight.getStateIndex();
+             snprintf(view.flightNumber, sizeof(view.flightNumber), "%s", flight.flightNumber.c_str());
+             if (i < snapshot.summaries.size()) {
+                 snapshot.summaries[i] = flight.getSummary();
+             }
+             if (flight.hasActiveViolation && flight.currentViolation) {
+                 if (snapshot.activeViolations++ == 0) {
+                     stringstream ss;
+                     ss << "Flight " << flight.flightNumber << " (" << flight.airline << ")\n"
+                        << "Speed: " << flight.currentSpeed << " km/h\n"
+                        << "State: " << flight.getStateString() << "\n"
+                        << "AVN ID: " << flight.currentViolation->id << "\n"
+                        << "Fine: PKR " << fixed << setprecision(2) << flight.currentViolation->totalAmount << "\n\n";
+                     snapshot.firstViolation = ss.str();
+                 }
+             }
+         }
+         
+         const shared_ptr<Aircraft>* occupants[3] = {&runwayAOccupant, &runwayBOccupant, &runwayCOccupant};
+         size_t queued[3] = {runwayAQueue.size(), runwayBQueue.size(), runwayCQueue.size()};
+         for (int r = 0; r < 3; r++) {
+             RunwayView& runway = snapshot.runways[r];
+             const shared_ptr<Aircraft>& occupant = *occupants[r];
+             runway.occupied = (occupant != nullptr);
+             runway.queued = queued[r];
+             snprintf(runway.flightNumber, sizeof(runway.flightNumber), "%s", occupant ? occupant->flightNumber.c_str() : "");
+             snprintf(runway.airline, sizeof(runway.airline), "%s", occupant ? occupant->airline.c_str() : "");
+         }
+         
+         snapshot.renderSlots = renderSlotCount;
+         snapshot.completedFlights = completedFlights.size();
+         snapshot.avnsIssued = allAVNs.size();
+         snapshot.avnsUnpaid = unpaidAVNs;
+         renderSnapshots.publish();
+     }
+     
+     // Newest published snapshot. Call from the graphics (UI) thread only.
+     const RenderSnapshot& latestRenderSnapshot() {
+         return renderSnapshots.latest();
+     }
+     
+     void setVerbose(bool enabled) {
+         verbose = enabled;
+     }
+     
      void generateFlights() {
          // North arrivals (every 3 minutes)
          if (currentSimulationTime - lastNorthArrival >= ARRIVAL_NORTH_INTERVAL || currentSimulationTime == 1) {
@@ -925,14 +1115,17 @@ void checkViolation() override {
                  chrono::system_clock::now()
              );
              flight->isEmergency = isEmergency;
+             flight->queuedAt = currentSimulationTime;
              
              allFlights.push_back(flight);
-             activeFlights.push_back(flight);
+             activateFlight(flight);
              
              runwayAQueue.push(flight);
              
-             lock_guard<mutex> lock(cout_mutex);
-             cout << "\nNew North Arrival: " << flight->getSummary() << endl;
+             if (verbose) {
+                 lock_guard<mutex> lock(cout_mutex);
+                 cout << "\nNew North Arrival: " << flight->getSummary() << endl;
+             }
          }
          
          // South arrivals (every 2 minutes)
@@ -972,14 +1165,17 @@ void checkViolation() override {
                  chrono::system_clock::now()
              );
              flight->isEmergency = isEmergency;
+             flight->queuedAt = currentSimulationTime;
              
              allFlights.push_back(flight);
-             activeFlights.push_back(flight);
+             activateFlight(flight);
              
              runwayAQueue.push(flight);
              
-             lock_guard<mutex> lock(cout_mutex);
-             cout << "\nNew South Arrival: " << flight->getSummary() << endl;
+             if (verbose) {
+                 lock_guard<mutex> lock(cout_mutex);
+                 cout << "\nNew South Arrival: " << flight->getSummary() << endl;
+             }
          }
          
          if (currentSimulationTime - lastEastDeparture >= DEPARTURE_EAST_INTERVAL || currentSimulationTime == 3) {
@@ -1018,14 +1214,17 @@ void checkViolation() override {
                  chrono::system_clock::now()
              );
              flight->isEmergency = isEmergency;
+             flight->queuedAt = currentSimulationTime;
              
              allFlights.push_back(flight);
-             activeFlights.push_back(flight);
+             activateFlight(flight);
              
              runwayBQueue.push(flight);
              
-             lock_guard<mutex> lock(cout_mutex);
-             cout << "\nNew East Departure: " << flight->getSummary() << endl;
+             if (verbose) {
+                 lock_guard<mutex> lock(cout_mutex);
+                 cout << "\nNew East Departure: " << flight->getSummary() << endl;
+             }
          }
          
          if (currentSimulationTime - lastWestDeparture >= DEPARTURE_WEST_INTERVAL || currentSimulationTime == 4) {
@@ -1064,14 +1263,17 @@ void checkViolation() override {
                  chrono::system_clock::now()
              );
              flight->isEmergency = isEmergency;
+             flight->queuedAt = currentSimulationTime;
              
              allFlights.push_back(flight);
-             activeFlights.push_back(flight);
+             activateFlight(flight);
              
              runwayBQueue.push(flight);
              
-             lock_guard<mutex> lock(cout_mutex);
-             cout << "\nNew West Departure: " << flight->getSummary() << endl;
+             if (verbose) {
+                 lock_guard<mutex> lock(cout_mutex);
+                 cout << "\nNew West Departure: " << flight->getSummary() << endl;
+             }
          }
      }
      
@@ -1097,9 +1299,12 @@ void checkViolation() override {
                      runwayCAvailable = false;
                      runwayCOccupant = aircraft;
                      aircraft->assignedRunway = Runway::RWY_C;
+                     recordQueueWait(aircraft);
                      assigned = true;
-                     lock_guard<mutex> coutLock(cout_mutex);
-                     cout << "Assigned RWY-C to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
+                     if (verbose) {
+                         lock_guard<mutex> coutLock(cout_mutex);
+                         cout << "Assigned RWY-C to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
+                     }
                  }
              }
      
@@ -1109,9 +1314,12 @@ void checkViolation() override {
                      runwayAAvailable = false;
                      runwayAOccupant = aircraft;
                      aircraft->assignedRunway = Runway::RWY_A;
+                     recordQueueWait(aircraft);
                      assigned = true;
-                     lock_guard<mutex> coutLock(cout_mutex);
-                     cout << "Assigned RWY-A to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
+                     if (verbose) {
+                         lock_guard<mutex> coutLock(cout_mutex);
+                         cout << "Assigned RWY-A to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
+                     }
                  }
              }
      
@@ -1121,9 +1329,12 @@ void checkViolation() override {
                      runwayCAvailable = false;
                      runwayCOccupant = aircraft;
                      aircraft->assignedRunway = Runway::RWY_C;
+                     recordQueueWait(aircraft);
                      assigned = true;
-                     lock_guard<mutex> coutLock(cout_mutex);
-                     cout << "Assigned RWY-C (fallback) to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
+                     if (verbose) {
+                         lock_guard<mutex> coutLock(cout_mutex);
+                         cout << "Assigned RWY-C (fallback) to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
+                     }
                  }
              }
      
@@ -1149,9 +1360,12 @@ void checkViolation() override {
                      runwayCAvailable = false;
                      runwayCOccupant = aircraft;
                      aircraft->assignedRunway = Runway::RWY_C;
+                     recordQueueWait(aircraft);
                      assigned = true;
-                     lock_guard<mutex> coutLock(cout_mutex);
-                     cout << "Assigned RWY-C to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
+                     if (verbose) {
+                         lock_guard<mutex> coutLock(cout_mutex);
+                         cout << "Assigned RWY-C to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
+                     }
                  }
              }
      
@@ -1161,9 +1375,12 @@ void checkViolation() override {
                      runwayBAvailable = false;
                      runwayBOccupant = aircraft;
                      aircraft->assignedRunway = Runway::RWY_B;
+                     recordQueueWait(aircraft);
                      assigned = true;
-                     lock_guard<mutex> coutLock(cout_mutex);
-                     cout << "Assigned RWY-B to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
+                     if (verbose) {
+                         lock_guard<mutex> coutLock(cout_mutex);
+                         cout << "Assigned RWY-B to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
+                     }
                  }
              }
      
@@ -1173,9 +1390,12 @@ void checkViolation() override {
                      runwayCAvailable = false;
                      runwayCOccupant = aircraft;
                      aircraft->assignedRunway = Runway::RWY_C;
+                     recordQueueWait(aircraft);
                      assigned = true;
-                     lock_guard<mutex> coutLock(cout_mutex);
-                     cout << "Assigned RWY-C (fallback) to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
+                     if (verbose) {
+                         lock_guard<mutex> coutLock(cout_mutex);
+                         cout << "Assigned RWY-C (fallback) to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
+                     }
                  }
              }
      
@@ -1201,9 +1421,12 @@ void checkViolation() override {
                  runwayCAvailable = false;
                  runwayCOccupant = aircraft;
                  aircraft->assignedRunway = Runway::RWY_C;
+                 recordQueueWait(aircraft);
                  assigned = true;
-                 lock_guard<mutex> coutLock(cout_mutex);
-                 cout << "Assigned RWY-C to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
+                 if (verbose) {
+                     lock_guard<mutex> coutLock(cout_mutex);
+                     cout << "Assigned RWY-C to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
+                 }
              }
      
              if (!assigned) {
@@ -1242,22 +1465,28 @@ void checkViolation() override {
                          runwayAAvailable = true;
                          runwayAOccupant = nullptr;
                          runwayAFreeTime = currentSimulationTime;
-                         lock_guard<mutex> coutLock(cout_mutex);
-                         cout << "Released RWY-A from " << flight->flightNumber << " (" << flight->airline << ")" << endl;
+                         if (verbose) {
+                             lock_guard<mutex> coutLock(cout_mutex);
+                             cout << "Released RWY-A from " << flight->flightNumber << " (" << flight->airline << ")" << endl;
+                         }
                      } else if (runway == Runway::RWY_B) {
                          lock_guard<mutex> lock(runwayBMutex);
                          runwayBAvailable = true;
                          runwayBOccupant = nullptr;
                          runwayBFreeTime = currentSimulationTime;
-                         lock_guard<mutex> coutLock(cout_mutex);
-                         cout << "Released RWY-B from " << flight->flightNumber << " (" << flight->airline << ")" << endl;
+                         if (verbose) {
+                             lock_guard<mutex> coutLock(cout_mutex);
+                             cout << "Released RWY-B from " << flight->flightNumber << " (" << flight->airline << ")" << endl;
+                         }
                      } else if (runway == Runway::RWY_C) {
                          lock_guard<mutex> lock(runwayCMutex);
                          runwayCAvailable = true;
                          runwayCOccupant = nullptr;
                          runwayCFreeTime = currentSimulationTime;
-                         lock_guard<mutex> coutLock(cout_mutex);
-                         cout << "Released RWY-C from " << flight->flightNumber << " (" << flight->airline << ")" << endl;
+                         if (verbose) {
+                             lock_guard<mutex> coutLock(cout_mutex);
+                             cout << "Released RWY-C from " << flight->flightNumber << " (" << flight->airline << ")" << endl;
+                         }
                      }
                  }
              }
@@ -1269,11 +1498,19 @@ void checkViolation() override {
              flight->updateStatus(currentSimulationTime);
              
              if (flight->hasActiveViolation && flight->currentViolation) {
+                 if (verbose) {
+                     lock_guard<mutex> lock(cout_mutex);
+                     cout << "\nVIOLATION DETECTED! Flight " << flight->flightNumber 
+                          << " (" << flight->airline << ") - Speed: " << flight->currentSpeed 
+                          << " km/h in " << flight->getStateString() << " state.\n";
+                 }
+                 
                  auto airlineIt = airlines.find(flight->airline);
                  if (airlineIt != airlines.end()) {
                      airlineIt->second->addViolation(flight->currentViolation);
                      
                      allAVNs.push_back(flight->currentViolation);
+                     unpaidAVNs++;
                      
                      IPCMessage message;
                      message.type = MessageType::AVN_CREATED;
@@ -1288,7 +1525,9 @@ void checkViolation() override {
                      strncpy(message.details, (flight->type == FlightType::COMMERCIAL) ? "COMMERCIAL" : "CARGO", sizeof(message.details) - 1);
                      message.details[sizeof(message.details) - 1] = '\0';
                      
-                     write(avnWritePipe, &message, sizeof(message));
+                     if (avnWritePipe >= 0) {
+                         write(avnWritePipe, &message, sizeof(message));
+                     }
                      
                      flight->hasActiveViolation = false;
                      flight->currentViolation.reset();
@@ -1303,10 +1542,14 @@ void checkViolation() override {
          for (auto& flight : activeFlights) {
              if (flight->isCompleted()) {
                  completedFlights.push_back(flight);
+                 freeRenderSlots.push_back(flight->renderSlot);
+                 flight->renderSlot = -1;
                  
-                 lock_guard<mutex> lock(cout_mutex);
-                 cout << "\nFlight completed: " << flight->flightNumber 
-                      << " (" << flight->airline << ")" << endl;
+                 if (verbose) {
+                     lock_guard<mutex> lock(cout_mutex);
+                     cout << "\nFlight completed: " << flight->flightNumber 
+                          << " (" << flight->airline << ")" << endl;
+                 }
              } else {
                  stillActive.push_back(flight);
              }
@@ -1316,9 +1559,11 @@ void checkViolation() override {
      }
      
      void printStatus() {
-         lock_guard<mutex> lock(cout_mutex);
+         if (verbose) {
+             lock_guard<mutex> lock(cout_mutex);
          
-         cout << "\n======== AIRCONTROLX STATUS ========" << endl;
+             cout << "\n======== AIRCONTROLX STATUS ========" << endl;
+         }
          cout << "Simulation Time: " << currentSimulationTime << " seconds" << endl;
          cout << "Active Flights: " << activeFlights.size() << endl;
          cout << "Completed Flights: " << completedFlights.size() << endl;
@@ -1376,6 +1621,9 @@ void checkViolation() override {
          for (auto& avn : allAVNs) {
              if (avn->id == avnId) {
                  if (amount >= avn->totalAmount) {
+                     if (avn->status == PaymentStatus::UNPAID) {
+                         unpaidAVNs--;
+                     }
                      avn->status = PaymentStatus::PAID;
                      
                      lock_guard<mutex> lock(cout_mutex);
@@ -1424,6 +1672,31 @@ void checkViolation() override {
      }
      
      const std::vector<std::shared_ptr<Aircraft>>& getActiveFlights() const { return activeFlights; }
+     
+     void printSummary() const {
+         lock_guard<mutex> lock(cout_mutex);
+         double elapsed = max(1, currentSimulationTime);
+         
+         cout << "\n======== SIMULATION SUMMARY ========" << endl;
+         cout << "Simulated Time: " << currentSimulationTime << " seconds" << endl;
+         cout << "Flights Generated: " << allFlights.size() << endl;
+         cout << "Flights Completed: " << completedFlights.size() << endl;
+         cout << "Flights Still Active: " << activeFlights.size() << endl;
+         cout << "AVNs Issued: " << allAVNs.size() << endl;
+         
+         cout << "\n--- RUNWAY UTILISATION ---" << endl;
+         cout << "Runway A: " << fixed << setprecision(1) << (100.0 * runwayABusyTime / elapsed) << "%" << endl;
+         cout << "Runway B: " << fixed << setprecision(1) << (100.0 * runwayBBusyTime / elapsed) << "%" << endl;
+         cout << "Runway C: " << fixed << setprecision(1) << (100.0 * runwayCBusyTime / elapsed) << "%" << endl;
+         
+         cout << "\n--- QUEUE WAIT ---" << endl;
+         cout << "Runway Assignments: " << runwayAssignments << endl;
+         cout << "Average Wait: " << fixed << setprecision(2)
+              << (runwayAssignments ? static_cast<double>(totalQueueWait) / runwayAssignments : 0.0) << " seconds" << endl;
+         cout << "Maximum Wait: " << maxQueueWait << " seconds" << endl;
+         cout << "Still Queued: " << (runwayAQueue.size() + runwayBQueue.size() + runwayCQueue.size()) << endl;
+         cout << "=====================================" << endl;
+     }
  };
  
  class AVNGenerator {
@@ -1793,14 +2066,22 @@ void checkViolation() override {
  
  class AirportGraphics {
  private:
+     //one aircraft's slice of the vertex arrays; vertices are rebuilt only when key changes
+     struct AircraftSlot {
+         int aircraftId; //-1 when the slot is free
+         unsigned frameSeen;
+         int key; //runway, arrival/departure, state and colour packed together
+     };
+     
      sf::RenderWindow window;
      sf::Font font;
      bool graphicsEnabled;
      std::vector<sf::RectangleShape> runways;
      std::vector<sf::Text> runwayLabels;
-     sf::CircleShape aircraftShape;
-     std::map<std::string, sf::CircleShape> aircraftShapes;
-     std::map<std::string, sf::Text> aircraftLabels;
+     std::vector<AircraftSlot> slots; //indexed by AircraftView::slot
+     sf::VertexArray aircraftGlyphs; //AIRCRAFT_VERTICES per slot, one draw call for the fleet
+     sf::VertexArray labelGlyphs; //LABEL_VERTICES per slot, textured from the font's glyph atlas
+     unsigned frameCount;
      sf::Text timerText;
      sf::Text statusText;
      sf::Text runwayStatusText;
@@ -1808,6 +2089,7 @@ void checkViolation() override {
      sf::Text activeFlightsText;
      sf::Text avnStatusText;
      int simulationTime;
+     int panelTime; //simulated second the text panels were last built for
 
      static constexpr int WINDOW_WIDTH = 800;
      static constexpr int WINDOW_HEIGHT = 600;
@@ -1816,9 +2098,17 @@ void checkViolation() override {
      static constexpr float AIRCRAFT_RADIUS = 10.0f;
      static constexpr float RUNWAY_SPACING = 100.0f;
      static constexpr float LEFT_MARGIN = 200.0f;  // Space for text on the left
+     static constexpr int AIRCRAFT_SEGMENTS = 12; //triangles per aircraft circle
+     static constexpr size_t AIRCRAFT_VERTICES = AIRCRAFT_SEGMENTS * 3;
+     static constexpr unsigned LABEL_SIZE = 12;
+     static constexpr size_t LABEL_MAX_CHARS = 10;
+     static constexpr size_t LABEL_VERTICES = LABEL_MAX_CHARS * 6;
+     static constexpr int PANEL_FLIGHTS_LISTED = 3; //lines that fit in the active flights panel
+     static constexpr int PANEL_VIOLATIONS_LISTED = 1;
 
  public:
-     AirportGraphics() : graphicsEnabled(false), simulationTime(0) {
+     AirportGraphics() : graphicsEnabled(false), aircraftGlyphs(sf::Triangles), labelGlyphs(sf::Triangles),
+                         frameCount(0), simulationTime(0), panelTime(-1) {
          try {
              const char* display = getenv("DISPLAY");
              if (!display) {
@@ -1846,6 +2136,7 @@ void checkViolation() override {
                  return;
              }
              std::cout << "Font loaded successfully." << std::endl;
+             loadLabelGlyphs();
              initializeRunways();
              std::cout << "Runways initialized successfully." << std::endl;
              initializeTextElements();
@@ -1865,77 +2156,19 @@ void checkViolation() override {
              }
          }
      }
-     void update(const std::vector<std::shared_ptr<Aircraft>>& flights, int currentTime) {
+     //draw one frame from the newest snapshot; frames repeat the last one until the next tick is published
+     void update(const RenderSnapshot& snapshot) {
          if (!graphicsEnabled) {
              return;
          }
          try {
-             simulationTime = currentTime;
+             simulationTime = snapshot.tick;
              window.clear(sf::Color::White);
-             int minutes = simulationTime / 60;
-             int seconds = simulationTime % 60;
-             std::stringstream ss;
-             ss << "Time: " << std::setfill('0') << std::setw(2) << minutes << ":"
-                << std::setfill('0') << std::setw(2) << seconds;
-             timerText.setString(ss.str());
-             std::stringstream statusSS;
-             statusSS << "AIRCONTROLX STATUS\n\n"
-                     << "Active Flights: " << flights.size() << "\n"
-                     << "Completed Flights: 0\n";
-             statusText.setString(statusSS.str());
-             std::stringstream runwaySS;
-             runwaySS << "RUNWAY STATUS\n\n";
-             for (const auto& flight : flights) {
-                 if (flight->assignedRunway != Runway::NONE) {
-                     runwaySS << "Runway " << flight->getRunwayString() << ": "
-                             << flight->flightNumber << " (" << flight->airline << ")\n";
-                 }
-             }
-             runwayStatusText.setString(runwaySS.str());
-             std::stringstream queueSS;
-             queueSS << "QUEUE STATUS\n\n";
-             int runwayAQueueSize = 0;
-             int runwayBQueueSize = 0;
-             int runwayCQueueSize = 0;
-             for (const auto& flight : flights) {
-                 if (flight->assignedRunway == Runway::NONE) {
-                     if (flight->direction == Direction::NORTH || flight->direction == Direction::SOUTH) {
-                         runwayAQueueSize++;
-                     } else if (flight->direction == Direction::EAST || flight->direction == Direction::WEST) {
-                         runwayBQueueSize++;
-                     } else {
-                         runwayCQueueSize++;
-                     }
-                 }
-             }
-             queueSS << "Runway A Queue: " << runwayAQueueSize << " flights waiting\n"
-                    << "Runway B Queue: " << runwayBQueueSize << " flights waiting\n"
-                    << "Runway C Queue: " << runwayCQueueSize << " flights waiting\n";
-             queueStatusText.setString(queueSS.str());
-             std::stringstream flightsSS;
-             flightsSS << "ACTIVE FLIGHTS\n\n";
-             for (const auto& flight : flights) {
-                 flightsSS << flight->getSummary() << "\n";
-             }
-             activeFlightsText.setString(flightsSS.str());
-             std::stringstream avnSS;
-             avnSS << "ACTIVE VIOLATIONS\n\n";
-             bool hasViolations = false;
-             for (const auto& flight : flights) {
-                 if (flight->hasActiveViolation && flight->currentViolation) {
-                     hasViolations = true;
-                     avnSS << "Flight " << flight->flightNumber << " (" << flight->airline << ")\n"
-                           << "Speed: " << flight->currentSpeed << " km/h\n"
-                           << "State: " << flight->getStateString() << "\n"
-                           << "AVN ID: " << flight->currentViolation->id << "\n"
-                           << "Fine: PKR " << std::fixed << std::setprecision(2) 
-                           << flight->currentViolation->totalAmount << "\n\n";
-                 }
+             //the panels only change when the simulation does
+             if (simulationTime != panelTime) {
+                 updatePanels(snapshot);
+                 panelTime = simulationTime;
              }
-             if (!hasViolations) {
-                 avnSS << "No active violations.\n";
-             }
-             avnStatusText.setString(avnSS.str());
              window.draw(timerText);
              window.draw(statusText);
              window.draw(runwayStatusText);
@@ -1946,9 +2179,15 @@ void checkViolation() override {
                  window.draw(runways[i]);
                  window.draw(runwayLabels[i]);
              }
-             for (const auto& flight : flights) {
-                 updateAircraftPosition(flight);
+             //rebuild the slots whose aircraft changed, then draw the whole fleet in two calls
+             frameCount++;
+             reserveSlots(snapshot.renderSlots);
+             for (const AircraftView& aircraft : snapshot.aircraft) {
+                 updateAircraftSlot(aircraft);
              }
+             releaseUnseenSlots();
+             window.draw(aircraftGlyphs);
+             window.draw(labelGlyphs, sf::RenderStates(&font.getTexture(LABEL_SIZE)));
              window.display();
          } catch (const std::exception& e) {
              std::cerr << "Error updating graphics: " << e.what() << std::endl;
@@ -1978,6 +2217,59 @@ void checkViolation() override {
          }
      }
  private:
+     void updatePanels(const RenderSnapshot& snapshot) {
+         int minutes = simulationTime / 60;
+         int seconds = simulationTime % 60;
+         std::stringstream ss;
+         ss << "Time: " << std::setfill('0') << std::setw(2) << minutes << ":"
+            << std::setfill('0') << std::setw(2) << seconds;
+         timerText.setString(ss.str());
+         std::stringstream statusSS;
+         statusSS << "AIRCONTROLX STATUS\n\n"
+                 << "Active Flights: " << snapshot.aircraft.size() << "\n"
+                 << "Completed Flights: " << snapshot.completedFlights << "\n"
+                 << "AVNs: " << snapshot.avnsIssued << " (" << snapshot.avnsUnpaid << " unpaid)\n";
+         statusText.setString(statusSS.str());
+         static const char* RUNWAY_NAMES[3] = {"RWY-A", "RWY-B", "RWY-C"};
+         std::stringstream runwaySS;
+         runwaySS << "RUNWAY STATUS\n\n";
+         std::stringstream queueSS;
+         queueSS << "QUEUE STATUS\n\n";
+         for (int r = 0; r < 3; r++) {
+             const RunwayView& runway = snapshot.runways[r];
+             runwaySS << "Runway " << RUNWAY_NAMES[r] << ": ";
+             if (runway.occupied) {
+                 runwaySS << runway.flightNumber << " (" << runway.airline << ")\n";
+             } else {
+                 runwaySS << "Free\n";
+             }
+             queueSS << "Runway " << static_cast<char>('A' + r) << " Queue: " << runway.queued << " flights waiting\n";
+         }
+         runwayStatusText.setString(runwaySS.str());
+         queueStatusText.setString(queueSS.str());
+         //list only what fits in each panel
+         std::stringstream flightsSS;
+         flightsSS << "ACTIVE FLIGHTS\n\n";
+         size_t listed = std::min<size_t>(snapshot.summaries.size(), PANEL_FLIGHTS_LISTED);
+         for (size_t i = 0; i < listed; i++) {
+             flightsSS << snapshot.summaries[i] << "\n";
+         }
+         if (snapshot.aircraft.size() > listed) {
+             flightsSS << "... and " << snapshot.aircraft.size() - listed << " more\n";
+         }
+         activeFlightsText.setString(flightsSS.str());
+         std::stringstream avnSS;
+         avnSS << "ACTIVE VIOLATIONS\n\n";
+         if (snapshot.activeViolations == 0) {
+             avnSS << "No active violations.\n";
+         } else {
+             avnSS << snapshot.firstViolation;
+             if (snapshot.activeViolations > PANEL_VIOLATIONS_LISTED) {
+                 avnSS << "... and " << snapshot.activeViolations - PANEL_VIOLATIONS_LISTED << " more\n";
+             }
+         }
+         avnStatusText.setString(avnSS.str());
+     }
      void initializeTextElements() {
          timerText.setFont(font);
          timerText.setCharacterSize(24);
@@ -2004,6 +2296,14 @@ void checkViolation() override {
          avnStatusText.setFillColor(sf::Color::Red);
          avnStatusText.setPosition(10, 450);
      }
+     //render every character a flight number can use into the font's glyph atlas up front,
+     //so label texture coordinates are ready before the first frame
+     void loadLabelGlyphs() {
+         const std::string charset = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-";
+         for (char c : charset) {
+             font.getGlyph(static_cast<unsigned char>(c), LABEL_SIZE, false);
+         }
+     }
      void initializeRunways() {
          std::vector<std::string> runwayNames = {"RWY-A", "RWY-B", "RWY-C"};
          for (size_t i = 0; i < 3; ++i) {
@@ -2027,71 +2327,115 @@ void checkViolation() override {
              runwayLabels.push_back(label);
          }
      }
-     void updateAircraftPosition(const std::shared_ptr<Aircraft>& aircraft) {
-         std::string id = aircraft->flightNumber;
-         if (aircraftShapes.find(id) == aircraftShapes.end()) {
-             sf::CircleShape shape(AIRCRAFT_RADIUS);
-             shape.setFillColor(getAircraftColor(aircraft));
-             aircraftShapes[id] = shape;
-             sf::Text label;
-             label.setFont(font);
-             label.setString(id);
-             label.setCharacterSize(12);
-             label.setFillColor(sf::Color::Black);
-             aircraftLabels[id] = label;
-         }
+     //state key for an aircraft: whatever decides where and how it is drawn
+     static int aircraftKey(const AircraftView& aircraft) {
+         int colour = aircraft.emergency ? 2 : (aircraft.type == FlightType::CARGO ? 1 : 0);
+         return (static_cast<int>(aircraft.runway) << 8) | (aircraft.arrival << 7) |
+                (aircraft.state << 2) | colour;
+     }
+     sf::Vector2f aircraftPosition(const AircraftView& aircraft) const {
+         //offsets along the runway per state, indexed by ArrivalState / DepartureState
+         static const float ARRIVAL_OFFSETS[5] = {-100, 100, 300, 500, 600};
+         static const float DEPARTURE_OFFSETS[5] = {600, 500, 300, 100, -100};
          float x = (WINDOW_WIDTH - RUNWAY_LENGTH) / 2;
          float y = (WINDOW_HEIGHT - (3 * RUNWAY_SPACING)) / 2;
-         if (aircraft->assignedRunway != Runway::NONE) {
-             int runwayIndex = static_cast<int>(aircraft->assignedRunway);
+         if (aircraft.runway != Runway::NONE) {
+             int runwayIndex = static_cast<int>(aircraft.runway);
              y += (runwayIndex * RUNWAY_SPACING) + (RUNWAY_WIDTH / 2);
-             if (auto arrival = dynamic_pointer_cast<ArrivalFlight>(aircraft)) {
-                 switch (arrival->getState()) {
-                     case ArrivalState::HOLDING:
-                         x = (WINDOW_WIDTH - RUNWAY_LENGTH) / 2 - 100;
-                         break;
-                     case ArrivalState::APPROACH:
-                         x = (WINDOW_WIDTH - RUNWAY_LENGTH) / 2 + 100;
-                         break;
-                     case ArrivalState::LANDING:
-                         x = (WINDOW_WIDTH - RUNWAY_LENGTH) / 2 + 300;
-                         break;
-                     case ArrivalState::TAXI:
-                         x = (WINDOW_WIDTH - RUNWAY_LENGTH) / 2 + 500;
-                         break;
-                     case ArrivalState::AT_GATE:
-                         x = (WINDOW_WIDTH - RUNWAY_LENGTH) / 2 + 600;
-                         break;
-                 }
-             } else if (auto departure = dynamic_pointer_cast<DepartureFlight>(aircraft)) {
-                 switch (departure->getState()) {
-                     case DepartureState::AT_GATE:
-                         x = (WINDOW_WIDTH - RUNWAY_LENGTH) / 2 + 600;
-                         break;
-                     case DepartureState::TAXI:
-                         x = (WINDOW_WIDTH - RUNWAY_LENGTH) / 2 + 500;
-                         break;
-                     case DepartureState::TAKEOFF_ROLL:
-                         x = (WINDOW_WIDTH - RUNWAY_LENGTH) / 2 + 300;
-                         break;
-                     case DepartureState::CLIMB:
-                         x = (WINDOW_WIDTH - RUNWAY_LENGTH) / 2 + 100;
-                         break;
-                     case DepartureState::CRUISE:
-                         x = (WINDOW_WIDTH - RUNWAY_LENGTH) / 2 - 100;
-                         break;
-                 }
+             x += (aircraft.arrival ? ARRIVAL_OFFSETS : DEPARTURE_OFFSETS)[aircraft.state];
+         }
+         return sf::Vector2f(x, y);
+     }
+     void updateAircraftSlot(const AircraftView& aircraft) {
+         AircraftSlot& slot = slots[aircraft.slot];
+         if (slot.aircraftId != aircraft.id) {
+             //slot reused, possibly without a frame in between
+             slot.aircraftId = aircraft.id;
+             slot.key = -1;
+         }
+         slot.frameSeen = frameCount;
+         int key = aircraftKey(aircraft);
+         if (slot.key == key) {
+             return;
+         }
+         slot.key = key;
+         sf::Vector2f centre = aircraftPosition(aircraft);
+         writeCircle(aircraft.slot, centre, getAircraftColor(aircraft));
+         writeLabel(aircraft.slot, aircraft.flightNumber,
+                    sf::Vector2f(centre.x - AIRCRAFT_RADIUS, centre.y - AIRCRAFT_RADIUS - 20 + LABEL_SIZE));
+     }
+     //grow to the scheduler's slot count; new slots start free and draw nothing
+     void reserveSlots(size_t count) {
+         if (count <= slots.size()) {
+             return;
+         }
+         size_t first = slots.size();
+         slots.resize(count, AircraftSlot{-1, 0, -1});
+         aircraftGlyphs.resize(count * AIRCRAFT_VERTICES);
+         labelGlyphs.resize(count * LABEL_VERTICES);
+         clearVertices(aircraftGlyphs, first * AIRCRAFT_VERTICES, (count - first) * AIRCRAFT_VERTICES);
+         clearVertices(labelGlyphs, first * LABEL_VERTICES, (count - first) * LABEL_VERTICES);
+     }
+     //slots of aircraft that were not in this frame's list are hidden
+     void releaseUnseenSlots() {
+         for (size_t slot = 0; slot < slots.size(); slot++) {
+             if (slots[slot].aircraftId >= 0 && slots[slot].frameSeen != frameCount) {
+                 slots[slot].aircraftId = -1;
+                 clearVertices(aircraftGlyphs, slot * AIRCRAFT_VERTICES, AIRCRAFT_VERTICES);
+                 clearVertices(labelGlyphs, slot * LABEL_VERTICES, LABEL_VERTICES);
+             }
+         }
+     }
+     //collapsed triangles draw nothing
+     static void clearVertices(sf::VertexArray& vertices, size_t first, size_t count) {
+         for (size_t i = first; i < first + count; i++) {
+             vertices[i] = sf::Vertex(sf::Vector2f(0, 0), sf::Color::Transparent);
+         }
+     }
+     void writeCircle(int slot, sf::Vector2f centre, sf::Color color) {
+         size_t base = slot * AIRCRAFT_VERTICES;
+         for (int i = 0; i < AIRCRAFT_SEGMENTS; i++) {
+             float a0 = 2 * M_PI * i / AIRCRAFT_SEGMENTS;
+             float a1 = 2 * M_PI * (i + 1) / AIRCRAFT_SEGMENTS;
+             aircraftGlyphs[base + i * 3] = sf::Vertex(centre, color);
+             aircraftGlyphs[base + i * 3 + 1] = sf::Vertex(
+                 sf::Vector2f(centre.x + AIRCRAFT_RADIUS * cos(a0), centre.y + AIRCRAFT_RADIUS * sin(a0)), color);
+             aircraftGlyphs[base + i * 3 + 2] = sf::Vertex(
+                 sf::Vector2f(centre.x + AIRCRAFT_RADIUS * cos(a1), centre.y + AIRCRAFT_RADIUS * sin(a1)), color);
+         }
+     }
+     //one textured quad (two triangles) per character, from the glyph atlas
+     void writeLabel(int slot, const std::string& text, sf::Vector2f baseline) {
+         size_t base = slot * LABEL_VERTICES;
+         float x = baseline.x;
+         for (size_t i = 0; i < LABEL_MAX_CHARS; i++) {
+             sf::Vertex* quad = &labelGlyphs[base + i * 6];
+             if (i >= text.size()) {
+                 clearVertices(labelGlyphs, base + i * 6, 6);
+                 continue;
              }
+             const sf::Glyph& glyph = font.getGlyph(static_cast<unsigned char>(text[i]), LABEL_SIZE, false);
+             float left = x + glyph.bounds.left;
+             float top = baseline.y + glyph.bounds.top;
+             float right = left + glyph.bounds.width;
+             float bottom = top + glyph.bounds.height;
+             float u0 = glyph.textureRect.left;
+             float v0 = glyph.textureRect.top;
+             float u1 = u0 + glyph.textureRect.width;
+             float v1 = v0 + glyph.textureRect.height;
+             quad[0] = sf::Vertex(sf::Vector2f(left, top), sf::Color::Black, sf::Vector2f(u0, v0));
+             quad[1] = sf::Vertex(sf::Vector2f(right, top), sf::Color::Black, sf::Vector2f(u1, v0));
+             quad[2] = sf::Vertex(sf::Vector2f(left, bottom), sf::Color::Black, sf::Vector2f(u0, v1));
+             quad[3] = quad[2];
+             quad[4] = quad[1];
+             quad[5] = sf::Vertex(sf::Vector2f(right, bottom), sf::Color::Black, sf::Vector2f(u1, v1));
+             x += glyph.advance;
          }
-         aircraftShapes[id].setPosition(x - AIRCRAFT_RADIUS, y - AIRCRAFT_RADIUS);
-         aircraftLabels[id].setPosition(x - AIRCRAFT_RADIUS, y - AIRCRAFT_RADIUS - 20);
-         window.draw(aircraftShapes[id]);
-         window.draw(aircraftLabels[id]);
      }
-     sf::Color getAircraftColor(const std::shared_ptr<Aircraft>& aircraft) {
-         if (aircraft->isEmergency) {
+     sf::Color getAircraftColor(const AircraftView& aircraft) {
+         if (aircraft.emergency) {
              return sf::Color::Red;
-         } else if (aircraft->type == FlightType::CARGO) {
+         } else if (aircraft.type == FlightType::CARGO) {
              return sf::Color::Blue;
          } else {
              return sf::Color::Green;
@@ -2102,20 +2446,91 @@ void checkViolation() override {
  // Global simulation time and scheduler
  std::atomic<int> simulationTime{0};
  FlightScheduler* globalScheduler = nullptr;
- bool simulationRunning = true;
+ std::atomic<bool> simulationRunning{true};
  std::atomic<bool> simulationPaused{true};
+ std::atomic<bool> terminalViewActive{false}; //set while the window runs, the sim thread then owns the terminal status
+
+std::atomic<double> simulationSpeed{1.0}; //simulated seconds per wall second, 0 = unthrottled
 
 void simulationLoop() {
     while (simulationRunning) {
         if (!simulationPaused && simulationTime < SIMULATION_TIME) {
             globalScheduler->updateSimulation();
             simulationTime++;
+            //the renderer only ever sees this copy, never the live flights
+            globalScheduler->publishRenderSnapshot(simulationTime);
+            if (terminalViewActive) {
+                cout << "\033[2J\033[H";
+                cout << "AIR TRAFFIC SIMULATION (Terminal View)" << endl;
+                cout << "SFML window is running alongside this terminal" << endl;
+                cout << "Press 'q' at any time to return to the main menu" << endl;
+                cout << "--------------------------------------------" << endl;
+                globalScheduler->printStatus();
+            }
+            if (simulationSpeed > 0) {
+                std::this_thread::sleep_for(std::chrono::duration<double>(1.0 / simulationSpeed));
+            }
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+}
+
+//headless batch run, no menu, no window, no child processes
+int runHeadless(int duration, double speed) {
+    FlightScheduler scheduler(-1);
+    scheduler.setVerbose(false);
+
+    auto start = chrono::steady_clock::now();
+    for (int tick = 0; tick < duration; tick++) {
+        scheduler.updateSimulation();
+        if (speed > 0) {
+            this_thread::sleep_for(chrono::duration<double>(1.0 / speed));
         }
-        std::this_thread::sleep_for(std::chrono::seconds(1));
     }
+    auto elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start);
+
+    scheduler.printSummary();
+    cout << "Wall Time: " << fixed << setprecision(3) << elapsed.count() << " ms" << endl;
+    return 0;
 }
 
-int main() {
+void printUsage(const char* program) {
+    cout << "Usage: " << program << " [--headless] [--duration SECONDS] [--speed FACTOR] [--seed N]" << endl;
+    cout << "  --headless          Run the simulation without menus or graphics and print final metrics" << endl;
+    cout << "  --duration SECONDS  Simulated seconds to run headless (default " << SIMULATION_TIME << ")" << endl;
+    cout << "  --speed FACTOR      Simulated seconds per wall second, 0 = unthrottled (default 1, headless 0)" << endl;
+    cout << "  --seed N            Seed the random number generator for reproducible runs" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    bool headless = false;
+    int duration = SIMULATION_TIME;
+    double speed = -1.0;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--duration" && i + 1 < argc) {
+            duration = atoi(argv[++i]);
+        } else if (arg == "--speed" && i + 1 < argc) {
+            speed = atof(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            gen.seed(strtoul(argv[++i], nullptr, 10));
+        } else {
+            printUsage(argv[0]);
+            return (arg == "--help" || arg == "-h") ? 0 : 1;
+        }
+    }
+
+    if (headless) {
+        return runHeadless(duration, speed < 0 ? 0.0 : speed);
+    }
+    if (speed >= 0) {
+        simulationSpeed = speed;
+    }
+
     int atcToAvn[2];        // ATC -> AVN Generator
     int avnToAirline[2];    // AVN Generator -> Airline Portal
     int airlineToAvn[2];    // Airline Portal -> AVN Generator
@@ -2221,25 +2636,11 @@ int main() {
             struct timeval tv;
             AirportGraphics* graphics = new AirportGraphics();
             
-            int lastPrintTime = -10; 
-            const int PRINT_INTERVAL = 1; 
-            
             while (true) {
-                if (graphics && graphics->isOpen()) {
+                terminalViewActive = graphics && graphics->isOpen();
+                if (terminalViewActive) {
                     graphics->handleEvents();
-                    graphics->update(scheduler.getActiveFlights(), simulationTime);
-                    
-                    if (simulationTime >= lastPrintTime + PRINT_INTERVAL) {
-                        cout << "\033[2J\033[H"; 
-                        cout << "AIR TRAFFIC SIMULATION (Terminal View)" << endl;
-                        cout << "SFML window is running alongside this terminal" << endl;
-                        cout << "Press 'q' at any time to return to the main menu" << endl;
-                        cout << "--------------------------------------------" << endl;
-                        
-                        scheduler.printStatus();
-                        
-                        lastPrintTime = simulationTime;
-                    }
+                    graphics->update(scheduler.latestRenderSnapshot());
                 }
                 
                 FD_ZERO(&readfds);
@@ -2254,6 +2655,7 @@ int main() {
                 }
                 std::this_thread::sleep_for(std::chrono::milliseconds(100));
             }
+            terminalViewActive = false;
             tcsetattr(STDIN_FILENO, TCSANOW, &oldSettings);
             if (graphics) {
                 delete graphics;